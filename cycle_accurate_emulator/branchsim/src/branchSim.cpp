@@ -0,0 +1,291 @@
+// vim: set ts=4 nu ai:
+#include <lib/branchTrace.h>
+#include <lib/elfFile.h>
+#include <lib/symbolTable.h>
+#include <branchpredictor.h>
+#include <config.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <unordered_map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace std;
+
+/*********************************************************
+ * 	Trace driven branch prediction
+ *
+ * 	Replays a branch trace recorded by simRISCV -b through
+ * 	the predictors of catapult.sim (see branchpredictor.h).
+ * 	Each line of the configuration file is one predictor,
+ * 	given as predictor.key=value overrides separated by
+ * 	spaces and applied on top of the -o options. Without a
+ * 	file every type is evaluated with the default sizes.
+ *
+ * 	Unlike in the pipeline, a predictor is trained and
+ * 	recovers right after each prediction, so the numbers
+ * 	are those of a predictor updated without delay. The
+ * 	predictors are evaluated by a pool of threads sharing
+ * 	the trace.
+ *********************************************************/
+
+#define BRANCHSIM_TOP 20
+
+struct PredictorRun{
+	string name;
+	PredictorConfig config;
+	unsigned long long branches[PREDICTOR_KINDS];
+	unsigned long long mispredicted[PREDICTOR_KINDS];
+	vector<unsigned int> staticMispredicted; //Per static branch
+};
+
+struct StaticBranch{
+	uint32_t pc;
+	uint8_t kind;
+	unsigned long long executions;
+	unsigned long long taken;
+	unsigned long long mispredicted; //Summed over the predictors, to rank the branches
+};
+
+static void printUsage(const char* program){
+	cerr << "Usage: " << program << " [-j threads] [-c configs] [-o predictor.key=value]... [-e elf] [-n top] trace" << endl;
+	cerr << "  -j threads              number of predictors evaluated at once (all the host threads by default)" << endl;
+	cerr << "  -c configs              one predictor per line, as predictor.key=value overrides" << endl;
+	cerr << "  -o predictor.key=value  override applied to every predictor" << endl;
+	cerr << "  -e elf                  name the functions of the static branches" << endl;
+	cerr << "  -n top                  number of static branches reported (" << BRANCHSIM_TOP << " by default)" << endl;
+}
+
+static bool addRun(const string& name, const SimulatorConfig& config, vector<PredictorRun>* runs){
+	if(!checkConfig(&config))
+		return false;
+	if(config.predictor.type == NO_PREDICTOR){
+		cerr << "predictor.type must not be none" << endl;
+		return false;
+	}
+	PredictorRun run;
+	run.name = name;
+	run.config = config.predictor;
+	runs->push_back(run);
+	return true;
+}
+
+static bool readConfigs(const char* fileName, const SimulatorConfig& base, vector<PredictorRun>* runs){
+	ifstream in(fileName);
+	if(!in){
+		cerr << "Cannot open " << fileName << endl;
+		return false;
+	}
+	string line;
+	while(getline(in, line)){
+		istringstream tokens(line);
+		string option, name;
+		SimulatorConfig config = base;
+		while(tokens >> option){
+			if(option[0] == '#')
+				break;
+			if(!applyOverride(&config, option))
+				return false;
+			name += (name.empty() ? "" : " ") + option;
+		}
+		if(!name.empty() && !addRun(name, config, runs))
+			return false;
+	}
+	return true;
+}
+
+static void evaluate(const vector<BranchRecord>& trace, const vector<unsigned int>& staticIndex, PredictorRun* run){
+	BranchPredictor predictor(run->config);
+	for(unsigned int i = 0; i < trace.size(); i++){
+		const BranchRecord& record = trace[i];
+		branch_prediction prediction;
+		bool taken = record.flags & BRANCHTRACE_TAKEN;
+		predictor.predict(record.pc, record.kind, record.flags & BRANCHTRACE_CALL, record.target < record.pc, &prediction);
+		bool mispredicted = taken != prediction.taken || (taken && record.target != prediction.target);
+		if(mispredicted){
+			predictor.recover(prediction, taken);
+			run->staticMispredicted[staticIndex[i]]++;
+		}
+		predictor.update(record.pc, prediction, taken, record.target, mispredicted);
+	}
+	for(int kind = 0; kind < PREDICTOR_KINDS; kind++){
+		run->branches[kind] = predictor.getNumberBranches(kind).to_uint();
+		run->mispredicted[kind] = predictor.getNumberMispredicted(kind).to_uint();
+	}
+}
+
+//Percentage of the control instructions of a class predicted right, - when there are none
+static void printAccuracy(unsigned long long mispredicted, unsigned long long branches){
+	if(branches == 0)
+		printf(" %10s", "-");
+	else
+		printf(" %10.3f", 100.0 * (branches - mispredicted) / branches);
+}
+
+static bool compareMispredicted(const StaticBranch& first, const StaticBranch& second){
+	return first.mispredicted > second.mispredicted;
+}
+
+int main(int argc, char** argv){
+	SimulatorConfig base;
+	const char* configFile = NULL;
+	const char* elf = NULL;
+	unsigned int top = BRANCHSIM_TOP;
+	unsigned int threads = thread::hardware_concurrency();
+	int option;
+
+	while((option = getopt(argc, argv, "j:c:o:e:n:h")) != -1){
+		switch(option){
+			case 'j':
+				threads = atoi(optarg);
+				break;
+			case 'c':
+				configFile = optarg;
+				break;
+			case 'o':
+				if(!applyOverride(&base, optarg))
+					return 1;
+				break;
+			case 'e':
+				elf = optarg;
+				break;
+			case 'n':
+				top = atoi(optarg);
+				break;
+			case 'h':
+				printUsage(argv[0]);
+				return 0;
+			default:
+				printUsage(argv[0]);
+				return 1;
+		}
+	}
+	if(optind != argc - 1){
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	vector<BranchRecord> trace;
+	uint64_t instructions;
+	if(!readBranchTrace(argv[optind], &trace, &instructions)){
+		cerr << "Cannot read the branch trace " << argv[optind] << endl;
+		return 1;
+	}
+
+	vector<PredictorRun> runs;
+	if(configFile != NULL){
+		if(!readConfigs(configFile, base, &runs))
+			return 1;
+	}
+	else{
+		static const char* types[] = {"nottaken", "btfn", "bimodal", "gshare", "tournament"};
+		for(unsigned int i = 0; i < sizeof(types) / sizeof(types[0]); i++){
+			SimulatorConfig config = base;
+			string override = string("predictor.type=") + types[i];
+			if(!applyOverride(&config, override) || !addRun(override, config, &runs))
+				return 1;
+		}
+	}
+	if(runs.empty()){
+		cerr << "No predictor to evaluate" << endl;
+		return 1;
+	}
+
+	//The static branches are numbered once, the threads only count their mispredictions
+	vector<StaticBranch> branches;
+	vector<unsigned int> staticIndex(trace.size());
+	unordered_map<uint32_t, unsigned int> indexOfPc;
+	for(unsigned int i = 0; i < trace.size(); i++){
+		unordered_map<uint32_t, unsigned int>::iterator it = indexOfPc.find(trace[i].pc);
+		if(it == indexOfPc.end()){
+			StaticBranch branch;
+			branch.pc = trace[i].pc;
+			branch.kind = trace[i].kind;
+			branch.executions = 0;
+			branch.taken = 0;
+			branch.mispredicted = 0;
+			it = indexOfPc.insert(make_pair(trace[i].pc, (unsigned int) branches.size())).first;
+			branches.push_back(branch);
+		}
+		staticIndex[i] = it->second;
+		branches[it->second].executions++;
+		if(trace[i].flags & BRANCHTRACE_TAKEN)
+			branches[it->second].taken++;
+	}
+	for(unsigned int r = 0; r < runs.size(); r++)
+		runs[r].staticMispredicted.assign(branches.size(), 0);
+
+	atomic<unsigned int> nextRun(0);
+	if(threads < 1)
+		threads = 1;
+	if(threads > runs.size())
+		threads = runs.size();
+	vector<thread> pool;
+	for(unsigned int t = 0; t < threads; t++){
+		pool.push_back(thread([&](){
+			unsigned int i;
+			while((i = nextRun++) < runs.size())
+				evaluate(trace, staticIndex, &runs[i]);
+		}));
+	}
+	for(unsigned int t = 0; t < pool.size(); t++)
+		pool[t].join();
+
+	double kilo = instructions == 0 ? 1.0 : instructions / 1000.0;
+	cout << trace.size() << " control instructions out of " << instructions << " instructions, "
+		<< branches.size() << " static ones" << endl;
+	printf("%4s %10s %10s %10s %10s %10s\n", "#", "MPKI", "branches%", "jumps%", "returns%", "indirect%");
+	for(unsigned int r = 0; r < runs.size(); r++){
+		const PredictorRun& run = runs[r];
+		unsigned long long mispredicted = 0;
+		for(int kind = 0; kind < PREDICTOR_KINDS; kind++)
+			mispredicted += run.mispredicted[kind];
+		printf("%4u %10.3f", r, mispredicted / kilo);
+		for(int kind = CONDITIONAL_BRANCH; kind < PREDICTOR_KINDS; kind++)
+			printAccuracy(run.mispredicted[kind], run.branches[kind]);
+		printf("\n");
+	}
+	cout << endl;
+	for(unsigned int r = 0; r < runs.size(); r++)
+		cout << r << ": " << runs[r].name << endl;
+
+	//MPKI of the static branches mispredicted the most, over all the predictors
+	for(unsigned int b = 0; b < branches.size(); b++){
+		for(unsigned int r = 0; r < runs.size(); r++)
+			branches[b].mispredicted += runs[r].staticMispredicted[b];
+	}
+	vector<StaticBranch> ranked(branches);
+	stable_sort(ranked.begin(), ranked.end(), compareMispredicted);
+	if(ranked.size() > top)
+		ranked.resize(top);
+
+	ElfFile* elfFile = elf != NULL ? new ElfFile(elf) : NULL;
+	SymbolTable* symbols = elfFile != NULL ? new SymbolTable(elfFile) : NULL;
+	static const char* kinds[PREDICTOR_KINDS] = {"", "branch", "jump", "return", "indirect"};
+	cout << endl << "Static branches, MPKI of each predictor" << endl;
+	printf("%10s %-20s %-8s %12s %7s", "pc", "function", "kind", "executions", "taken%");
+	for(unsigned int r = 0; r < runs.size(); r++)
+		printf(" %8u", r);
+	printf("\n");
+	for(unsigned int b = 0; b < ranked.size(); b++){
+		const StaticBranch& branch = ranked[b];
+		const char* function = symbols != NULL ? symbols->getFunction(branch.pc) : NULL;
+		printf("%10x %-20s %-8s %12llu %7.2f", branch.pc, function != NULL ? function : "?",
+				branch.kind < PREDICTOR_KINDS ? kinds[branch.kind] : "?", branch.executions,
+				100.0 * branch.taken / branch.executions);
+		unsigned int index = indexOfPc[branch.pc];
+		for(unsigned int r = 0; r < runs.size(); r++)
+			printf(" %8.3f", runs[r].staticMispredicted[index] / kilo);
+		printf("\n");
+	}
+	delete symbols;
+	delete elfFile;
+	return 0;
+}
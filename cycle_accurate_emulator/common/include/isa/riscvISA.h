@@ -10,6 +10,7 @@
 
 #include <types.h>
 #include <string.h>
+#include <string>
 
 #define RISCV_LUI 0x37
 #define RISCV_AUIPC 0x17
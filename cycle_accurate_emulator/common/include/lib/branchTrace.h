@@ -0,0 +1,77 @@
+#ifndef __BRANCHTRACE
+#define __BRANCHTRACE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+
+/*
+ * Branch traces
+ *
+ * The file starts with the 8 bytes of BRANCHTRACE_MAGIC and the number
+ * of instructions executed by the program, on 8 bytes, followed by one
+ * 10 bytes little endian record per control instruction: its PC, its
+ * target (taken or not), its kind and its flags. The kinds are those of
+ * the fetch stage of the core (branchpredictor.h): conditional branch,
+ * JAL, JALR reading a link register (a return) and other JALR.
+ */
+
+#define BRANCHTRACE_MAGIC "CBTRACE1"
+#define BRANCHTRACE_HEADERBYTES 16
+#define BRANCHTRACE_RECORDBYTES 10
+#define BRANCHTRACE_BUFFERRECORDS 8192
+
+enum BranchTraceKind
+{
+	BRANCHTRACE_CONDITIONAL = 1,
+	BRANCHTRACE_JUMP = 2,
+	BRANCHTRACE_RETURN = 3,
+	BRANCHTRACE_INDIRECT = 4
+};
+
+#define BRANCHTRACE_TAKEN 1
+#define BRANCHTRACE_CALL 2 //Writes a link register
+
+struct BranchRecord
+{
+	uint32_t pc;
+	uint32_t target;
+	uint8_t kind;
+	uint8_t flags;
+};
+
+class BranchTraceWriter
+{
+public:
+	BranchTraceWriter();
+	~BranchTraceWriter();
+
+	bool open(const char* path);
+	//Writes the number of instructions in the header
+	void close(uint64_t instructions);
+
+	inline void write(uint32_t pc, uint32_t target, uint8_t kind, uint8_t flags){
+		unsigned char* record = buffer + used;
+		for (int i = 0; i < 4; i++){
+			record[i] = pc >> (8*i);
+			record[4 + i] = target >> (8*i);
+		}
+		record[8] = kind;
+		record[9] = flags;
+		used += BRANCHTRACE_RECORDBYTES;
+		if (used == sizeof(buffer))
+			flush();
+	}
+
+private:
+	FILE* file;
+	unsigned char buffer[BRANCHTRACE_BUFFERRECORDS * BRANCHTRACE_RECORDBYTES];
+	unsigned int used;
+
+	void flush();
+};
+
+//Returns false on errors
+bool readBranchTrace(const char* path, std::vector<BranchRecord>* records, uint64_t* instructions);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef __ELFIMAGE
+#define __ELFIMAGE
+
+#include <lib/elfFile.h>
+#include <lib/symbolTable.h>
+#include <vector>
+#include <string>
+
+/*
+ * What a simulation needs of an ELF file, read once: the content of
+ * the sections it loads in memory, the address of _start and the
+ * symbols. The image no longer refers to the file, the simulations of
+ * a batch share one image from their threads.
+ */
+
+struct ElfImageSection
+{
+	unsigned int address;
+	std::vector<unsigned char> content;
+};
+
+class ElfImage
+{
+public:
+	ElfImage(ElfFile* elfFile);
+
+	std::string path;
+	//The sections with an address and .text, in the order of the section table
+	std::vector<ElfImageSection> sections;
+	unsigned int start; //0 without a _start symbol
+	bool is32Bits;
+	SymbolTable symbols;
+};
+
+#endif
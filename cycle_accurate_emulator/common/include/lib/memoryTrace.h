@@ -0,0 +1,73 @@
+#ifndef __MEMORYTRACE
+#define __MEMORYTRACE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+
+/*
+ * Memory access traces
+ *
+ * The binary format starts with the 8 bytes of MEMORYTRACE_MAGIC,
+ * followed by one 10 bytes little endian record per access: the PC of
+ * the instruction, the address, the size in bytes and the type. The
+ * types are the labels of the Dinero din format, which is read and
+ * written as "label address" lines, the address in hexadecimal. A din
+ * file has no PC, and its accesses are taken as 4 bytes wide.
+ */
+
+#define MEMORYTRACE_MAGIC "CMTRACE1"
+#define MEMORYTRACE_MAGICBYTES 8
+#define MEMORYTRACE_RECORDBYTES 10
+#define MEMORYTRACE_BUFFERRECORDS 8192
+
+enum MemoryAccessType
+{
+	TRACE_READ = 0,
+	TRACE_WRITE = 1,
+	TRACE_FETCH = 2
+};
+
+struct MemoryAccess
+{
+	uint32_t pc;
+	uint32_t address;
+	uint8_t size;
+	uint8_t type;
+};
+
+class MemoryTraceWriter
+{
+public:
+	MemoryTraceWriter();
+	~MemoryTraceWriter();
+
+	bool open(const char* path);
+	void close();
+
+	inline void write(uint32_t pc, uint32_t address, uint8_t size, uint8_t type){
+		unsigned char* record = buffer + used;
+		for (int i = 0; i < 4; i++){
+			record[i] = pc >> (8*i);
+			record[4 + i] = address >> (8*i);
+		}
+		record[8] = size;
+		record[9] = type;
+		used += MEMORYTRACE_RECORDBYTES;
+		if (used == sizeof(buffer))
+			flush();
+	}
+
+private:
+	FILE* file;
+	unsigned char buffer[MEMORYTRACE_BUFFERRECORDS * MEMORYTRACE_RECORDBYTES];
+	unsigned int used;
+
+	void flush();
+};
+
+//Reads a binary trace, or a din file when it does not start with the magic. Returns false on errors.
+bool readMemoryTrace(const char* path, std::vector<MemoryAccess>* accesses);
+bool writeDinero(const char* path, const std::vector<MemoryAccess>& accesses);
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef __STACKDISTANCE
+#define __STACKDISTANCE
+
+#include <ostream>
+#include <vector>
+#include <unordered_map>
+#include <ext/pb_ds/assoc_container.hpp>
+#include <ext/pb_ds/tree_policy.hpp>
+
+/*
+ * Single pass LRU stack distance analysis (Mattson et al.)
+ *
+ * Every access gives the number of distinct lines touched since the
+ * previous access to its line, both over the whole memory (fully
+ * associative) and within its set for every power of two number of
+ * sets up to 2^STACKDISTANCE_MAXSETBITS. An LRU cache of W ways
+ * misses exactly the accesses whose distance is at least W, so the
+ * histograms give the miss ratio of every such cache at once.
+ *
+ * The fully associative distance is the number of lines whose last
+ * access is more recent, counted with an order statistics tree of the
+ * last access times (Bennett and Kruskal) in O(log n). Within a set,
+ * only the distances below STACKDISTANCE_MAXWAYS matter, they are
+ * found in a per set LRU stack of that depth.
+ */
+
+#define STACKDISTANCE_MAXSETBITS 12
+#define STACKDISTANCE_MAXWAYS 64 //Distances tracked for the set associative caches
+
+typedef __gnu_pbds::tree<unsigned long long, __gnu_pbds::null_type, std::less<unsigned long long>,
+		__gnu_pbds::rb_tree_tag, __gnu_pbds::tree_order_statistics_node_update> OrderedTimes;
+
+class StackDistance
+{
+public:
+	StackDistance(int lineBytes);
+
+	void access(unsigned int address);
+	void writeReport(std::ostream& out);
+
+	unsigned long long getAccesses();
+	unsigned long long getDistinctLines();
+	//Misses of a fully associative LRU cache of that many lines
+	unsigned long long getMisses(unsigned int lines);
+	unsigned long long getMisses(unsigned int sets, unsigned int ways);
+
+private:
+	int lineBits;
+	unsigned long long time;
+	unsigned long long accesses;
+	std::unordered_map<unsigned int, unsigned long long> lastAccess;
+
+	OrderedTimes times;
+	//Index k for 2^k sets, [sets][STACKDISTANCE_MAXWAYS] lines, most recent first
+	std::vector<unsigned int> stacks[STACKDISTANCE_MAXSETBITS + 1];
+	std::vector<unsigned char> depths[STACKDISTANCE_MAXSETBITS + 1];
+	//The last entry of the set associative ones counts the distances of STACKDISTANCE_MAXWAYS or more
+	std::vector<unsigned long long> histogram[STACKDISTANCE_MAXSETBITS + 1];
+};
+
+#endif
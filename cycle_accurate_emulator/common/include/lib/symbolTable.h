@@ -0,0 +1,41 @@
+#ifndef __SYMBOLTABLE
+#define __SYMBOLTABLE
+
+#include <lib/elfFile.h>
+#include <vector>
+#include <string>
+
+/*
+ * Address to name lookup in the .symtab of an ELF file.
+ * Functions and data objects are kept apart, a function symbol
+ * without a size spans up to the next function.
+ */
+
+struct SymbolRange
+{
+	unsigned int start;
+	unsigned int end;
+	std::string name;
+
+	bool operator<(const SymbolRange& other) const{
+		return start < other.start;
+	}
+};
+
+class SymbolTable
+{
+public:
+	SymbolTable(ElfFile* elfFile);
+
+	//Return NULL when no symbol contains the address
+	const char* getFunction(unsigned int address) const;
+	const char* getObject(unsigned int address) const;
+
+private:
+	std::vector<SymbolRange> functions;
+	std::vector<SymbolRange> objects;
+
+	static const char* find(const std::vector<SymbolRange>& ranges, unsigned int address);
+};
+
+#endif
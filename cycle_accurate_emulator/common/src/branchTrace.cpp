@@ -0,0 +1,78 @@
+#include <lib/branchTrace.h>
+#include <string.h>
+
+using namespace std;
+
+BranchTraceWriter::BranchTraceWriter(){
+	file = NULL;
+	used = 0;
+}
+
+BranchTraceWriter::~BranchTraceWriter(){
+	close(0);
+}
+
+bool BranchTraceWriter::open(const char* path){
+	close(0);
+	file = fopen(path, "wb");
+	if (file == NULL)
+		return false;
+	unsigned char header[BRANCHTRACE_HEADERBYTES];
+	memset(header, 0, sizeof(header));
+	memcpy(header, BRANCHTRACE_MAGIC, 8);
+	fwrite(header, 1, sizeof(header), file);
+	return true;
+}
+
+void BranchTraceWriter::flush(){
+	if (file != NULL)
+		fwrite(buffer, 1, used, file);
+	used = 0;
+}
+
+void BranchTraceWriter::close(uint64_t instructions){
+	if (file == NULL)
+		return;
+	flush();
+	unsigned char count[8];
+	for (int i = 0; i < 8; i++)
+		count[i] = instructions >> (8*i);
+	fseek(file, 8, SEEK_SET);
+	fwrite(count, 1, 8, file);
+	fclose(file);
+	file = NULL;
+}
+
+bool readBranchTrace(const char* path, vector<BranchRecord>* records, uint64_t* instructions){
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+		return false;
+
+	unsigned char header[BRANCHTRACE_HEADERBYTES];
+	if (fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, BRANCHTRACE_MAGIC, 8) != 0){
+		fclose(file);
+		return false;
+	}
+	*instructions = 0;
+	for (int i = 7; i >= 0; i--)
+		*instructions = (*instructions << 8) | header[8 + i];
+
+	unsigned char buffer[BRANCHTRACE_BUFFERRECORDS * BRANCHTRACE_RECORDBYTES];
+	size_t bytes;
+	while ((bytes = fread(buffer, 1, sizeof(buffer), file)) != 0){
+		if (bytes % BRANCHTRACE_RECORDBYTES != 0){
+			fclose(file);
+			return false;
+		}
+		for (unsigned char* record = buffer; record < buffer + bytes; record += BRANCHTRACE_RECORDBYTES){
+			BranchRecord branch;
+			branch.pc = record[0] | record[1] << 8 | record[2] << 16 | (uint32_t) record[3] << 24;
+			branch.target = record[4] | record[5] << 8 | record[6] << 16 | (uint32_t) record[7] << 24;
+			branch.kind = record[8];
+			branch.flags = record[9];
+			records->push_back(branch);
+		}
+	}
+	fclose(file);
+	return true;
+}
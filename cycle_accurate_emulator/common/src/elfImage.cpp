@@ -0,0 +1,30 @@
+#include <lib/elfImage.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+ElfImage::ElfImage(ElfFile* elfFile) : path(elfFile->pathToElfFile), start(0), is32Bits(elfFile->is32Bits), symbols(elfFile){
+	for (unsigned int sectionNumber = 0; sectionNumber < elfFile->sectionTable->size(); sectionNumber++){
+		ElfSection *section = elfFile->sectionTable->at(sectionNumber);
+		if (section->address == 0 && section->getName().compare(".text"))
+			continue;
+
+		ElfImageSection loaded;
+		loaded.address = section->address;
+		unsigned char* content = section->getSectionCode();
+		loaded.content.assign(content, content + section->size);
+		free(content);
+		sections.push_back(loaded);
+	}
+
+	if (elfFile->symbols->empty())
+		return;
+	unsigned char* names = elfFile->sectionTable->at(elfFile->indexOfSymbolNameSection)->getSectionCode();
+	for (unsigned int oneSymbol = 0; oneSymbol < elfFile->symbols->size(); oneSymbol++){
+		ElfSymbol *symbol = elfFile->symbols->at(oneSymbol);
+		if (strcmp((const char*) &names[symbol->name], "_start") == 0)
+			start = symbol->offset;
+	}
+	free(names);
+}
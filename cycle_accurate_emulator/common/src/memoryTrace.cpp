@@ -0,0 +1,100 @@
+#include <lib/memoryTrace.h>
+#include <string.h>
+
+using namespace std;
+
+MemoryTraceWriter::MemoryTraceWriter(){
+	file = NULL;
+	used = 0;
+}
+
+MemoryTraceWriter::~MemoryTraceWriter(){
+	close();
+}
+
+bool MemoryTraceWriter::open(const char* path){
+	close();
+	file = fopen(path, "wb");
+	if (file == NULL)
+		return false;
+	fwrite(MEMORYTRACE_MAGIC, 1, MEMORYTRACE_MAGICBYTES, file);
+	return true;
+}
+
+void MemoryTraceWriter::flush(){
+	if (file != NULL)
+		fwrite(buffer, 1, used, file);
+	used = 0;
+}
+
+void MemoryTraceWriter::close(){
+	if (file == NULL)
+		return;
+	flush();
+	fclose(file);
+	file = NULL;
+}
+
+static bool readDinero(FILE* file, vector<MemoryAccess>* accesses){
+	char line[256];
+	while (fgets(line, sizeof(line), file) != NULL){
+		unsigned int label;
+		unsigned int address;
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (sscanf(line, "%u %x", &label, &address) != 2 || label > TRACE_FETCH)
+			return false;
+
+		MemoryAccess access;
+		access.pc = 0;
+		access.address = address;
+		access.size = 4;
+		access.type = label;
+		accesses->push_back(access);
+	}
+	return true;
+}
+
+bool readMemoryTrace(const char* path, vector<MemoryAccess>* accesses){
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+		return false;
+
+	char magic[MEMORYTRACE_MAGICBYTES];
+	if (fread(magic, 1, MEMORYTRACE_MAGICBYTES, file) != MEMORYTRACE_MAGICBYTES
+			|| memcmp(magic, MEMORYTRACE_MAGIC, MEMORYTRACE_MAGICBYTES) != 0){
+		rewind(file);
+		bool valid = readDinero(file, accesses);
+		fclose(file);
+		return valid;
+	}
+
+	unsigned char buffer[MEMORYTRACE_BUFFERRECORDS * MEMORYTRACE_RECORDBYTES];
+	size_t bytes;
+	while ((bytes = fread(buffer, 1, sizeof(buffer), file)) != 0){
+		if (bytes % MEMORYTRACE_RECORDBYTES != 0){
+			fclose(file);
+			return false;
+		}
+		for (unsigned char* record = buffer; record < buffer + bytes; record += MEMORYTRACE_RECORDBYTES){
+			MemoryAccess access;
+			access.pc = record[0] | record[1] << 8 | record[2] << 16 | (uint32_t) record[3] << 24;
+			access.address = record[4] | record[5] << 8 | record[6] << 16 | (uint32_t) record[7] << 24;
+			access.size = record[8];
+			access.type = record[9];
+			accesses->push_back(access);
+		}
+	}
+	fclose(file);
+	return true;
+}
+
+bool writeDinero(const char* path, const vector<MemoryAccess>& accesses){
+	FILE* file = fopen(path, "w");
+	if (file == NULL)
+		return false;
+	for (unsigned int i = 0; i < accesses.size(); i++)
+		fprintf(file, "%u %x\n", accesses[i].type, accesses[i].address);
+	fclose(file);
+	return true;
+}
@@ -0,0 +1,127 @@
+#include <lib/stackDistance.h>
+#include <iomanip>
+
+using namespace std;
+
+StackDistance::StackDistance(int lineBytes){
+	lineBits = 0;
+	while ((1 << lineBits) < lineBytes)
+		lineBits++;
+	time = 0;
+	accesses = 0;
+	for (int k = 1; k <= STACKDISTANCE_MAXSETBITS; k++){
+		stacks[k].resize((1 << k) * STACKDISTANCE_MAXWAYS);
+		depths[k].resize(1 << k, 0);
+		histogram[k].resize(STACKDISTANCE_MAXWAYS + 1, 0);
+	}
+}
+
+void StackDistance::access(unsigned int address){
+	unsigned int line = address >> lineBits;
+	accesses++;
+	time++;
+
+	unordered_map<unsigned int, unsigned long long>::iterator last = lastAccess.find(line);
+	bool reuse = last != lastAccess.end();
+	if (reuse){
+		//Lines touched after the previous access to this one
+		unsigned long long distance = times.size() - times.order_of_key(last->second) - 1;
+		times.erase(last->second);
+		if (distance >= histogram[0].size())
+			histogram[0].resize(distance + 1, 0);
+		histogram[0][distance]++;
+		last->second = time;
+	}
+	else
+		lastAccess[line] = time;
+	times.insert(time);
+
+	for (int k = 1; k <= STACKDISTANCE_MAXSETBITS; k++){
+		unsigned int set = line & ((1u << k) - 1);
+		unsigned int* stack = &stacks[k][set * STACKDISTANCE_MAXWAYS];
+		int depth = depths[k][set];
+		int distance = 0;
+		while (distance < depth && stack[distance] != line)
+			distance++;
+		if (reuse)
+			histogram[k][distance]++;
+
+		//Moves the line on top, dropping the least recent one of a full stack
+		if (distance == depth && depth < STACKDISTANCE_MAXWAYS)
+			depths[k][set]++;
+		else if (distance == STACKDISTANCE_MAXWAYS)
+			distance--;
+		for (; distance > 0; distance--)
+			stack[distance] = stack[distance - 1];
+		stack[0] = line;
+	}
+}
+
+unsigned long long StackDistance::getAccesses(){
+	return accesses;
+}
+
+unsigned long long StackDistance::getDistinctLines(){
+	return lastAccess.size();
+}
+
+unsigned long long StackDistance::getMisses(unsigned int lines){
+	return getMisses(1, lines);
+}
+
+unsigned long long StackDistance::getMisses(unsigned int sets, unsigned int ways){
+	int k = 0;
+	while ((1u << k) < sets)
+		k++;
+	//Every first access misses
+	unsigned long long misses = lastAccess.size();
+	const vector<unsigned long long>& counts = histogram[k];
+	for (unsigned int distance = ways; distance < counts.size(); distance++)
+		misses += counts[distance];
+	return misses;
+}
+
+void StackDistance::writeReport(ostream& out){
+	unsigned int lineBytes = 1 << lineBits;
+	unsigned long long lines = lastAccess.size();
+	double total = accesses ? accesses : 1;
+
+	out << "LRU stack distance analysis, " << lineBytes << "-byte lines" << endl;
+	out << "Accesses: " << accesses << endl;
+	out << "Distinct lines: " << lines << " (" << lines*lineBytes << " bytes)" << endl;
+	out << "Compulsory miss ratio: " << fixed << setprecision(6) << lines / total << endl;
+
+	//Smallest fully associative caches keeping most of the reuses
+	unsigned long long reuses = accesses - lines;
+	const double fractions[] = {0.5, 0.9, 0.99};
+	for (int f = 0; f < 3; f++){
+		unsigned long long hits = 0;
+		unsigned int size = 0;
+		while (size < histogram[0].size() && hits < fractions[f]*reuses)
+			hits += histogram[0][size++];
+		out << "Working set for " << setprecision(0) << fractions[f]*100 << "% of the reuses: " << size << " lines ("
+			<< (unsigned long long) size*lineBytes << " bytes)" << endl;
+	}
+
+	out << endl << "Fully associative LRU" << endl;
+	out << setw(12) << "lines" << setw(14) << "bytes" << setw(14) << "miss ratio" << endl;
+	for (unsigned long long size = 1; ; size *= 2){
+		out << setw(12) << size << setw(14) << size*lineBytes << setw(14) << setprecision(6)
+			<< getMisses(size) / total << endl;
+		if (size >= lines)
+			break;
+	}
+
+	out << endl << "Set associative LRU, miss ratio by number of sets and ways" << endl;
+	out << setw(12) << "sets";
+	for (unsigned int ways = 1; ways <= STACKDISTANCE_MAXWAYS; ways *= 2)
+		out << setw(10) << ways;
+	out << endl;
+	for (int k = 0; k <= STACKDISTANCE_MAXSETBITS; k++){
+		out << setw(12) << (1u << k);
+		for (unsigned int ways = 1; ways <= STACKDISTANCE_MAXWAYS; ways *= 2)
+			out << setw(10) << setprecision(6) << getMisses(1u << k, ways) / total;
+		out << endl;
+	}
+	out.unsetf(ios::floatfield);
+}
@@ -0,0 +1,61 @@
+#include <lib/symbolTable.h>
+#include <algorithm>
+#include <stdlib.h>
+
+using namespace std;
+
+SymbolTable::SymbolTable(ElfFile* elfFile){
+	if (elfFile->symbols->empty())
+		return;
+
+	unsigned char* names = elfFile->sectionTable->at(elfFile->indexOfSymbolNameSection)->getSectionCode();
+	for (unsigned int oneSymbol = 0; oneSymbol < elfFile->symbols->size(); oneSymbol++){
+		ElfSymbol *symbol = elfFile->symbols->at(oneSymbol);
+		if (symbol->name == 0 || symbol->section == SHN_UNDEF || symbol->section == SHN_ABS)
+			continue;
+
+		SymbolRange range;
+		range.start = symbol->offset;
+		range.end = symbol->offset + symbol->size;
+		range.name = string((const char*) &names[symbol->name]);
+		//Local labels of the assembler are not functions
+		if (range.name.compare(0, 2, ".L") == 0 || range.name[0] == '$')
+			continue;
+		if (symbol->type == STT_FUNC || (symbol->type == STT_NOTYPE && symbol->size == 0))
+			functions.push_back(range);
+		else if (symbol->type == STT_OBJECT && symbol->size != 0)
+			objects.push_back(range);
+	}
+	free(names);
+
+	sort(functions.begin(), functions.end());
+	sort(objects.begin(), objects.end());
+
+	//Labels without a size, like _start, cover the code up to the next function
+	for (unsigned int i = 0; i < functions.size(); i++){
+		if (functions[i].end == functions[i].start)
+			functions[i].end = i + 1 < functions.size() ? functions[i + 1].start : functions[i].start + 1;
+	}
+}
+
+const char* SymbolTable::find(const vector<SymbolRange>& ranges, unsigned int address){
+	SymbolRange key;
+	key.start = address;
+	vector<SymbolRange>::const_iterator next = upper_bound(ranges.begin(), ranges.end(), key);
+
+	//Ranges may nest, the closest start containing the address wins
+	for (int steps = 0; steps < 16 && next != ranges.begin(); steps++){
+		--next;
+		if (address < next->end)
+			return next->name.c_str();
+	}
+	return NULL;
+}
+
+const char* SymbolTable::getFunction(unsigned int address) const{
+	return find(functions, address);
+}
+
+const char* SymbolTable::getObject(unsigned int address) const{
+	return find(objects, address);
+}
@@ -0,0 +1,131 @@
+// vim: set ts=4 nu ai:
+#ifndef BRANCHPREDICTOR_H
+#define BRANCHPREDICTOR_H
+
+#include <portability.h>
+
+#define PREDICTOR_MAXTABLEBITS 16
+#define PREDICTOR_MAXHISTORYBITS 16
+#define PREDICTOR_MAXBTB 4096
+#define PREDICTOR_MAXRAS 32
+#define PREDICTOR_KINDS 5
+
+enum PredictorType{
+	NO_PREDICTOR,
+	NOTTAKEN_PREDICTOR,
+	BTFN_PREDICTOR,
+	BIMODAL_PREDICTOR,
+	GSHARE_PREDICTOR,
+	TOURNAMENT_PREDICTOR
+};
+
+//Classes of instructions, as predecoded by the fetch stage
+enum BranchKind{
+	NOT_BRANCH,
+	CONDITIONAL_BRANCH,
+	DIRECT_JUMP, //JAL
+	RETURN_JUMP, //JALR reading the link register
+	INDIRECT_JUMP //Other JALR
+};
+
+//Disabled by default, the fetch stage then always goes on with pc + 4
+struct PredictorConfig{
+	int type;
+	int tableBits; //Of the pattern history tables and of the chooser
+	int historyBits; //Of the global history
+	int btbEntries;
+	int rasEntries; //0 for none, returns then use the BTB
+
+	PredictorConfig() : type(NO_PREDICTOR), tableBits(10), historyBits(10), btbEntries(64), rasEntries(8){}
+};
+
+//What Ft guessed for an instruction, it goes down the pipeline with it
+struct branch_prediction{
+	CORE_UINT(3) kind;
+	CORE_UINT(1) taken;
+	CORE_UINT(32) target;
+	CORE_UINT(16) history; //Global history before the prediction
+	CORE_UINT(6) rasTop; //Return stack after the prediction
+	CORE_UINT(6) rasCount;
+};
+
+struct btb_entry{
+	CORE_UINT(32) pc;
+	CORE_UINT(32) target;
+	CORE_UINT(1) valid;
+};
+
+/*********************************************************
+ * 	Branch prediction
+ *
+ * 	Ft calls predict() on every instruction it fetches and
+ * 	goes on with the address it returns. A control
+ * 	instruction is predicted taken only when the BTB, a
+ * 	direct mapped table tagged by the PC, knows its target,
+ * 	or for a return when the return address stack is not
+ * 	empty. The direction of the conditional branches is
+ *
+ * 	nottaken	never taken, the timing of the original core
+ * 	btfn		taken when the offset is negative
+ * 	bimodal		2-bit counters indexed by the PC
+ * 	gshare		2-bit counters indexed by the PC xor the
+ * 				global history
+ * 	tournament	both, a table of 2-bit counters indexed by
+ * 				the PC choosing between them
+ *
+ * 	Ex compares the outcome with the prediction. A wrong
+ * 	one flushes the two younger instructions as every taken
+ * 	branch does without a predictor, and Ft calls recover()
+ * 	to restore the global history and the return stack,
+ * 	which are updated speculatively at fetch. The tables and
+ * 	the BTB are trained by update() when the instruction
+ * 	leaves do_Mem on the correct path.
+ *********************************************************/
+class BranchPredictor{
+
+	private:
+		PredictorConfig config;
+		CORE_UINT(2)* bimodal; //[1 << tableBits]
+		CORE_UINT(2)* gshare; //[1 << tableBits]
+		CORE_UINT(2)* chooser; //[1 << tableBits], 2 and 3 select gshare
+		btb_entry* btb; //[btbEntries]
+		CORE_UINT(32) ras[PREDICTOR_MAXRAS];
+		CORE_UINT(6) rasTop;
+		CORE_UINT(6) rasCount;
+		CORE_UINT(16) history;
+
+		//data structures to collect statistics
+		CORE_UINT(32) n_branches[PREDICTOR_KINDS];
+		CORE_UINT(32) n_mispredicted[PREDICTOR_KINDS];
+
+		int getIndex(CORE_UINT(32) pc);
+		int getGshareIndex(CORE_UINT(32) pc, CORE_UINT(16) history);
+		bool predictDirection(CORE_UINT(32) pc, bool backward, CORE_UINT(16) history);
+
+		BranchPredictor(const BranchPredictor&);
+		BranchPredictor& operator=(const BranchPredictor&);
+
+	public:
+		//Allocates nothing when config.type is NO_PREDICTOR
+		BranchPredictor(PredictorConfig config = PredictorConfig());
+		~BranchPredictor();
+
+		bool isEnabled();
+		const char* getName();
+
+		//Returns the address to fetch after the instruction at pc
+		CORE_UINT(32) predict(CORE_UINT(32) pc, CORE_UINT(32) instruction, branch_prediction* prediction);
+		//Same from the predecoded instruction: its BranchKind, whether it writes a link register and,
+		//for a branch, whether its offset is negative. Used to replay branch traces.
+		CORE_UINT(32) predict(CORE_UINT(32) pc, int kind, bool call, bool backward, branch_prediction* prediction);
+		//The instruction of prediction was mispredicted, taken is its outcome
+		void recover(const branch_prediction& prediction, bool taken);
+		void update(CORE_UINT(32) pc, const branch_prediction& prediction, bool taken, CORE_UINT(32) target,
+				bool mispredicted);
+
+		//Control instructions of each BranchKind on the correct path, and those mispredicted
+		CORE_UINT(32) getNumberBranches(int kind);
+		CORE_UINT(32) getNumberMispredicted(int kind);
+};
+
+#endif /* BRANCHPREDICTOR_H */
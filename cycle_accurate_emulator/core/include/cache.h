@@ -4,25 +4,463 @@
 
 #include <portability.h>
 #include <dram.h>
-#define SETS 64
-#define SETBITS 6 // log2(SETS)
-#define LATENCY 30
+#include <memorylevel.h>
+#include <prefetcher.h>
+#include <missclassifier.h>
+#include <missprofile.h>
+#include <lib/stackDistance.h>
+#include <assert.h>
 #define CACHEBLOCKBYTES 64
-#define IDBITS 6 // log2(CACHEBLOCKBYTES)
-#define TAGBITS 20 // 32 - SETBITS - IDBITS
 
+/*********************************************************
+ * 	Cache geometry
+ *
+ * 	Both caches are instances of the Cache template below.
+ * 	A template parameter equal to CACHE_DYNAMIC is taken
+ * 	from the CacheConfig given at construction, which is
+ * 	how catapult.sim configures its caches at startup (see
+ * 	config.h). They can still be fixed at compile time, for
+ * 	instance with
+ * 		make CFLAGS="-std=c++11 -D DCACHE_WAYS=4 -D DCACHE_POLICY=PlruPolicy"
+ *********************************************************/
+#define CACHE_DYNAMIC 0
+#define CACHE_MAXWAYS 128
+#define CACHE_MAXMSHRS 32
+#define CACHE_MAXWRITEBUFFER 32
+#define CACHE_WRITEBUFFERIDLE 32 //Cycles without a write before the last write buffer entry drains
+#define CACHE_MAXVICTIMS 16
+#define PREFETCH_QUEUESIZE 16
+#define PREFETCH_FILTERSIZE 256 //Lines evicted by a prefetch, to count the polluting ones
+
+#ifndef DCACHE_SETS
+#define DCACHE_SETS CACHE_DYNAMIC
+#endif
+#ifndef DCACHE_WAYS
+#define DCACHE_WAYS CACHE_DYNAMIC
+#endif
+#ifndef DCACHE_LINEBYTES
+#define DCACHE_LINEBYTES CACHE_DYNAMIC
+#endif
+#ifndef DCACHE_POLICY
+#define DCACHE_POLICY ConfigurablePolicy
+#endif
+
+#ifndef ICACHE_SETS
+#define ICACHE_SETS CACHE_DYNAMIC
+#endif
+#ifndef ICACHE_WAYS
+#define ICACHE_WAYS CACHE_DYNAMIC
+#endif
+#ifndef ICACHE_LINEBYTES
+#define ICACHE_LINEBYTES CACHE_DYNAMIC
+#endif
+#ifndef ICACHE_POLICY
+#define ICACHE_POLICY ConfigurablePolicy
+#endif
+
+enum ReplacementPolicy{
+	LRU_POLICY,
+	PLRU_POLICY,
+	FIFO_POLICY,
+	RANDOM_POLICY
+};
+
+enum WritePolicy{
+	WRITE_BACK,
+	WRITE_THROUGH
+};
+
+//Runtime geometry, the default is the 64 sets direct mapped write-back, write-allocate cache
+struct CacheConfig{
+	int sets;
+	int ways;
+	int lineBytes;
+	int policy;
+	int mshrs; //0 for a blocking cache
+	int prefetcher; //PrefetcherType
+	int prefetchDegree;
+	int prefetchStreams;
+	int writePolicy;
+	int writeAllocate;
+	int writeBuffer; //Entries, 0 writes synchronously
+	int victimLines; //Of the fully associative victim cache, 0 for none
+	int victimLatency; //Cycles of a victim cache hit
+	int classifyMisses; //Runs the shadow caches of the 3C classification
+
+	CacheConfig() : sets(64), ways(1), lineBytes(CACHEBLOCKBYTES), policy(LRU_POLICY), mshrs(0),
+		prefetcher(NO_PREFETCHER), prefetchDegree(2), prefetchStreams(4), writePolicy(WRITE_BACK),
+		writeAllocate(1), writeBuffer(0), victimLines(0), victimLatency(2), classifyMisses(0){}
+};
+
+template<int N> struct Log2{
+	enum { value = 1 + Log2<N / 2>::value };
+};
+
+template<> struct Log2<1>{
+	enum { value = 0 };
+};
+
+template<> struct Log2<CACHE_DYNAMIC>{
+	enum { value = 0 };
+};
+
+//Miss status holding register: a line being brought from the DRAM
+struct cache_mshr{
+	CORE_UINT(32) line;
+	CORE_UINT(32) ready; //Cycle at which the data is available
+	CORE_UINT(1) valid;
+};
+
+//Write buffer entry: the bytes of a line waiting to be written to the next level
+struct cache_wbentry{
+	CORE_UINT(32) line;
+	CORE_UINT(8)* data; //[lineBytes]
+	CORE_UINT(1)* valid; //[lineBytes]
+	CORE_UINT(32) lastWrite;
+};
+
+//Victim cache entry: a line recently evicted from the cache
+struct cache_victim{
+	CORE_UINT(32) line;
+	CORE_UINT(1) dirtybit;
+	CORE_UINT(1) valid;
+};
+
+template<int TAGBITS>
 struct cache_index{
 	CORE_UINT(TAGBITS) tag;
 	CORE_UINT(1) dirtybit;
 	CORE_UINT(1) invalid;
+	CORE_UINT(1) prefetched; //Brought by a prefetch and not used yet
+	CORE_UINT(32) ready; //Cycle at which the data of a prefetched line is available
+};
+
+/*********************************************************
+ * 	Replacement policies
+ *
+ * 	A policy object holds the replacement state of one set.
+ * 	touch() is called on every hit, insert() when a line is
+ * 	filled and victim() gives the way to evict when all the
+ * 	ways of the set are valid. configure() resets the state
+ * 	and gives the number of ways when WAYS is CACHE_DYNAMIC.
+ *********************************************************/
+
+//True LRU: the age of each way, 0 being the most recently used
+template<int WAYS>
+class LruPolicy{
+	private:
+		CORE_UINT(8) age[WAYS ? WAYS : CACHE_MAXWAYS];
+		int ways;
+
+	public:
+		LruPolicy(){
+			configure(WAYS ? WAYS : 1, LRU_POLICY);
+		}
+
+		void configure(int ways, int policy){
+			this->ways = WAYS ? WAYS : ways;
+			for(int i=0;i<this->ways;i++)
+				age[i] = i;
+		}
+
+		void touch(int way){
+			for(int i=0;i<ways;i++){
+				if(age[i] < age[way])
+					age[i]++;
+			}
+			age[way] = 0;
+		}
+
+		void insert(int way){
+			touch(way);
+		}
+
+		int victim(){
+			for(int i=0;i<ways;i++){
+				if(age[i] == ways-1)
+					return i;
+			}
+			return 0;
+		}
+};
+
+//Tree pseudo-LRU: node n has its children at 2n and 2n+1, each bit points to the side to evict
+template<int WAYS>
+class PlruPolicy{
+	private:
+		CORE_UINT(1) tree[WAYS ? WAYS : CACHE_MAXWAYS];
+		int ways;
+		int levels;
+
+	public:
+		PlruPolicy(){
+			configure(WAYS ? WAYS : 1, PLRU_POLICY);
+		}
+
+		void configure(int ways, int policy){
+			this->ways = WAYS ? WAYS : ways;
+			levels = 0;
+			while((1 << levels) < this->ways)
+				levels++;
+			for(int i=0;i<this->ways;i++)
+				tree[i] = 0;
+		}
+
+		void touch(int way){
+			int node = 1;
+			for(int level=levels-1;level>=0;level--){
+				int side = (way >> level) & 1;
+				tree[node] = 1 - side;
+				node = 2*node + side;
+			}
+		}
+
+		void insert(int way){
+			touch(way);
+		}
+
+		int victim(){
+			int node = 1;
+			while(node < ways)
+				node = 2*node + (tree[node] ? 1 : 0);
+			return node - ways;
+		}
 };
 
-class Cache{
+//FIFO: lines are evicted in the order they were filled
+template<int WAYS>
+class FifoPolicy{
+	private:
+		CORE_UINT(8) next;
+		int ways;
+
+	public:
+		FifoPolicy(){
+			configure(WAYS ? WAYS : 1, FIFO_POLICY);
+		}
+
+		void configure(int ways, int policy){
+			this->ways = WAYS ? WAYS : ways;
+			next = 0;
+		}
 
+		void touch(int way){
+		}
+
+		void insert(int way){
+			next = (way + 1) % ways;
+		}
+
+		int victim(){
+			return next.to_int();
+		}
+};
+
+//Random: a 16 bits LFSR per set, so that runs are reproducible
+template<int WAYS>
+class RandomPolicy{
 	private:
-		cache_index index[SETS];
-		CORE_UINT(8) cache[SETS][CACHEBLOCKBYTES];
-		Dram* dram_location;
+		CORE_UINT(16) lfsr;
+		int ways;
+
+	public:
+		RandomPolicy(){
+			configure(WAYS ? WAYS : 1, RANDOM_POLICY);
+		}
+
+		void configure(int ways, int policy){
+			this->ways = WAYS ? WAYS : ways;
+			lfsr = 0xace1;
+		}
+
+		void touch(int way){
+		}
+
+		void insert(int way){
+			CORE_UINT(1) lsb = lfsr[0];
+			lfsr = lfsr >> 1;
+			if(lsb)
+				lfsr = lfsr ^ 0xb400;
+		}
+
+		int victim(){
+			return (lfsr % ways).to_int();
+		}
+};
+
+//One of the policies above, chosen at runtime by the ReplacementPolicy given to configure()
+template<int WAYS>
+class ConfigurablePolicy{
+	private:
+		LruPolicy<WAYS> lru;
+		PlruPolicy<WAYS> plru;
+		FifoPolicy<WAYS> fifo;
+		RandomPolicy<WAYS> random;
+		int policy;
+
+	public:
+		ConfigurablePolicy(){
+			policy = LRU_POLICY;
+		}
+
+		void configure(int ways, int policy){
+			this->policy = policy;
+			switch(policy){
+				case PLRU_POLICY:
+					plru.configure(ways, policy);
+					break;
+				case FIFO_POLICY:
+					fifo.configure(ways, policy);
+					break;
+				case RANDOM_POLICY:
+					random.configure(ways, policy);
+					break;
+				default:
+					lru.configure(ways, policy);
+					break;
+			}
+		}
+
+		void touch(int way){
+			switch(policy){
+				case PLRU_POLICY:
+					plru.touch(way);
+					break;
+				case FIFO_POLICY:
+					fifo.touch(way);
+					break;
+				case RANDOM_POLICY:
+					random.touch(way);
+					break;
+				default:
+					lru.touch(way);
+					break;
+			}
+		}
+
+		void insert(int way){
+			switch(policy){
+				case PLRU_POLICY:
+					plru.insert(way);
+					break;
+				case FIFO_POLICY:
+					fifo.insert(way);
+					break;
+				case RANDOM_POLICY:
+					random.insert(way);
+					break;
+				default:
+					lru.insert(way);
+					break;
+			}
+		}
+
+		int victim(){
+			switch(policy){
+				case PLRU_POLICY:
+					return plru.victim();
+				case FIFO_POLICY:
+					return fifo.victim();
+				case RANDOM_POLICY:
+					return random.victim();
+				default:
+					return lru.victim();
+			}
+		}
+};
+
+/*********************************************************
+ * 	Set associative write-back, write-allocate cache
+ *
+ * 	cache_miss is set to 1 on a miss and to 2 when the
+ * 	miss also writes back a dirty line to the DRAM. It is
+ * 	left untouched on a hit.
+ *
+ * 	The content of the cache is always updated when it is
+ * 	accessed, the MSHRs only model when the data of a miss
+ * 	comes back. With MSHRs, the pipeline keeps running on a
+ * 	miss: an access to a line which is still in flight
+ * 	waits for the same MSHR, and a miss which finds all the
+ * 	MSHRs busy is issued when the first one is freed.
+ *
+ * 	The prefetches proposed by the prefetcher wait in a
+ * 	queue and are issued, one at a time, when the DRAM data
+ * 	bus is not transferring a demand miss or another
+ * 	prefetch. A demand miss waits for the transfer in
+ * 	progress, so that outstanding misses and prefetches
+ * 	are bounded by the bandwidth of the DRAM.
+ * 	The first demand access to a prefetched line counts it
+ * 	as useful, or as late if its data is not there yet.
+ * 	A demand miss on a line evicted by a prefetch counts
+ * 	that prefetch as polluting.
+ *
+ * 	The optional victim cache is a small fully associative
+ * 	LRU buffer holding the lines evicted from the cache. It
+ * 	is probed on a miss: a hit swaps its line with the one
+ * 	the cache evicts, in the victim latency, and only the
+ * 	lines leaving the victim cache go to the next level.
+ *
+ * 	The misses can be classified as compulsory, capacity or
+ * 	conflict misses by a MissClassifier which sees all the
+ * 	demand accesses. A hit in the victim cache or in the
+ * 	stream buffers is not a miss. A MissProfile attributes
+ * 	the misses to the PC given with the access, and a
+ * 	StackDistance analysis receives the address of every
+ * 	demand access.
+ *********************************************************/
+template<int SETS, int WAYS, int LINEBYTES, template<int> class POLICY>
+class Cache : public UpperCache{
+
+	public:
+		//Tags are kept on 32 bits when the geometry is only known at runtime
+		static const int TAGBITS = (SETS == CACHE_DYNAMIC || LINEBYTES == CACHE_DYNAMIC) ? 32 :
+				32 - Log2<SETS>::value - Log2<LINEBYTES>::value;
+
+	private:
+		int sets;
+		int ways;
+		int lineBytes;
+		int setBits;
+		int idBits;
+
+		cache_index<TAGBITS>* index; //[sets][ways]
+		CORE_UINT(8)* cache; //[sets][ways][lineBytes]
+		POLICY<WAYS>* policy; //[sets]
+		MemoryLevel* next_level; //The DRAM or the L2
+
+		int mshrs;
+		cache_mshr mshr[CACHE_MAXMSHRS];
+
+		CORE_UINT(32) cycle;
+		int latency; //Of the last access
+		bool writeback; //Set by fill when the victim was dirty
+		int fillCycles; //Taken by the next level to provide the line of the last fill
+		int writebackCycles; //And to take its dirty victim
+		int writeStall; //Cycles the last store waited to hand its data over
+
+		int writePolicy;
+		int writeAllocate;
+		int writeBufferSize;
+		cache_wbentry writeBuffer[CACHE_MAXWRITEBUFFER]; //Oldest first
+		int writeBufferCount;
+
+		int victimLines;
+		int victimLatency;
+		cache_victim victims[CACHE_MAXVICTIMS];
+		CORE_UINT(8)* victimCache; //[victimLines][lineBytes]
+		LruPolicy<CACHE_DYNAMIC> victimPolicy;
+
+		MissClassifier* classifier;
+		MissProfile* profile;
+		StackDistance* reuse;
+
+		Prefetcher* prefetcher;
+		CORE_UINT(32) prefetchQueue[PREFETCH_QUEUESIZE];
+		int queueHead;
+		int queueCount;
+		CORE_UINT(32) dramFree; //Cycle at which the DRAM data bus can take a prefetch
+		CORE_UINT(32) evicted[PREFETCH_FILTERSIZE];
+		CORE_UINT(1) evictedValid[PREFETCH_FILTERSIZE];
 
 		//data structures to collect statistics
 		CORE_UINT(32) n_cache_miss;
@@ -30,20 +468,108 @@ class Cache{
 		CORE_UINT(32) n_store;
 		CORE_UINT(32) n_dram_writes;
 		CORE_UINT(32) n_dram_reads;
+		CORE_UINT(32) n_mshr_merges;
+		CORE_UINT(32) n_mshr_full;
+		CORE_UINT(64) n_outstanding; //Sum over the cycles of the number of outstanding misses
+		CORE_UINT(32) n_miss_cycles; //Cycles with at least one outstanding miss
+		CORE_UINT(32) n_prefetch_issued;
+		CORE_UINT(32) n_prefetch_useful;
+		CORE_UINT(32) n_prefetch_late;
+		CORE_UINT(32) n_prefetch_polluting;
+		CORE_UINT(32) n_prefetch_unused; //Evicted before any demand access
+		CORE_UINT(32) n_write_through; //Stores sent to the next level, by write-through or no-write-allocate
+		CORE_UINT(32) n_wb_merges;
+		CORE_UINT(32) n_wb_full;
+		CORE_UINT(32) n_victim_probes;
+		CORE_UINT(32) n_victim_hits;
+
+		int findWay(int set, CORE_UINT(TAGBITS) tag);
+		int chooseWay(int set);
+		void evict(int set, int way, CORE_UINT(32) issue);
+		int findVictim(CORE_UINT(32) lineAddress);
+		int swapVictim(int set, CORE_UINT(TAGBITS) tag, int entry);
+		int fill(int set, CORE_UINT(TAGBITS) tag, bool prefetch, CORE_UINT(32) issue);
+		int access(CORE_UINT(32) address, CORE_UINT(2)* cache_miss, CORE_UINT(32) pc);
+		int getFillBusy();
+		int bufferWrite(CORE_UINT(32) address, CORE_UINT(8)* data, int bytes, CORE_UINT(32) issue);
+		int drainWrite(CORE_UINT(32) issue);
+		void enqueuePrefetch(CORE_UINT(32) address);
+		void issuePrefetch();
+
+		Cache(const Cache&);
+		Cache& operator=(const Cache&);
 
 	public:
-		//Instantiate cache with pointer to DRAM object
-		Cache(Dram* dram);
+		//Instantiate cache with pointer to the level it fills from
+		Cache(MemoryLevel* next, CacheConfig config = CacheConfig());
+		~Cache();
+
+		//pc is the address of the memory instruction, used by the prefetchers
+		void store(CORE_UINT(32) address, CORE_INT(32) value, CORE_UINT(2) op, CORE_UINT(2)* cache_miss,
+				CORE_UINT(32) pc = 0);
+
+		CORE_INT(32) load(CORE_UINT(32) address, CORE_UINT(2) op, CORE_UINT(1) sign, CORE_UINT(2)* cache_miss,
+				CORE_UINT(32) pc = 0);
+
+		CORE_UINT(TAGBITS) getTag(CORE_UINT(32) address){
+			return address >> (idBits + setBits);
+		}
+
+		int getSet(CORE_UINT(32) address){
+			return ((address >> idBits) & (sets - 1)).to_int();
+		}
+
+		int getId(CORE_UINT(32) address){
+			return (address & (lineBytes - 1)).to_int();
+		}
+
+		int getLineBytes();
+		bool invalidateLine(CORE_UINT(32) address, CORE_UINT(8)* data);
+
+		//Cycles before the data of the last access is available, 0 on a hit
+		int getLatency();
+		//Part of it spent by the last store writing through or waiting for the write buffer
+		int getWriteStall();
+
+		//True if the access would hit, without changing the state of the cache
+		bool probe(CORE_UINT(32) address);
+
+		int getMshrs();
+		//Called once per cycle: frees the MSHRs whose data came back and issues a prefetch
+		void tick(CORE_UINT(32) cycle);
+		//Cycle at which the line of address is available if it is in flight, 0 otherwise
+		CORE_UINT(32) getPendingReady(CORE_UINT(32) address);
+		//Records a miss issued at cycle, returns the cycle at which it was actually issued
+		CORE_UINT(32) allocateMshr(CORE_UINT(32) address, CORE_UINT(32) cycle, int penalty);
+
+		CORE_UINT(32) getNumberMshrMerges();
+		CORE_UINT(32) getNumberMshrFull();
+		CORE_UINT(64) getNumberOutstanding();
+		CORE_UINT(32) getNumberMissCycles();
+
+		bool hasPrefetcher();
+		CORE_UINT(32) getNumberPrefetchIssued();
+		CORE_UINT(32) getNumberPrefetchUseful();
+		CORE_UINT(32) getNumberPrefetchLate();
+		CORE_UINT(32) getNumberPrefetchPolluting();
+		CORE_UINT(32) getNumberPrefetchUnused();
 
-		void store(CORE_UINT(32) address, CORE_INT(32) value, CORE_UINT(2) op, CORE_UINT(2)* cache_miss);
-			
-		CORE_INT(32) load(CORE_UINT(32) address, CORE_UINT(2) op, CORE_UINT(1) sign, CORE_UINT(2)* cache_miss);
+		int getWriteBufferSize();
+		CORE_UINT(32) getNumberWriteThrough();
+		CORE_UINT(32) getNumberWriteBufferMerges();
+		CORE_UINT(32) getNumberWriteBufferFull();
 
-		CORE_UINT(TAGBITS) getTag(CORE_UINT(32) address);
-		
-		CORE_UINT(SETBITS) getSet(CORE_UINT(32) address);
+		int getVictimLines();
+		//Misses of the cache which looked up the victim cache, and those it served
+		CORE_UINT(32) getNumberVictimProbes();
+		CORE_UINT(32) getNumberVictimHits();
 
-		CORE_UINT(IDBITS) getId(CORE_UINT(32) address);
+		//NULL when the misses are not classified
+		MissClassifier* getMissClassifier();
+		//The profile is owned by the caller, NULL stops the attribution
+		void setMissProfile(MissProfile* profile);
+		//Same for the stack distance analysis
+		void setStackDistance(StackDistance* reuse);
 
 		CORE_UINT(32) getNumberCacheMiss();
 		CORE_UINT(32) getNumberDramReads();
@@ -53,5 +579,845 @@ class Cache{
 
 };
 
+typedef Cache<DCACHE_SETS, DCACHE_WAYS, DCACHE_LINEBYTES, DCACHE_POLICY> DataCache;
+typedef Cache<ICACHE_SETS, ICACHE_WAYS, ICACHE_LINEBYTES, ICACHE_POLICY> InstructionCache;
+
+#define CACHE_TEMPLATE template<int SETS, int WAYS, int LINEBYTES, template<int> class POLICY>
+#define CACHE_CLASS Cache<SETS, WAYS, LINEBYTES, POLICY>
+
+CACHE_TEMPLATE
+CACHE_CLASS::Cache(MemoryLevel* next, CacheConfig config){
+	sets = SETS ? SETS : config.sets;
+	ways = WAYS ? WAYS : config.ways;
+	lineBytes = LINEBYTES ? LINEBYTES : config.lineBytes;
+	setBits = 0;
+	while((1 << setBits) < sets)
+		setBits++;
+	idBits = 0;
+	while((1 << idBits) < lineBytes)
+		idBits++;
+
+	assert(1 << setBits == sets);
+	assert(1 << idBits == lineBytes && lineBytes >= 4);
+	assert((ways & (ways - 1)) == 0 && ways <= CACHE_MAXWAYS);
+	assert(TAGBITS == 32 || TAGBITS == 32 - setBits - idBits);
+
+	next_level = next;
+	n_cache_miss = 0;
+	n_load = 0;
+	n_store = 0;
+	n_dram_writes = 0;
+	n_dram_reads = 0;
+	n_mshr_merges = 0;
+	n_mshr_full = 0;
+	n_outstanding = 0;
+	n_miss_cycles = 0;
+	n_prefetch_issued = 0;
+	n_prefetch_useful = 0;
+	n_prefetch_late = 0;
+	n_prefetch_polluting = 0;
+	n_prefetch_unused = 0;
+	n_write_through = 0;
+	n_wb_merges = 0;
+	n_wb_full = 0;
+	n_victim_probes = 0;
+	n_victim_hits = 0;
+
+	cycle = 0;
+	latency = 0;
+	writeback = false;
+	fillCycles = 0;
+	writebackCycles = 0;
+	writeStall = 0;
+	prefetcher = createPrefetcher(config.prefetcher, lineBytes, config.prefetchDegree, config.prefetchStreams);
+	queueHead = 0;
+	queueCount = 0;
+	dramFree = 0;
+	for(int f=0;f<PREFETCH_FILTERSIZE;f++)
+		evictedValid[f] = 0;
+
+	writePolicy = config.writePolicy;
+	writeAllocate = config.writeAllocate;
+	writeBufferSize = config.writeBuffer;
+	writeBufferCount = 0;
+	assert(writeBufferSize >= 0 && writeBufferSize <= CACHE_MAXWRITEBUFFER);
+	for(int e=0;e<writeBufferSize;e++){
+		writeBuffer[e].data = new CORE_UINT(8)[lineBytes];
+		writeBuffer[e].valid = new CORE_UINT(1)[lineBytes];
+	}
+
+	victimLines = config.victimLines;
+	victimLatency = config.victimLatency;
+	assert(victimLines >= 0 && victimLines <= CACHE_MAXVICTIMS);
+	victimCache = victimLines ? new CORE_UINT(8)[victimLines*lineBytes] : NULL;
+	for(int v=0;v<CACHE_MAXVICTIMS;v++)
+		victims[v].valid = 0;
+	if(victimLines)
+		victimPolicy.configure(victimLines, LRU_POLICY);
+	classifier = config.classifyMisses ? new MissClassifier(sets*ways) : NULL;
+	profile = NULL;
+	reuse = NULL;
+
+	mshrs = config.mshrs;
+	assert(mshrs >= 0 && mshrs <= CACHE_MAXMSHRS);
+	for(int m=0;m<CACHE_MAXMSHRS;m++)
+		mshr[m].valid = 0;
+
+	//Loads always read 4 bytes from the offset in the line, the last line is padded for them
+	index = new cache_index<TAGBITS>[sets*ways];
+	cache = new CORE_UINT(8)[sets*ways*lineBytes + 4];
+	policy = new POLICY<WAYS>[sets];
+	int i =0,j=0;
+	for(i=0;i<sets*ways*lineBytes + 4;i++){
+		cache[i] = 0;
+	}
+	for(i=0;i<sets;i++){
+		for(j=0;j<ways;j++){
+			index[i*ways + j].tag = 0;
+			index[i*ways + j].dirtybit=0;
+			index[i*ways + j].invalid = 1;
+			index[i*ways + j].prefetched = 0;
+		}
+		policy[i].configure(ways, config.policy);
+	}
+}
+
+CACHE_TEMPLATE
+CACHE_CLASS::~Cache(){
+	delete[] index;
+	delete[] cache;
+	delete[] policy;
+	delete prefetcher;
+	delete[] victimCache;
+	delete classifier;
+	for(int e=0;e<writeBufferSize;e++){
+		delete[] writeBuffer[e].data;
+		delete[] writeBuffer[e].valid;
+	}
+}
+
+//Returns the way holding tag, -1 on a miss
+CACHE_TEMPLATE
+int CACHE_CLASS::findWay(int set, CORE_UINT(TAGBITS) tag){
+	for(int way=0;way<ways;way++){
+		cache_index<TAGBITS>& line = index[set*ways + way];
+		if(line.invalid == 0 && line.tag == tag)
+			return way;
+	}
+	return -1;
+}
+
+//Returns an invalid way of the set, or the victim of the policy
+CACHE_TEMPLATE
+int CACHE_CLASS::chooseWay(int set){
+	for(int way=0;way<ways;way++){
+		if(index[set*ways + way].invalid)
+			return way;
+	}
+	return policy[set].victim();
+}
+
+//Moves the line out of the way, into the victim cache when there is one. The line leaving the
+//cache hierarchy is written back if dirty, a clean one is given to the next level, an exclusive
+//L2 keeps it. The transfers start at issue.
+CACHE_TEMPLATE
+void CACHE_CLASS::evict(int set, int way, CORE_UINT(32) issue){
+	cache_index<TAGBITS>& line = index[set*ways + way];
+	CORE_UINT(8)* data = cache + (set*ways + way)*lineBytes;
+	CORE_UINT(32) address = line.tag;
+	address = (address << (setBits + idBits)) | (set << idBits);
+	bool dirty = line.dirtybit;
+	writeback = false;
+	writebackCycles = 0;
+	if(line.invalid)
+		return;
+
+	if(victimLines){
+		int entry = -1;
+		for(int v=0;v<victimLines && entry<0;v++){
+			if(!victims[v].valid)
+				entry = v;
+		}
+		if(entry < 0)
+			entry = victimPolicy.victim();
+		cache_victim& victim = victims[entry];
+		CORE_UINT(8)* victimData = victimCache + entry*lineBytes;
+		//The line displaced from the victim cache is the one leaving
+		if(victim.valid){
+			CORE_UINT(32) victimAddress = victim.line << idBits;
+			dirty = victim.dirtybit;
+			if(dirty)
+				writebackCycles = bufferWrite(victimAddress, victimData, lineBytes, issue);
+			else
+				next_level->evictLine(victimAddress, victimData, lineBytes, issue);
+		}
+		else
+			dirty = false;
+		for(int i=0;i<lineBytes;i++)
+			victimData[i] = data[i];
+		victim.line = address >> idBits;
+		victim.dirtybit = line.dirtybit;
+		victim.valid = 1;
+		victimPolicy.insert(entry);
+	}
+	else if(dirty)
+		writebackCycles = bufferWrite(address, data, lineBytes, issue);
+	else
+		next_level->evictLine(address, data, lineBytes, issue);
+	writeback = dirty;
+}
+
+//Returns the entry of the victim cache holding the line, -1 if none does
+CACHE_TEMPLATE
+int CACHE_CLASS::findVictim(CORE_UINT(32) lineAddress){
+	for(int v=0;v<victimLines;v++){
+		if(victims[v].valid && victims[v].line == lineAddress)
+			return v;
+	}
+	return -1;
+}
+
+//Brings the line of the victim cache entry back into the set, the line it replaces taking the entry
+CACHE_TEMPLATE
+int CACHE_CLASS::swapVictim(int set, CORE_UINT(TAGBITS) tag, int entry){
+	int way = chooseWay(set);
+	cache_index<TAGBITS>& line = index[set*ways + way];
+	CORE_UINT(8)* data = cache + (set*ways + way)*lineBytes;
+	cache_victim& victim = victims[entry];
+	CORE_UINT(8)* victimData = victimCache + entry*lineBytes;
+
+	for(int i=0;i<lineBytes;i++){
+		CORE_UINT(8) byte = data[i];
+		data[i] = victimData[i];
+		victimData[i] = byte;
+	}
+	CORE_UINT(1) dirty = victim.dirtybit;
+	if(line.invalid)
+		victim.valid = 0;
+	else{
+		if(line.prefetched)
+			n_prefetch_unused++;
+		victim.line = line.tag;
+		victim.line = (victim.line << setBits) | set;
+		victim.dirtybit = line.dirtybit;
+		victimPolicy.insert(entry);
+	}
+
+	line.tag = tag;
+	line.dirtybit = dirty;
+	line.invalid = 0;
+	line.prefetched = 0;
+	policy[set].insert(way);
+	return way;
+}
+
+//Brings the line into the way chosen by chooseWay, after evicting its line. The transfers start at issue.
+CACHE_TEMPLATE
+int CACHE_CLASS::fill(int set, CORE_UINT(TAGBITS) tag, bool prefetch, CORE_UINT(32) issue){
+	int way = chooseWay(set);
+
+	cache_index<TAGBITS>& line = index[set*ways + way];
+	CORE_UINT(8)* data = cache + (set*ways + way)*lineBytes;
+	CORE_UINT(32) dram_address;
+	if(!line.invalid){
+		if(line.prefetched)
+			n_prefetch_unused++;
+		else if(prefetch){
+			CORE_UINT(32) victim = line.tag;
+			victim = (victim << setBits) | set;
+			evicted[victim.to_int() % PREFETCH_FILTERSIZE] = victim;
+			evictedValid[victim.to_int() % PREFETCH_FILTERSIZE] = 1;
+		}
+	}
+	evict(set, way, issue);
+	dram_address = tag;
+	dram_address = (dram_address << (setBits + idBits)) | (set << idBits);
+	bool dirty;
+	fillCycles = next_level->readLine(dram_address, data, lineBytes, issue, &dirty);
+	//Bytes still in the write buffer are newer than the next level
+	for(int e=0;e<writeBufferCount;e++){
+		if(writeBuffer[e].line != (dram_address >> idBits))
+			continue;
+		for(int i=0;i<lineBytes;i++){
+			if(writeBuffer[e].valid[i])
+				data[i] = writeBuffer[e].data[i];
+		}
+	}
+
+	line.tag = tag;
+	line.dirtybit = dirty;
+	line.invalid = 0;
+	line.prefetched = prefetch;
+	policy[set].insert(way);
+	return way;
+}
+
+//Demand lookup shared by loads and stores, fills the line on a miss and returns its way
+CACHE_TEMPLATE
+int CACHE_CLASS::access(CORE_UINT(32) address, CORE_UINT(2)* cache_miss, CORE_UINT(32) pc){
+	CORE_UINT(TAGBITS) tag = getTag(address);
+	int set = getSet(address);
+	CORE_UINT(32) lineAddress = address >> idBits;
+	CORE_UINT(32) ready = 0;
+	bool miss = false;
+	bool prefetchHit = false;
+	int entry = -1;
+	latency = 0;
+
+	int way = findWay(set, tag);
+	if(way < 0 && victimLines){
+		n_victim_probes++;
+		entry = findVictim(lineAddress);
+	}
+	if(way >= 0){
+		policy[set].touch(way);
+		cache_index<TAGBITS>& line = index[set*ways + way];
+		if(line.prefetched){
+			line.prefetched = 0;
+			prefetchHit = true;
+			ready = line.ready;
+		}
+	}
+	else if(entry >= 0){
+		way = swapVictim(set, tag, entry);
+		n_victim_hits++;
+		latency = victimLatency;
+	}
+	else if(prefetcher != NULL && prefetcher->lookup(lineAddress, &ready)){
+		way = fill(set, tag, false, cycle);
+		prefetchHit = true;
+	}
+	else{
+		miss = true;
+		//The miss waits for the transfer in progress on the DRAM data bus, if any
+		if(dramFree < cycle)
+			dramFree = cycle;
+		way = fill(set, tag, false, dramFree);
+		n_cache_miss++;
+		n_dram_reads++;
+		*cache_miss = writeback ? 2 : 1;
+		if(profile != NULL)
+			profile->record(pc, address, writeback);
+		latency = (dramFree - cycle).to_int() + fillCycles + writebackCycles;
+		dramFree += getFillBusy() + (writeback && !writeBufferSize ? next_level->getTransferCycles(lineBytes) : 0);
+
+		int filter = lineAddress.to_int() % PREFETCH_FILTERSIZE;
+		if(evictedValid[filter] && evicted[filter] == lineAddress){
+			evictedValid[filter] = 0;
+			n_prefetch_polluting++;
+		}
+	}
+	if(classifier != NULL)
+		classifier->access(lineAddress, miss);
+	if(reuse != NULL)
+		reuse->access(address.to_uint());
+
+	if(prefetchHit){
+		if(ready > cycle){
+			n_prefetch_late++;
+			latency = (ready - cycle).to_int();
+		}
+		else
+			n_prefetch_useful++;
+	}
+
+	if(prefetcher != NULL){
+		CORE_UINT(32) candidates[PREFETCH_MAXDEGREE];
+		int n = prefetcher->access(pc, address, miss, prefetchHit, candidates);
+		for(int i=0;i<n;i++)
+			enqueuePrefetch(candidates[i]);
+	}
+	return way;
+}
+
+//Hands data over to the next level, through the write buffer when there is one. Returns the cycles
+//the writer waits: the write itself without a buffer, the drain of the oldest entry when it is full.
+CACHE_TEMPLATE
+int CACHE_CLASS::bufferWrite(CORE_UINT(32) address, CORE_UINT(8)* data, int bytes, CORE_UINT(32) issue){
+	//A misaligned word store does not write past the end of the line
+	if(getId(address) + bytes > lineBytes)
+		bytes = lineBytes - getId(address);
+	if(!writeBufferSize){
+		n_dram_writes++;
+		return next_level->writeLine(address, data, bytes, issue);
+	}
+
+	CORE_UINT(32) line = address >> idBits;
+	int offset = getId(address);
+	int entry = -1;
+	int stall = 0;
+	for(int e=0;e<writeBufferCount && entry<0;e++){
+		if(writeBuffer[e].line == line){
+			entry = e;
+			n_wb_merges++;
+		}
+	}
+	if(entry < 0){
+		if(writeBufferCount == writeBufferSize){
+			n_wb_full++;
+			stall = drainWrite(issue);
+		}
+		entry = writeBufferCount++;
+		writeBuffer[entry].line = line;
+		for(int i=0;i<lineBytes;i++)
+			writeBuffer[entry].valid[i] = 0;
+	}
+	for(int i=0;i<bytes;i++){
+		writeBuffer[entry].data[offset + i] = data[i];
+		writeBuffer[entry].valid[offset + i] = 1;
+	}
+	writeBuffer[entry].lastWrite = cycle;
+	return stall;
+}
+
+//Writes the oldest entry of the write buffer at issue or when the bus frees up, returns the cycles until it is done
+CACHE_TEMPLATE
+int CACHE_CLASS::drainWrite(CORE_UINT(32) issue){
+	cache_wbentry& entry = writeBuffer[0];
+	if(dramFree < issue)
+		dramFree = issue;
+	int cycles = 0;
+	CORE_UINT(32) base = entry.line << idBits;
+	for(int i=0;i<lineBytes;){
+		if(!entry.valid[i]){
+			i++;
+			continue;
+		}
+		int run = 0;
+		while(i + run < lineBytes && entry.valid[i + run])
+			run++;
+		n_dram_writes++;
+		int done = (dramFree - issue).to_int() + next_level->writeLine(base + i, entry.data + i, run, dramFree);
+		dramFree += next_level->getTransferCycles(run);
+		if(done > cycles)
+			cycles = done;
+		i += run;
+	}
+
+	//Keeps the buffer oldest first
+	CORE_UINT(8)* data = entry.data;
+	CORE_UINT(1)* valid = entry.valid;
+	writeBufferCount--;
+	for(int e=0;e<writeBufferCount;e++)
+		writeBuffer[e] = writeBuffer[e + 1];
+	writeBuffer[writeBufferCount].data = data;
+	writeBuffer[writeBufferCount].valid = valid;
+	return cycles;
+}
+
+//Cycles during which the last fill keeps the next level busy: its transfer, plus the time
+//the next level took beyond its nominal latency, so that a congested DRAM holds back the prefetches
+CACHE_TEMPLATE
+int CACHE_CLASS::getFillBusy(){
+	int transfer = next_level->getTransferCycles(lineBytes);
+	int busy = fillCycles - next_level->getReadCycles(lineBytes) + transfer;
+	return busy > transfer ? busy : transfer;
+}
+
+//Drops the prefetch when the queue is full or already holds the line
+CACHE_TEMPLATE
+void CACHE_CLASS::enqueuePrefetch(CORE_UINT(32) address){
+	CORE_UINT(32) lineAddress = address >> idBits;
+	if(queueCount == PREFETCH_QUEUESIZE)
+		return;
+	for(int i=0;i<queueCount;i++){
+		if(prefetchQueue[(queueHead + i) % PREFETCH_QUEUESIZE] == lineAddress)
+			return;
+	}
+	prefetchQueue[(queueHead + queueCount) % PREFETCH_QUEUESIZE] = lineAddress;
+	queueCount++;
+}
+
+//Issues the first queued prefetch whose line is not already in the cache
+CACHE_TEMPLATE
+void CACHE_CLASS::issuePrefetch(){
+	while(queueCount != 0){
+		CORE_UINT(32) lineAddress = prefetchQueue[queueHead];
+		queueHead = (queueHead + 1) % PREFETCH_QUEUESIZE;
+		queueCount--;
+
+		CORE_UINT(32) address = lineAddress << idBits;
+		int transfer = next_level->getTransferCycles(lineBytes);
+		//Stream buffers only fetch the data when the line is looked up, they wait for a plain line transfer
+		if(!prefetcher->hold(lineAddress, cycle + next_level->getReadCycles(lineBytes))){
+			int set = getSet(address);
+			CORE_UINT(TAGBITS) tag = getTag(address);
+			if(probe(address))
+				continue;
+			int way = fill(set, tag, true, cycle);
+			index[set*ways + way].ready = cycle + fillCycles;
+			transfer = getFillBusy();
+			if(writeback && !writeBufferSize)
+				transfer += next_level->getTransferCycles(lineBytes);
+		}
+		n_dram_reads++;
+		n_prefetch_issued++;
+		dramFree = cycle + transfer;
+		return;
+	}
+}
+
+CACHE_TEMPLATE
+void CACHE_CLASS::store(CORE_UINT(32) address, CORE_INT(32) value, CORE_UINT(2) op, CORE_UINT(2)* cache_miss,
+		CORE_UINT(32) pc){
+	// For store byte, op = 0
+	// For store half word, op = 1
+	// For store word, op = 3
+
+	n_store++;
+	writeStall = 0;
+	int set = getSet(address);
+	int id = getId(address);
+
+	CORE_UINT(8) byte0 = value.SLC(8,0);
+	CORE_UINT(8) byte1 = value.SLC(8,8);
+	CORE_UINT(8) byte2 = value.SLC(8,16);
+	CORE_UINT(8) byte3 = value.SLC(8,24);
+	CORE_UINT(8) bytes[4] = {byte0, byte1, byte2, byte3};
+	int size = (op & 2) ? 4 : (op & 1) ? 2 : 1;
+
+	//Without write-allocate, a store miss only goes to the next level
+	if(!writeAllocate && !probe(address)){
+		n_cache_miss++;
+		n_write_through++;
+		if(classifier != NULL)
+			classifier->access(address >> idBits, true, false);
+		if(profile != NULL)
+			profile->record(pc, address, false);
+		if(reuse != NULL)
+			reuse->access(address.to_uint());
+		writeStall = bufferWrite(address, bytes, size, cycle);
+		latency = writeStall;
+		return;
+	}
+
+	int way = access(address, cache_miss, pc);
+
+	CORE_UINT(8)* line = cache + (set*ways + way)*lineBytes;
+	line[id] = byte0;
+	if(op & 1){
+		line[id+1] = byte1;
+	}
+	if(op & 2){
+		line[id+2] = byte2;
+		line[id+3] = byte3;
+	}
+	if(writePolicy == WRITE_THROUGH){
+		n_write_through++;
+		writeStall = bufferWrite(address, bytes, size, cycle);
+		latency += writeStall;
+	}
+	else
+		index[set*ways + way].dirtybit = 1;
+}
+
+CACHE_TEMPLATE
+CORE_INT(32) CACHE_CLASS::load(CORE_UINT(32) address, CORE_UINT(2) op, CORE_UINT(1) sign, CORE_UINT(2)* cache_miss,
+		CORE_UINT(32) pc){
+	// For load byte, op = 0
+	// For load half word, op = 1
+	// For load word, op = 3
+	n_load++;
+	writeStall = 0;
+	int set = getSet(address);
+	int id = getId(address);
+	CORE_INT(32) result;
+	CORE_UINT(8) byte0, byte1 = 0, byte2 = 0, byte3 = 0;
+
+	int way = access(address, cache_miss, pc);
+
+	//id is the offset of the first byte: only the bytes loaded are read, they are in the line
+	CORE_UINT(8)* line = cache + (set*ways + way)*lineBytes;
+	byte0 = line[id];
+	if(op & 1)
+		byte1 = line[id+1];
+	if(op & 2){
+		byte2 = line[id+2];
+		byte3 = line[id+3];
+	}
+
+	//Sign extension of the most significant byte loaded
+	CORE_UINT(8) msb = (op & 2) ? byte3 : ((op & 1) ? byte1 : byte0);
+	result = (sign && msb[7]) ? -1 : 0;
+	result.SET_SLC(0,byte0);
+	if(op & 1){
+		result.SET_SLC(8,byte1);
+	}
+	if(op & 2){
+		result.SET_SLC(16,byte2);
+		result.SET_SLC(24,byte3);
+	}
+	return result;
+}
+
+
+CACHE_TEMPLATE
+int CACHE_CLASS::getLineBytes(){
+	return lineBytes;
+}
+
+
+CACHE_TEMPLATE
+bool CACHE_CLASS::invalidateLine(CORE_UINT(32) address, CORE_UINT(8)* data){
+	int set = getSet(address);
+	int way = findWay(set, getTag(address));
+	if(way < 0){
+		int entry = findVictim(address >> idBits);
+		if(entry < 0)
+			return false;
+		victims[entry].valid = 0;
+		if(!victims[entry].dirtybit)
+			return false;
+		for(int i=0;i<lineBytes;i++)
+			data[i] = victimCache[entry*lineBytes + i];
+		return true;
+	}
+	cache_index<TAGBITS>& line = index[set*ways + way];
+	line.invalid = 1;
+	if(!line.dirtybit)
+		return false;
+	line.dirtybit = 0;
+	CORE_UINT(8)* lineData = cache + (set*ways + way)*lineBytes;
+	for(int i=0;i<lineBytes;i++)
+		data[i] = lineData[i];
+	return true;
+}
+
+
+CACHE_TEMPLATE
+int CACHE_CLASS::getLatency(){
+	return latency;
+}
+
+
+CACHE_TEMPLATE
+int CACHE_CLASS::getWriteStall(){
+	return writeStall;
+}
+
+
+CACHE_TEMPLATE
+bool CACHE_CLASS::probe(CORE_UINT(32) address){
+	return findWay(getSet(address), getTag(address)) >= 0 || findVictim(address >> idBits) >= 0;
+}
+
+
+CACHE_TEMPLATE
+int CACHE_CLASS::getMshrs(){
+	return mshrs;
+}
+
+
+CACHE_TEMPLATE
+void CACHE_CLASS::tick(CORE_UINT(32) cycle){
+	this->cycle = cycle;
+	//The write buffer drains when the bus is idle, ahead of the prefetches. The entry written last
+	//stays a little longer to coalesce the next stores to its line.
+	if(cycle >= dramFree && (writeBufferCount > 1
+			|| (writeBufferCount == 1 && cycle - writeBuffer[0].lastWrite >= CACHE_WRITEBUFFERIDLE)))
+		drainWrite(cycle);
+	else if(prefetcher != NULL && cycle >= dramFree)
+		issuePrefetch();
+
+	int outstanding = 0;
+	for(int m=0;m<mshrs;m++){
+		if(mshr[m].valid && mshr[m].ready <= cycle)
+			mshr[m].valid = 0;
+		if(mshr[m].valid)
+			outstanding++;
+	}
+	n_outstanding += outstanding;
+	if(outstanding)
+		n_miss_cycles++;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::getPendingReady(CORE_UINT(32) address){
+	CORE_UINT(32) line = address >> idBits;
+	for(int m=0;m<mshrs;m++){
+		if(mshr[m].valid && mshr[m].line == line){
+			n_mshr_merges++;
+			return mshr[m].ready;
+		}
+	}
+	return 0;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::allocateMshr(CORE_UINT(32) address, CORE_UINT(32) cycle, int penalty){
+	int entry = 0;
+	for(int m=0;m<mshrs;m++){
+		if(!mshr[m].valid){
+			entry = m;
+			break;
+		}
+		if(mshr[m].ready < mshr[entry].ready)
+			entry = m;
+	}
+	//All the MSHRs are busy, the miss takes the first one to be freed
+	if(mshr[entry].valid){
+		n_mshr_full++;
+		cycle = mshr[entry].ready;
+	}
+	mshr[entry].line = address >> idBits;
+	mshr[entry].ready = cycle + penalty;
+	mshr[entry].valid = 1;
+	return cycle;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::getNumberMshrMerges(){
+	return n_mshr_merges;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::getNumberMshrFull(){
+	return n_mshr_full;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(64) CACHE_CLASS::getNumberOutstanding(){
+	return n_outstanding;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::getNumberMissCycles(){
+	return n_miss_cycles;
+}
+
+
+CACHE_TEMPLATE
+bool CACHE_CLASS::hasPrefetcher(){
+	return prefetcher != NULL;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::getNumberPrefetchIssued(){
+	return n_prefetch_issued;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::getNumberPrefetchUseful(){
+	return n_prefetch_useful;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::getNumberPrefetchLate(){
+	return n_prefetch_late;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::getNumberPrefetchPolluting(){
+	return n_prefetch_polluting;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::getNumberPrefetchUnused(){
+	return n_prefetch_unused;
+}
+
+
+CACHE_TEMPLATE
+int CACHE_CLASS::getWriteBufferSize(){
+	return writeBufferSize;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::getNumberWriteThrough(){
+	return n_write_through;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::getNumberWriteBufferMerges(){
+	return n_wb_merges;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::getNumberWriteBufferFull(){
+	return n_wb_full;
+}
+
+
+CACHE_TEMPLATE
+int CACHE_CLASS::getVictimLines(){
+	return victimLines;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::getNumberVictimProbes(){
+	return n_victim_probes;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::getNumberVictimHits(){
+	return n_victim_hits;
+}
+
+
+CACHE_TEMPLATE
+MissClassifier* CACHE_CLASS::getMissClassifier(){
+	return classifier;
+}
+
+
+CACHE_TEMPLATE
+void CACHE_CLASS::setMissProfile(MissProfile* profile){
+	this->profile = profile;
+}
+
+
+CACHE_TEMPLATE
+void CACHE_CLASS::setStackDistance(StackDistance* reuse){
+	this->reuse = reuse;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::getNumberCacheMiss(){
+	return n_cache_miss;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::getNumberDramReads(){
+	return n_dram_reads;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::getNumberDramWrites(){
+	return n_dram_writes;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::getNumberLoads(){
+	return n_load;
+}
+
+
+CACHE_TEMPLATE
+CORE_UINT(32) CACHE_CLASS::getNumberStores(){
+	return n_store;
+}
+
+#undef CACHE_TEMPLATE
+#undef CACHE_CLASS
 
 #endif /* CACHE_H */
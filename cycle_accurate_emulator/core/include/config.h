@@ -0,0 +1,91 @@
+// vim: set ts=4 nu ai:
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <string>
+#include <cache.h>
+#include <dram.h>
+#include <l2cache.h>
+#include <branchpredictor.h>
+#include <cycletrace.h>
+
+/*********************************************************
+ * 	Runtime configuration of catapult.sim
+ *
+ * 	The defaults reproduce the original simulator. They can
+ * 	be changed from an INI file and from the command line,
+ * 	the command line taking precedence:
+ *
+ * 		catapult.sim [-c file.ini] [-o section.key=value]... [-n cycles] [elf]
+ *
+ * 	[simulation]	elf, cycles, miss_report (file receiving the misses of both
+ * 					caches by instruction, function and data object), reuse_report
+ * 					(file receiving the miss ratio curves of the data accesses, at the
+ * 					line size of the dcache), cpi_report (file receiving the cycles by
+ * 					stall cause of the run and of each function, see cpistack.h), trace
+ * 					(off, sampled, full), trace_file (receiving the binary trace of the
+ * 					cycles, see cycletrace.h), trace_interval (cycles between two samples),
+ * 					lockstep (1 checks every retired instruction against the instruction
+ * 					set simulator and stops at the first divergence, see lockstep.h)
+ * 	[icache]		sets, ways, line, policy (lru, plru, fifo, random), victim_lines
+ * 					(of the victim cache, 0 for none), victim_latency (cycles of a hit),
+ * 					classify_misses (1 splits the misses into compulsory, capacity and
+ * 					conflict misses)
+ * 	[dcache]		the keys of the icache, and mshrs (0 blocks the pipeline on misses),
+ * 					prefetcher (none, nextline, stride, stream), prefetch_degree
+ * 					(lines per prefetch, depth of the stream buffers), prefetch_streams,
+ * 					write_policy (writeback, writethrough), write_allocate (0 or 1),
+ * 					write_buffer (entries of the coalescing write buffer, 0 for none)
+ * 	[l2]			enabled, sets, ways, line, policy, inclusion (nine, inclusive,
+ * 					exclusive), latency (cycles of a hit), bytes_per_cycle, classify_misses
+ * 	[dram]			model (fixed, banked), bytes_per_cycle, and for the fixed model
+ * 					read_latency, write_latency; for the banked one banks, row (bytes),
+ * 					t_cas, t_rcd, t_rp, burst_length, refresh_interval (0 for none),
+ * 					refresh_cycles, page_policy (open, closed), scheduler (fcfs,
+ * 					frfcfs), queue_size (posted writes), stats_window
+ * 	[predictor]		type (none, nottaken, btfn, bimodal, gshare, tournament), table_bits
+ * 					(log2 of the counter tables), history_bits, btb_entries, ras_entries
+ * 					(0 for none); none keeps the original fetch, see branchpredictor.h
+ *
+ * 	Lines starting with # or ; are comments. The miss
+ * 	penalties of the caches are derived from the timing of
+ * 	the L2 and of the DRAM, and from their line size.
+ *********************************************************/
+
+#define CONFIG_DEFAULTELF "benchmarks/build/median.out"
+#define CONFIG_DEFAULTCYCLES 1000000
+#define CONFIG_DEFAULTTRACEINTERVAL 1000
+
+struct SimulatorConfig{
+	std::string elfFile;
+	int cycles;
+	std::string missReport; //Empty for none
+	std::string reuseReport;
+	std::string cpiReport;
+	int traceMode;
+	std::string traceFile;
+	int traceInterval;
+	int lockstep;
+	CacheConfig icache;
+	CacheConfig dcache;
+	L2Config l2;
+	DramConfig dram;
+	PredictorConfig predictor;
+	std::string jobFile; //-b, the runs of a batch, empty for a single run
+	int jobThreads; //-j, runs of the batch simulated at once, 0 for all the host threads
+
+	SimulatorConfig() : elfFile(CONFIG_DEFAULTELF), cycles(CONFIG_DEFAULTCYCLES), traceMode(TRACE_OFF),
+		traceInterval(CONFIG_DEFAULTTRACEINTERVAL), lockstep(0), jobThreads(0){}
+};
+
+//Each function returns false and prints the reason on stderr when the configuration is not valid
+bool setConfigValue(SimulatorConfig* config, const std::string& section, const std::string& key, const std::string& value);
+bool readConfigFile(SimulatorConfig* config, const char* fileName);
+//option is section.key=value
+bool applyOverride(SimulatorConfig* config, const std::string& option);
+bool checkConfig(const SimulatorConfig* config);
+bool parseArguments(SimulatorConfig* config, int argc, char** argv);
+
+void printConfigUsage(const char* program);
+
+#endif /* CONFIG_H */
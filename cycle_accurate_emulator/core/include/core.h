@@ -1,5 +1,32 @@
+#ifndef CORE_H_
+#define CORE_H_
+
 #include "portability.h"
 #include <cache.h>
+#include <branchpredictor.h>
+#include <cpistack.h>
+#include <cycletrace.h>
+#include <pipelineconfig.h>
+#include <syscall.h>
+#include <iostream>
+
+//Everything the core keeps from one cycle to the next besides the pipeline registers, one per simulated core
+struct CoreState{
+	CORE_INT(32) REG[32]; // Register file
+	CORE_UINT(2) sys_status;
+	CORE_UINT(16) icache_cycles; //Left before the fetch gets its instruction
+	CORE_UINT(16) dcache_cycles; //Left before do_Mem gets its data
+	unsigned int cycle_markers; //Messages of the cycle, see cycletrace.h
+	SyscallFiles files;
+	std::ostream* out; //Receives the messages and the statistics
+
+	CoreState() : sys_status(0), icache_cycles(0), dcache_cycles(0), cycle_markers(0), out(&std::cout){}
+};
+
+//Instantiated in core.cpp for the configurations of pipelineconfig.h, cpi, trace and checker are NULL when left out
+template<class CONFIG>
+void doStep(CoreState* state, CORE_UINT(32) pc, CORE_UINT(32) nbcycle, typename CONFIG::ICache* ICache,
+	typename CONFIG::DCache* Dcache, typename CONFIG::Predictor* predictor, typename CONFIG::Stats* cpi,
+	typename CONFIG::Trace* trace, typename CONFIG::Checker* checker, CORE_INT(32) dm_out[8192]);//, CORE_INT(32) debug_arr[200]);
 
-void doStep(CORE_UINT(32) pc, CORE_UINT(32) nbcycle, Cache* ICache,
-	Cache* Dcache, CORE_INT(32) dm_out[8192]);//, CORE_INT(32) debug_arr[200]);
+#endif /* CORE_H_ */
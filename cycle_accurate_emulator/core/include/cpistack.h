@@ -0,0 +1,65 @@
+// vim: set ts=4 nu ai:
+#ifndef CPISTACK_H
+#define CPISTACK_H
+
+#include <portability.h>
+#include <lib/symbolTable.h>
+#include <ostream>
+#include <unordered_map>
+
+//What the memory stage did during a cycle
+enum CpiCause{
+	CPI_BASE, //An instruction went through
+	CPI_ICACHE, //The pipeline is frozen on an icache miss
+	CPI_DCACHE_CLEAN, //Frozen on a dcache miss, a store stall or a full MSHR file
+	CPI_DCACHE_DIRTY, //Same for a miss writing a dirty line back
+	CPI_LOAD_USE, //Bubble of the load-use interlock
+	CPI_PENDING_MISS, //Bubble of an instruction waiting for a load still in an MSHR
+	CPI_FLUSH, //Instruction fetched after a mispredicted branch or jump
+	CPI_SYSCALL, //A system call went through
+	CPI_STRUCTURAL, //No instruction yet, while the pipeline fills
+	CPI_CAUSES
+};
+
+struct cpi_count{
+	unsigned long long cycles[CPI_CAUSES];
+
+	cpi_count(){
+		for(int i=0;i<CPI_CAUSES;i++)
+			cycles[i] = 0;
+	}
+};
+
+/*********************************************************
+ * 	Cycle accounting
+ *
+ * 	doStep gives each cycle to one CpiCause, from what the
+ * 	memory stage did, and charges it to an instruction: the
+ * 	one going through, stalled on a miss, or whose operand
+ * 	is not ready for a bubble; the fetched one for an
+ * 	icache miss; the last one to go through for a flush.
+ * 	Base and syscall cycles are the retired instructions,
+ * 	so the causes add up to the cycles of the run and, over
+ * 	the instructions, to its CPI. The report gives the CPI
+ * 	stack of the run and of each function of the
+ * 	.symtab.
+ *
+ * 	Simulation only, it is not meant to be synthesized.
+ *********************************************************/
+class CpiStack{
+	private:
+		std::unordered_map<unsigned int, cpi_count> byPc;
+		unsigned int lastPc; //Of the last instruction to go through
+
+	public:
+		enum{ enabled = 1 };
+		CpiStack() : lastPc(0){}
+
+		void record(CpiCause cause, CORE_UINT(32) pc);
+		//For the causes not tied to an instruction of the correct path
+		void recordLast(CpiCause cause);
+
+		void writeReport(std::ostream& out, const SymbolTable& symbols);
+};
+
+#endif /* CPISTACK_H */
@@ -0,0 +1,148 @@
+// vim: set ts=4 nu ai:
+#ifndef CYCLETRACE_H
+#define CYCLETRACE_H
+
+#include <portability.h>
+#include <atomic>
+#include <thread>
+#include <stdio.h>
+#include <string.h>
+
+#define CYCLETRACE_MAGIC "CCTRACE1"
+#define CYCLETRACE_RINGBYTES (1 << 22)
+#define CYCLETRACE_MAXRECORD 160 //Bytes of the largest record, all the registers changed
+
+//What the pipeline printed in the middle of the line of a cycle
+#define CYCLETRACE_ICACHE 1 //[ICache miss]
+#define CYCLETRACE_DCACHE 2 //[DCache miss]
+#define CYCLETRACE_EXIT 4 //Exit system call received
+#define CYCLETRACE_UNKNOWN 8 //Unknown system call received
+//Optional fields of a record
+#define CYCLETRACE_INSTRUCTION 16
+#define CYCLETRACE_REGISTERS 32
+
+enum TraceMode{
+	TRACE_OFF,
+	TRACE_SAMPLED, //One cycle every interval
+	TRACE_FULL
+};
+
+/*********************************************************
+ * 	Per-cycle trace of the core
+ *
+ * 	The state doStep used to print every cycle with
+ * 	__DEBUG__: the fetched PC and instruction, the register
+ * 	file, and the miss and system call messages, written
+ * 	in binary to a file which util/tracedecode.py turns
+ * 	back into that text. After the magic comes the interval
+ * 	(u32), then one record per traced cycle:
+ *
+ * 	u8		markers and optional fields
+ * 	varint	cycles since the previous record
+ * 	varint	zigzag PC delta
+ * 	u32		instruction, when it changed
+ * 	u32		mask of the registers which changed, and their
+ * 			values in increasing order
+ *
+ * 	all little-endian, the deltas and the changes being
+ * 	relative to the previous record. The core only fills a
+ * 	lock-free ring buffer, a thread writes it to the file.
+ * 	The core waits when the ring is full, no cycle is lost.
+ *
+ * 	Simulation only, it is not meant to be synthesized.
+ *********************************************************/
+class CycleTrace{
+	private:
+		FILE* file;
+		unsigned int interval;
+
+		//Single producer, single consumer: head only moves in record(), tail in the writer thread
+		char* ring;
+		std::atomic<unsigned long long> head;
+		std::atomic<unsigned long long> tail;
+		std::atomic<bool> done;
+		std::thread writer;
+
+		unsigned long long lastCycle;
+		unsigned int lastPc;
+		unsigned int lastInstruction;
+		unsigned int lastRegisters[32];
+
+		static unsigned char* putVarint(unsigned char* out, unsigned long long value){
+			while(value >= 0x80){
+				*out++ = (value & 0x7f) | 0x80;
+				value >>= 7;
+			}
+			*out++ = value;
+			return out;
+		}
+
+		static unsigned char* putWord(unsigned char* out, unsigned int value){
+			for(int i=0;i<4;i++)
+				*out++ = value >> (8*i);
+			return out;
+		}
+
+		void push(const unsigned char* data, unsigned int size);
+		void drain();
+
+		CycleTrace(const CycleTrace&);
+		CycleTrace& operator=(const CycleTrace&);
+
+	public:
+		enum{ enabled = 1 };
+		CycleTrace();
+		~CycleTrace();
+
+		//interval 1 traces every cycle
+		bool open(const char* fileName, unsigned int interval);
+		//Waits for the writer thread to empty the ring
+		void close();
+		bool isOpen(){
+			return file != NULL;
+		}
+
+		void record(CORE_UINT(32) cycle, unsigned int markers, CORE_UINT(32) pc, CORE_UINT(32) instruction,
+				const CORE_INT(32) registers[32]){
+			unsigned long long now = cycle.to_uint();
+			if(interval > 1 && now % interval != 0)
+				return;
+
+			unsigned char buffer[CYCLETRACE_MAXRECORD];
+			unsigned char* out = buffer + 1;
+			out = putVarint(out, now - lastCycle);
+			int delta = (int) (pc.to_uint() - lastPc);
+			out = putVarint(out, (unsigned int) ((delta << 1) ^ (delta >> 31)));
+			lastCycle = now;
+			lastPc = pc.to_uint();
+
+			if(instruction.to_uint() != lastInstruction){
+				markers |= CYCLETRACE_INSTRUCTION;
+				lastInstruction = instruction.to_uint();
+				out = putWord(out, lastInstruction);
+			}
+
+			unsigned int mask = 0;
+			unsigned char* maskField = out;
+			out += 4;
+			for(int i=0;i<32;i++){
+				unsigned int value = registers[i].to_int();
+				if(value != lastRegisters[i]){
+					mask |= 1u << i;
+					lastRegisters[i] = value;
+					out = putWord(out, value);
+				}
+			}
+			if(mask != 0){
+				markers |= CYCLETRACE_REGISTERS;
+				putWord(maskField, mask);
+			}
+			else
+				out = maskField;
+
+			buffer[0] = markers;
+			push(buffer, out - buffer);
+		}
+};
+
+#endif /* CYCLETRACE_H */
@@ -3,18 +3,18 @@
 
 #include <iostream>
 
-void PrintDebugStatements(){
-	std::cout << "";
+//Each pipeline prints to its own stream, std::cout unless it runs in a batch
+inline void PrintDebugStatements(std::ostream& out){
 }
 
-template<typename First, typename ... Strings> 
-void PrintDebugStatements(First arg, const Strings&... rest){
-	std::cout << arg;
-	PrintDebugStatements(rest...);
+template<typename First, typename ... Strings>
+void PrintDebugStatements(std::ostream& out, First arg, const Strings&... rest){
+	out << arg;
+	PrintDebugStatements(out, rest...);
 }
 
-void PrintNewLine(){
-	std::cout << std::endl;
+inline void PrintNewLine(std::ostream& out){
+	out << std::endl;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -3,18 +3,161 @@
 #define DRAM_H
 
 #include <portability.h>
-#include <map>
+#include <memorylevel.h>
+#include <vector>
 
-class Dram{
+#define DRAM_PAGEBYTES 4096
+#define DRAM_PAGEBITS 12 // log2(DRAM_PAGEBYTES)
+#define DRAM_TABLEENTRIES 1024
+#define DRAM_TABLEBITS 10 // (32 - DRAM_PAGEBITS) / 2
+#define DRAM_MAXBANKS 64
+#define DRAM_MAXQUEUE 64
+
+enum DramModel{
+	FIXED_DRAM,
+	BANKED_DRAM
+};
+
+enum DramPagePolicy{
+	OPEN_PAGE,
+	CLOSED_PAGE
+};
+
+enum DramScheduler{
+	FCFS_SCHEDULER,
+	FRFCFS_SCHEDULER
+};
+
+/*********************************************************
+ * 	DRAM timing
+ *
+ * 	The fixed model charges the access latency, then streams
+ * 	the line at bytesPerCycle. The default gives the 30 cycles
+ * 	of a 64 bytes line fill and 28 more cycles to write back a
+ * 	dirty one.
+ *
+ * 	The banked model maps addresses as row:bank:column and
+ * 	keeps a row buffer per bank. A read costs tCas when its
+ * 	row is open, tRcd + tCas when the bank is precharged and
+ * 	tRp + tRcd + tCas on a row conflict, then waits for the
+ * 	shared data bus, which moves lines in bursts of
+ * 	burstLength beats of bytesPerCycle. The closed page policy
+ * 	precharges the bank after each access. Every
+ * 	refreshInterval cycles all banks are precharged and busy
+ * 	for refreshCycles.
+ *
+ * 	Reads are served in arrival order, ahead of the writes,
+ * 	which are posted to a queue of queueSize entries. The
+ * 	queue drains while the data bus is idle, or one entry at
+ * 	a time when it is full; FR-FCFS picks the oldest write to
+ * 	an open row first, FCFS the oldest write.
+ *********************************************************/
+struct DramConfig{
+	int model;
+	int readLatency;
+	int writeLatency;
+	int bytesPerCycle;
+	int banks;
+	int rowBytes;
+	int tCas;
+	int tRcd;
+	int tRp;
+	int burstLength;
+	int refreshInterval;
+	int refreshCycles;
+	int pagePolicy;
+	int scheduler;
+	int queueSize;
+	int statsWindow; //Cycles per sample of the bandwidth utilization
+
+	DramConfig() : model(FIXED_DRAM), readLatency(14), writeLatency(12), bytesPerCycle(4), banks(8),
+		rowBytes(2048), tCas(11), tRcd(11), tRp(11), burstLength(8), refreshInterval(7800),
+		refreshCycles(128), pagePolicy(OPEN_PAGE), scheduler(FRFCFS_SCHEDULER), queueSize(16),
+		statsWindow(100000){}
+};
+
+struct dram_bank{
+	long long ready; //Cycle at which the bank can take a new command
+	int row;
+	bool open;
+};
+
+struct dram_request{
+	unsigned int address;
+	int bytes;
+	long long arrival;
+};
+
+class Dram : public MemoryLevel{
 	
 	private:
-		std::map<CORE_UINT(32),CORE_UINT(8)> memory;
+		// Two-level page table over the 32-bit address space. Second level
+		// tables and 4KB pages are only allocated on the first write, reads
+		// of untouched memory return 0.
+		unsigned char** directory[DRAM_TABLEENTRIES];
+		DramConfig config;
+
+		dram_bank bank[DRAM_MAXBANKS];
+		dram_request queue[DRAM_MAXQUEUE];
+		int queueCount;
+		long long busFree; //Cycle at which the data bus is idle
+		long long nextRefresh;
+		int columnBits;
+		int bankBits;
+
+		//data structures to collect statistics
+		unsigned int n_reads;
+		unsigned int n_writes;
+		unsigned int n_row_hits;
+		unsigned int n_row_empty;
+		unsigned int n_row_conflicts;
+		unsigned int n_refreshes;
+		unsigned int n_queue_full;
+		long long readCycles; //Sum of the read latencies
+		std::vector<long long> busy; //Data bus busy cycles per statsWindow
+
+		unsigned char* getPage(unsigned int address, bool allocate);
+
+		void refresh(long long cycle);
+		long long serve(unsigned int address, int bytes, long long cycle);
+		int pickWrite();
+		void drain(long long cycle, bool force);
+		void addBusy(long long start, long long end);
+
+		Dram(const Dram&);
+		Dram& operator=(const Dram&);
 
 	public:
-		
+		Dram(DramConfig config = DramConfig());
+		~Dram();
+
 		void setMemory(CORE_UINT(32) address, CORE_UINT(8) value);
 		CORE_UINT(8) getMemory(CORE_UINT(32) address);
 
+		// Bulk transfers used by the caches for line fills and writebacks. With the
+		// fixed model they return getReadCycles and getWriteCycles, with the banked
+		// one the latency of this request, 0 for a posted write.
+		int readLine(CORE_UINT(32) address, CORE_UINT(8)* line, int bytes, CORE_UINT(32) cycle, bool* dirty = NULL);
+		int writeLine(CORE_UINT(32) address, CORE_UINT(8)* line, int bytes, CORE_UINT(32) cycle);
+
+		// Cycles taken by readLine and writeLine for a given size, on a precharged bank
+		int getReadCycles(int bytes);
+		int getWriteCycles(int bytes);
+		// Cycles during which the data bus is busy with such a transfer
+		int getTransferCycles(int bytes);
+
+		bool isBanked();
+		unsigned int getNumberReads();
+		unsigned int getNumberWrites();
+		unsigned int getNumberRowHits();
+		unsigned int getNumberRowEmpty();
+		unsigned int getNumberRowConflicts();
+		unsigned int getNumberRefreshes();
+		unsigned int getNumberQueueFull();
+		long long getReadCycleSum();
+		int getStatsWindow();
+		const std::vector<long long>& getBusyCycles();
+
 };
 
 #endif /* DRAM_H */
@@ -0,0 +1,259 @@
+// vim: set ts=4 nu ai:
+#ifndef FASTINT_H
+#define FASTINT_H
+
+#include <stdint.h>
+#include <ostream>
+
+/*********************************************************
+ * 	Native integers for the __FASTSIM__ build
+ *
+ * 	fast_int<W,S> stands for ac_int<W,S> when nothing is
+ * 	synthesized. Its value is kept in an int64_t up to 63
+ * 	bits, in an __int128 above, truncated to W bits (sign
+ * 	extended when S) when stored. The operators follow the
+ * 	rules of ac_int: a sum, a product or a logic operation
+ * 	is exact, its result being as wide as needed, while a
+ * 	shift keeps the width of its left operand. Slices and
+ * 	bits are masks and shifts. Only what the core uses of
+ * 	ac_int is provided.
+ *********************************************************/
+
+#define FASTINT_MAX(a, b) ((a) > (b) ? (a) : (b))
+#define FASTINT_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+template<bool NATIVE> struct fast_int_storage{
+	typedef int64_t type;
+	typedef uint64_t bits;
+};
+template<> struct fast_int_storage<false>{
+	typedef __int128 type;
+	typedef unsigned __int128 bits;
+};
+
+template<int W, bool S> class fast_int;
+
+//Width of the results of ac_int
+template<int W1, bool S1, int W2, bool S2> struct fast_rt{
+	enum{
+		mult_w = W1 + W2,
+		plus_w = FASTINT_MAX(W1 + (S2 && !S1), W2 + (S1 && !S2)) + 1,
+		logic_w = FASTINT_MAX(W1 + (S2 && !S1), W2 + (S1 && !S2)),
+		div_w = W1 + S2,
+		mod_w = FASTINT_MIN(W1, W2 + (!S2 && S1))
+	};
+	typedef fast_int<mult_w, S1 || S2> mult;
+	typedef fast_int<plus_w, S1 || S2> plus;
+	typedef fast_int<plus_w, true> minus;
+	typedef fast_int<logic_w, S1 || S2> logic;
+	typedef fast_int<div_w, S1 || S2> div;
+	typedef fast_int<mod_w, S1> mod;
+};
+
+//The fast_int standing for a C integer type in an expression, none for the other types
+template<class T> struct fast_int_of{};
+#define FASTINT_OF(T, width, sign) template<> struct fast_int_of<T>{ enum{ w = width, s = sign }; typedef fast_int<width, sign> type; };
+FASTINT_OF(bool, 1, false)
+FASTINT_OF(char, 8, true)
+FASTINT_OF(signed char, 8, true)
+FASTINT_OF(unsigned char, 8, false)
+FASTINT_OF(short, 16, true)
+FASTINT_OF(unsigned short, 16, false)
+FASTINT_OF(int, 32, true)
+FASTINT_OF(unsigned int, 32, false)
+FASTINT_OF(long, 64, true)
+FASTINT_OF(unsigned long, 64, false)
+FASTINT_OF(long long, 64, true)
+FASTINT_OF(unsigned long long, 64, false)
+#undef FASTINT_OF
+
+//R, when the width of the operand is known
+template<int W, class R> struct fast_enable{
+	typedef R type;
+};
+
+//Bit i of a fast_int, as returned by operator[]
+template<int W, bool S> class fast_bitref{
+	private:
+		fast_int<W,S>& word;
+		int index;
+
+	public:
+		fast_bitref(fast_int<W,S>& word, int index) : word(word), index(index){}
+
+		operator int() const{
+			return (int) ((word.value >> index) & 1);
+		}
+
+		fast_bitref& operator=(int bit){
+			typedef typename fast_int<W,S>::bits bits;
+			bits mask = (bits) 1 << index;
+			word = fast_int<W,S>((typename fast_int<W,S>::storage) (((bits) word.value & ~mask) | (bit & 1 ? mask : 0)));
+			return *this;
+		}
+
+		fast_bitref& operator=(const fast_bitref& other){
+			return *this = (int) other;
+		}
+};
+
+template<int W, bool S> class fast_int{
+	public:
+		typedef typename fast_int_storage<(W < 64 || (W == 64 && S))>::type storage;
+		typedef typename fast_int_storage<(W < 64 || (W == 64 && S))>::bits bits;
+		enum{ width = sizeof(storage) * 8 };
+
+		storage value;
+
+		static storage normalize(storage v){
+			if(W >= width)
+				return v;
+			if(S)
+				return (storage) ((bits) v << (width - W)) >> (width - W);
+			return (storage) ((bits) v & (((bits) 1 << W) - 1));
+		}
+
+		fast_int() : value(0){}
+		template<int W2, bool S2> fast_int(const fast_int<W2,S2>& other) : value(normalize((storage) other.value)){}
+		template<class T> fast_int(T v) : value(normalize((storage) v)){}
+
+		operator storage() const{
+			return value;
+		}
+
+		int to_int() const{
+			return (int) value;
+		}
+		unsigned int to_uint() const{
+			return (unsigned int) value;
+		}
+		long long to_int64() const{
+			return (long long) value;
+		}
+		unsigned long long to_uint64() const{
+			return (unsigned long long) value;
+		}
+		double to_double() const{
+			return (double) value;
+		}
+		int length() const{
+			return W;
+		}
+
+		template<int N> fast_int<N,S> slc(int low) const{
+			return fast_int<N,S>(value >> low);
+		}
+
+		template<int W2, bool S2> fast_int& set_slc(int low, const fast_int<W2,S2>& slice){
+			bits mask = (((bits) 1 << W2) - 1) << low;
+			value = normalize((storage) (((bits) value & ~mask) | (((bits) slice.value << low) & mask)));
+			return *this;
+		}
+
+		fast_bitref<W,S> operator[](int index){
+			return fast_bitref<W,S>(*this, index);
+		}
+		int operator[](int index) const{
+			return (int) ((value >> index) & 1);
+		}
+
+		fast_int<W + 1, true> operator-() const{
+			return fast_int<W + 1, true>(-(typename fast_int<W + 1, true>::storage) value);
+		}
+		fast_int<W + !S, true> operator~() const{
+			return fast_int<W + !S, true>(~(typename fast_int<W + !S, true>::storage) value);
+		}
+
+		template<class T> fast_int& operator+=(const T& v){ return *this = *this + v; }
+		template<class T> fast_int& operator-=(const T& v){ return *this = *this - v; }
+		template<class T> fast_int& operator*=(const T& v){ return *this = *this * v; }
+		template<class T> fast_int& operator/=(const T& v){ return *this = *this / v; }
+		template<class T> fast_int& operator%=(const T& v){ return *this = *this % v; }
+		template<class T> fast_int& operator&=(const T& v){ return *this = *this & v; }
+		template<class T> fast_int& operator|=(const T& v){ return *this = *this | v; }
+		template<class T> fast_int& operator^=(const T& v){ return *this = *this ^ v; }
+		template<class T> fast_int& operator<<=(const T& v){ return *this = *this << v; }
+		template<class T> fast_int& operator>>=(const T& v){ return *this = *this >> v; }
+
+		fast_int& operator++(){ value = normalize(value + 1); return *this; }
+		fast_int& operator--(){ value = normalize(value - 1); return *this; }
+		fast_int operator++(int){ fast_int old = *this; value = normalize(value + 1); return old; }
+		fast_int operator--(int){ fast_int old = *this; value = normalize(value - 1); return old; }
+};
+
+//Each operator computes in the storage of its result, wide enough for both operands
+#define FASTINT_ARITHMETIC(OP, KIND) \
+	template<int W1, bool S1, int W2, bool S2> inline typename fast_rt<W1,S1,W2,S2>::KIND \
+	operator OP(const fast_int<W1,S1>& a, const fast_int<W2,S2>& b){ \
+		typedef typename fast_rt<W1,S1,W2,S2>::KIND R; \
+		return R((typename R::storage) a.value OP (typename R::storage) b.value); \
+	} \
+	template<int W, bool S, class T> inline typename fast_rt<W,S,fast_int_of<T>::w,fast_int_of<T>::s>::KIND \
+	operator OP(const fast_int<W,S>& a, T b){ \
+		return a OP typename fast_int_of<T>::type(b); \
+	} \
+	template<int W, bool S, class T> inline typename fast_rt<fast_int_of<T>::w,fast_int_of<T>::s,W,S>::KIND \
+	operator OP(T a, const fast_int<W,S>& b){ \
+		return typename fast_int_of<T>::type(a) OP b; \
+	}
+FASTINT_ARITHMETIC(+, plus)
+FASTINT_ARITHMETIC(-, minus)
+FASTINT_ARITHMETIC(*, mult)
+FASTINT_ARITHMETIC(/, div)
+FASTINT_ARITHMETIC(%, mod)
+FASTINT_ARITHMETIC(&, logic)
+FASTINT_ARITHMETIC(|, logic)
+FASTINT_ARITHMETIC(^, logic)
+#undef FASTINT_ARITHMETIC
+
+//Values are exact, compared in a storage holding both
+#define FASTINT_COMPARISON(OP) \
+	template<int W1, bool S1, int W2, bool S2> inline bool operator OP(const fast_int<W1,S1>& a, const fast_int<W2,S2>& b){ \
+		typedef typename fast_rt<W1,S1,W2,S2>::plus::storage common; \
+		return (common) a.value OP (common) b.value; \
+	} \
+	template<int W, bool S, class T> inline typename fast_enable<fast_int_of<T>::w, bool>::type \
+	operator OP(const fast_int<W,S>& a, T b){ \
+		return a OP typename fast_int_of<T>::type(b); \
+	} \
+	template<int W, bool S, class T> inline typename fast_enable<fast_int_of<T>::w, bool>::type \
+	operator OP(T a, const fast_int<W,S>& b){ \
+		return typename fast_int_of<T>::type(a) OP b; \
+	}
+FASTINT_COMPARISON(==)
+FASTINT_COMPARISON(!=)
+FASTINT_COMPARISON(<)
+FASTINT_COMPARISON(<=)
+FASTINT_COMPARISON(>)
+FASTINT_COMPARISON(>=)
+#undef FASTINT_COMPARISON
+
+//A shift keeps the width of the value shifted, the bits shifted out are lost
+template<int W, bool S, class T> inline fast_int<W,S> operator<<(const fast_int<W,S>& a, const T& n){
+	int count = (int) n;
+	if(count >= W)
+		return fast_int<W,S>(0);
+	return fast_int<W,S>((typename fast_int<W,S>::storage) ((typename fast_int<W,S>::bits) a.value << count));
+}
+template<int W, bool S, class T> inline fast_int<W,S> operator>>(const fast_int<W,S>& a, const T& n){
+	int count = (int) n;
+	if(count >= fast_int<W,S>::width)
+		return fast_int<W,S>(a.value < 0 ? -1 : 0);
+	return fast_int<W,S>(a.value >> count);
+}
+
+//In decimal whatever the base of the stream, like ac_int
+template<int W, bool S> inline std::ostream& operator<<(std::ostream& os, const fast_int<W,S>& x){
+	std::ios_base::fmtflags flags = os.flags();
+	if(S)
+		os << std::dec << (long long) x.value;
+	else
+		os << std::dec << (unsigned long long) x.value;
+	os.flags(flags);
+	return os;
+}
+
+#undef FASTINT_MAX
+#undef FASTINT_MIN
+
+#endif /* FASTINT_H */
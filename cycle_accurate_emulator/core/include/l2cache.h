@@ -0,0 +1,122 @@
+// vim: set ts=4 nu ai:
+#ifndef L2CACHE_H
+#define L2CACHE_H
+
+#include <portability.h>
+#include <memorylevel.h>
+#include <cache.h>
+#include <missclassifier.h>
+
+#define L2_MAXUPPERS 2
+
+enum InclusionPolicy{
+	NINE_INCLUSION,
+	INCLUSIVE_INCLUSION,
+	EXCLUSIVE_INCLUSION
+};
+
+//Disabled by default, the L1 caches then fill from the DRAM
+struct L2Config{
+	int enabled;
+	int sets;
+	int ways;
+	int lineBytes;
+	int policy;
+	int inclusion;
+	int latency; //Cycles of a hit, before the line is streamed
+	int bytesPerCycle;
+	int classifyMisses;
+
+	L2Config() : enabled(0), sets(512), ways(8), lineBytes(CACHEBLOCKBYTES), policy(LRU_POLICY),
+		inclusion(NINE_INCLUSION), latency(8), bytesPerCycle(16), classifyMisses(0){}
+};
+
+/*********************************************************
+ * 	Unified second-level cache
+ *
+ * 	Both L1 caches fill from it and write their dirty
+ * 	victims back to it. Its line can be larger than theirs.
+ *
+ * 	NINE		misses fill both levels, an L2 eviction
+ * 				leaves the L1 copies in place
+ * 	inclusive	same fills, an L2 eviction invalidates the
+ * 				L1 copies and writes back the dirty ones
+ * 	exclusive	misses fill the L1 only, a hit moves the line
+ * 				up and the L2 is filled with the L1 victims,
+ * 				clean or dirty. The line sizes must match.
+ *
+ * 	A hit costs the hit latency and the transfer of the L1
+ * 	line, a miss the hit latency and the DRAM read. Writebacks
+ * 	of the L2 are buffered, they do not delay the L1.
+ *
+ * 	The 3C classification sees the reads and the writes of
+ * 	the L1 caches; for an exclusive L2 the shadow caches
+ * 	still allocate on reads, its numbers are only indicative.
+ *********************************************************/
+class L2Cache : public MemoryLevel{
+
+	private:
+		L2Config config;
+		int setBits;
+		int idBits;
+
+		cache_index<32>* index; //[sets][ways]
+		CORE_UINT(8)* cache; //[sets][ways][lineBytes]
+		ConfigurablePolicy<CACHE_DYNAMIC>* policy; //[sets]
+		MemoryLevel* next_level;
+		UpperCache* uppers[L2_MAXUPPERS];
+		int nbUppers;
+		int fillCycles; //Of the last allocate
+		MissClassifier* classifier;
+
+		//data structures to collect statistics
+		CORE_UINT(32) n_reads;
+		CORE_UINT(32) n_read_misses;
+		CORE_UINT(32) n_writes;
+		CORE_UINT(32) n_write_misses;
+		CORE_UINT(32) n_victims; //Clean L1 victims kept by an exclusive L2
+		CORE_UINT(32) n_dram_reads;
+		CORE_UINT(32) n_dram_writes;
+		CORE_UINT(32) n_back_invalidations;
+
+		int getSet(CORE_UINT(32) address){
+			return ((address >> idBits) & (config.sets - 1)).to_int();
+		}
+
+		CORE_UINT(32) getTag(CORE_UINT(32) address){
+			return address >> (idBits + setBits);
+		}
+
+		int findWay(int set, CORE_UINT(32) tag);
+		int allocate(int set, CORE_UINT(32) tag, bool fetch, CORE_UINT(32) cycle);
+
+		L2Cache(const L2Cache&);
+		L2Cache& operator=(const L2Cache&);
+
+	public:
+		//Allocates nothing when config.enabled is 0
+		L2Cache(MemoryLevel* next, L2Config config = L2Config());
+		~L2Cache();
+
+		bool isEnabled();
+		void addUpperCache(UpperCache* upper);
+
+		int readLine(CORE_UINT(32) address, CORE_UINT(8)* line, int bytes, CORE_UINT(32) cycle, bool* dirty = NULL);
+		int writeLine(CORE_UINT(32) address, CORE_UINT(8)* line, int bytes, CORE_UINT(32) cycle);
+		void evictLine(CORE_UINT(32) address, CORE_UINT(8)* line, int bytes, CORE_UINT(32) cycle);
+		int getReadCycles(int bytes);
+		int getTransferCycles(int bytes);
+
+		CORE_UINT(32) getNumberReads();
+		CORE_UINT(32) getNumberReadMisses();
+		CORE_UINT(32) getNumberWrites();
+		CORE_UINT(32) getNumberWriteMisses();
+		CORE_UINT(32) getNumberVictims();
+		CORE_UINT(32) getNumberDramReads();
+		CORE_UINT(32) getNumberDramWrites();
+		CORE_UINT(32) getNumberBackInvalidations();
+		//NULL when the misses are not classified
+		MissClassifier* getMissClassifier();
+};
+
+#endif /* L2CACHE_H */
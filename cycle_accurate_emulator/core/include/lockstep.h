@@ -0,0 +1,79 @@
+// vim: set ts=4 nu ai:
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <portability.h>
+#include <registers.h>
+#include <iostream>
+
+class RiscvSimulator;
+class ElfImage;
+
+/*********************************************************
+ * 	Lockstep co-simulation with the instruction set simulator
+ *
+ * 	With simulation.lockstep, the program also runs in a
+ * 	RiscvSimulator (../simulator, linked from its library)
+ * 	and every instruction retired by doWB is stepped there.
+ * 	Both must agree on the PC, the opcode, the register
+ * 	written and its value, and the address, size and data
+ * 	of a store. The first divergence is printed with the
+ * 	last retired instructions and ends the simulation.
+ *
+ * 	The system calls are run once, by the core: the
+ * 	simulator steps over them and takes the result of the
+ * 	core, except for exit.
+ *********************************************************/
+
+#define LOCKSTEP_HISTORY 16
+
+struct LockstepRecord{
+	unsigned int cycle;
+	unsigned int pc;
+	unsigned int instruction;
+	int dest; //0 when no register is written
+	int value;
+};
+
+class IssLockstep{
+	private:
+		RiscvSimulator* iss;
+		LockstepRecord history[LOCKSTEP_HISTORY]; //The last retired instructions, circular
+		unsigned long long retired;
+		bool diverged;
+
+		bool check(unsigned int cycle, unsigned int pc, int opCode, int dest, int value, unsigned int address,
+				int data, int funct3, std::ostream& out);
+		void printHistory(std::ostream& out);
+
+		IssLockstep(const IssLockstep&);
+		IssLockstep& operator=(const IssLockstep&);
+
+	public:
+		enum{ enabled = 1 };
+
+		IssLockstep();
+		~IssLockstep();
+
+		//Loads the program in the simulator, the state it starts from is the one of doStep
+		void load(const ElfImage& image);
+		bool isLoaded() const{
+			return iss != NULL;
+		}
+
+		//Called by doWB, false at the first divergence after printing it to out
+		bool retire(CORE_UINT(32) cycle, const struct MemtoWB& instruction, std::ostream& out){
+			return check(cycle.to_uint(), instruction.pc.to_uint(), instruction.opCode.to_int(),
+					instruction.WBena ? instruction.dest.to_int() : 0, instruction.result.to_int(),
+					instruction.result.to_uint(), instruction.datac.to_int(), instruction.funct3.to_int(), out);
+		}
+
+		bool hasDiverged() const{
+			return diverged;
+		}
+		unsigned long long getNumberRetired() const{
+			return retired;
+		}
+};
+
+#endif /* LOCKSTEP_H */
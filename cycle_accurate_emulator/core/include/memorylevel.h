@@ -0,0 +1,47 @@
+// vim: set ts=4 nu ai:
+#ifndef MEMORYLEVEL_H
+#define MEMORYLEVEL_H
+
+#include <portability.h>
+#include <stddef.h>
+
+/*********************************************************
+ * 	Memory hierarchy
+ *
+ * 	A cache fills its lines from the level below it, which
+ * 	is either the DRAM or the unified L2 (see l2cache.h).
+ * 	Line transfers are issued at cycle and return the number
+ * 	of cycles they take.
+ *
+ * 	The caches above an L2 register themselves as upper
+ * 	caches so that an inclusive L2 can invalidate their
+ * 	copy of the lines it evicts.
+ *********************************************************/
+class MemoryLevel{
+	public:
+		virtual ~MemoryLevel(){}
+
+		//dirty is set when the line moves up still modified, which only an exclusive L2 does
+		virtual int readLine(CORE_UINT(32) address, CORE_UINT(8)* line, int bytes, CORE_UINT(32) cycle,
+				bool* dirty = NULL) = 0;
+		virtual int writeLine(CORE_UINT(32) address, CORE_UINT(8)* line, int bytes, CORE_UINT(32) cycle) = 0;
+		//A clean line was evicted from the level above
+		virtual void evictLine(CORE_UINT(32) address, CORE_UINT(8)* line, int bytes, CORE_UINT(32) cycle){}
+
+		//Cycles of a read that finds the line in this level
+		virtual int getReadCycles(int bytes) = 0;
+		//Cycles during which the data bus is busy with a transfer
+		virtual int getTransferCycles(int bytes) = 0;
+};
+
+class UpperCache{
+	public:
+		virtual ~UpperCache(){}
+
+		virtual bool probe(CORE_UINT(32) address) = 0;
+		//Drops the line of address if present, returns true and copies its data when it was dirty
+		virtual bool invalidateLine(CORE_UINT(32) address, CORE_UINT(8)* data) = 0;
+		virtual int getLineBytes() = 0;
+};
+
+#endif /* MEMORYLEVEL_H */
@@ -0,0 +1,51 @@
+// vim: set ts=4 nu ai:
+#ifndef MISSCLASSIFIER_H
+#define MISSCLASSIFIER_H
+
+#include <portability.h>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+
+/*********************************************************
+ * 	3C miss classification
+ *
+ * 	Two shadow caches see the same demand accesses as the
+ * 	real one, by line address:
+ * 		an infinite cache, which only misses the first
+ * 		time a line is touched,
+ * 		a fully associative LRU cache with the capacity of
+ * 		the real one.
+ * 	A miss of the real cache is compulsory if the infinite
+ * 	cache misses, a capacity miss if the fully associative
+ * 	one misses, and a conflict miss otherwise.
+ *
+ * 	Simulation only, it is not meant to be synthesized.
+ *********************************************************/
+class MissClassifier{
+	private:
+		unsigned int capacity; //Lines
+		std::unordered_set<unsigned int> seen;
+		std::list<unsigned int> lru; //Most recently used first
+		std::unordered_map<unsigned int, std::list<unsigned int>::iterator> lines;
+
+		CORE_UINT(32) n_compulsory;
+		CORE_UINT(32) n_capacity;
+		CORE_UINT(32) n_conflict;
+
+		MissClassifier(const MissClassifier&);
+		MissClassifier& operator=(const MissClassifier&);
+
+	public:
+		MissClassifier(int lines);
+
+		//miss tells whether the real cache missed. Without allocate, the line is only
+		//looked up, like a store miss of a no-write-allocate cache.
+		void access(CORE_UINT(32) lineAddress, bool miss, bool allocate = true);
+
+		CORE_UINT(32) getNumberCompulsory();
+		CORE_UINT(32) getNumberCapacity();
+		CORE_UINT(32) getNumberConflict();
+};
+
+#endif /* MISSCLASSIFIER_H */
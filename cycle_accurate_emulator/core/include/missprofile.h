@@ -0,0 +1,48 @@
+// vim: set ts=4 nu ai:
+#ifndef MISSPROFILE_H
+#define MISSPROFILE_H
+
+#include <portability.h>
+#include <lib/symbolTable.h>
+#include <ostream>
+#include <unordered_map>
+
+#define MISSPROFILE_TOP 20 //Entries of each table of the report
+
+/*********************************************************
+ * 	Miss attribution
+ *
+ * 	A cache given a MissProfile records each of its misses
+ * 	with the PC of the instruction which caused it, the
+ * 	missed address, and whether the miss wrote a dirty line
+ * 	back. The report ranks the instructions and the
+ * 	functions causing the most misses and, for the data
+ * 	cache, the global objects of the .symtab which are
+ * 	missed on the most. Addresses outside of every object
+ * 	(stack, heap) are grouped together.
+ *
+ * 	Simulation only, it is not meant to be synthesized.
+ *********************************************************/
+struct miss_count{
+	unsigned long long misses;
+	unsigned long long writebacks;
+
+	miss_count() : misses(0), writebacks(0){}
+};
+
+class MissProfile{
+	private:
+		std::unordered_map<unsigned int, miss_count> byPc;
+		std::unordered_map<unsigned int, miss_count> byAddress;
+
+		void writeTable(std::ostream& out, const char* title, const char* column,
+				const std::unordered_map<std::string, miss_count>& counts);
+
+	public:
+		void record(CORE_UINT(32) pc, CORE_UINT(32) address, bool writeback);
+
+		//objects adds the table of the missed data objects
+		void writeReport(std::ostream& out, const char* cache, const SymbolTable& symbols, bool objects);
+};
+
+#endif /* MISSPROFILE_H */
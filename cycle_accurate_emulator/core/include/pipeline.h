@@ -0,0 +1,83 @@
+// vim: set ts=4 nu ai:
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <portability.h>
+#include <core.h>
+#include <config.h>
+#include <dram.h>
+#include <cache.h>
+#include <l2cache.h>
+#include <branchpredictor.h>
+#include <missprofile.h>
+#include <cpistack.h>
+#include <cycletrace.h>
+#include <lockstep.h>
+#include <lib/elfImage.h>
+#include <lib/stackDistance.h>
+#include <iostream>
+#include <string>
+#include <stdio.h>
+
+/*********************************************************
+ * 	One simulated core with its memory hierarchy
+ *
+ * 	A pipeline owns its DRAM, caches, branch predictor,
+ * 	profiles, register file and the files opened by its
+ * 	program, and only reads the ELF image it runs: several
+ * 	pipelines run at once from different threads, sharing
+ * 	their images. The messages and the statistics go to
+ * 	the stream given to the constructor, what the program
+ * 	writes on its standard output to stdout unless
+ * 	setProgramOutput says otherwise.
+ *********************************************************/
+class Pipeline{
+	private:
+		Dram dram;
+		L2Cache l2;
+		InstructionCache icache;
+		DataCache dcache;
+		BranchPredictor predictor;
+		const ElfImage& image;
+		std::string missReport;
+		MissProfile icacheProfile;
+		MissProfile dcacheProfile;
+		std::string reuseReport;
+		StackDistance reuse;
+		std::string cpiReport;
+		CpiStack cpi;
+		CycleTrace trace;
+		IssLockstep lockstep;
+		CoreState state;
+		std::ostream& out;
+
+		void loadImage();
+		void printL2Statistics();
+		void printDramStatistics();
+		bool writeMissReport();
+		bool writeReuseReport();
+		bool writeCpiReport();
+
+		Pipeline(const Pipeline&);
+		Pipeline& operator=(const Pipeline&);
+
+	public:
+		Pipeline(const SimulatorConfig& config, const ElfImage& image, std::ostream& out = std::cout);
+
+		//Returns false and says why on stderr when the trace file cannot be written
+		bool openCycleTrace(const SimulatorConfig& config);
+		void setProgramOutput(FILE* output){
+			state.files.output = output;
+		}
+
+		//Runs the program from _start for at most cycles cycles
+		void run(CORE_UINT(32) cycles);
+		//With simulation.lockstep, whether the core and the instruction set simulator disagreed
+		bool hasDiverged() const{
+			return lockstep.hasDiverged();
+		}
+		//Prints the statistics of the L2 and the DRAM and writes the reports asked for, false if one could not be
+		bool writeReports();
+};
+
+#endif /* PIPELINE_H */
@@ -0,0 +1,79 @@
+// vim: set ts=4 nu ai:
+#ifndef PIPELINECONFIG_H
+#define PIPELINECONFIG_H
+
+#include <portability.h>
+#include <cache.h>
+#include <branchpredictor.h>
+#include <cpistack.h>
+#include <cycletrace.h>
+#include <syscall.h>
+#include <lockstep.h>
+
+/*********************************************************
+ * 	Compile-time configurations of the pipeline
+ *
+ * 	doStep is a template on a configuration naming the
+ * 	caches, the branch predictor, the collector of the CPI
+ * 	stack, the sink of the cycle trace, the handler of the
+ * 	system calls and the lockstep checker it is built with.
+ * 	A feature left out is an empty class whose enabled is
+ * 	0: the code feeding it is not generated at all, rather
+ * 	than tested at every cycle. core.cpp instantiates
+ * 	doStep for the five configurations below, the
+ * 	simulator runs the one matching simulation.lockstep,
+ * 	simulation.cpi_report and simulation.trace.
+ *********************************************************/
+
+class NoCpiStack{
+	public:
+		enum{ enabled = 0 };
+		void record(CpiCause cause, CORE_UINT(32) pc){}
+		void recordLast(CpiCause cause){}
+};
+
+class NoCycleTrace{
+	public:
+		enum{ enabled = 0 };
+		void record(CORE_UINT(32) cycle, unsigned int markers, CORE_UINT(32) pc, CORE_UINT(32) instruction,
+				const CORE_INT(32) registers[32]){}
+};
+
+//The system calls are run by the host, see syscall.cpp
+class HostSyscall{
+	public:
+		enum{ enabled = 1 };
+		static CORE_UINT(32) solve(SyscallFiles* files, CORE_UINT(32) syscallId, CORE_UINT(32) arg1, CORE_UINT(32) arg2,
+				CORE_UINT(32) arg3, CORE_UINT(32) arg4, CORE_UINT(2)* sys_status){
+			return solveSysCall(files, syscallId, arg1, arg2, arg3, arg4, sys_status);
+		}
+};
+
+class NoLockstep{
+	public:
+		enum{ enabled = 0 };
+		bool retire(CORE_UINT(32) cycle, const struct MemtoWB& instruction, std::ostream& out){
+			return true;
+		}
+};
+
+template<class STATS, class TRACE, class SYSCALL = HostSyscall, class ICACHE = InstructionCache,
+	class DCACHE = DataCache, class PREDICTOR = BranchPredictor, class CHECKER = NoLockstep>
+struct PipelineConfig{
+	typedef STATS Stats;
+	typedef TRACE Trace;
+	typedef SYSCALL Syscall;
+	typedef ICACHE ICache;
+	typedef DCACHE DCache;
+	typedef PREDICTOR Predictor;
+	typedef CHECKER Checker;
+};
+
+typedef PipelineConfig<NoCpiStack, NoCycleTrace> FastPipeline;
+typedef PipelineConfig<CpiStack, NoCycleTrace> ProfilePipeline;
+typedef PipelineConfig<NoCpiStack, CycleTrace> TracePipeline;
+typedef PipelineConfig<CpiStack, CycleTrace> FullPipeline;
+typedef PipelineConfig<NoCpiStack, NoCycleTrace, HostSyscall, InstructionCache, DataCache, BranchPredictor,
+	IssLockstep> LockstepPipeline;
+
+#endif /* PIPELINECONFIG_H */
@@ -7,6 +7,13 @@
     #define CORE_INT(param) ap_int<param>
     #define SLC(size,low) range(size + low -1, low)
     #define SET_SLC(low, value) range(low + value.length()-1,low) = value
+#elif defined(__FASTSIM__)
+    //Native integers for fast simulation, see fastint.h
+    #include <fastint.h>
+    #define CORE_UINT(param) fast_int<param, false>
+    #define CORE_INT(param) fast_int<param, true>
+    #define SLC(size,low) slc<size>(low)
+    #define SET_SLC(low, value) set_slc(low, value)
 #else
     #include <lib/ac_int.h>
     #define CORE_UINT(param) ac_int<param, false>
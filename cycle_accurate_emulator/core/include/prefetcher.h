@@ -0,0 +1,121 @@
+// vim: set ts=4 nu ai:
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <portability.h>
+
+#define PREFETCH_MAXDEGREE 16
+#define PREFETCH_MAXSTREAMS 16
+#define PREFETCH_STRIDEENTRIES 64
+
+enum PrefetcherType{
+	NO_PREFETCHER,
+	NEXTLINE_PREFETCHER,
+	STRIDE_PREFETCHER,
+	STREAM_PREFETCHER
+};
+
+/*********************************************************
+ * 	Data prefetchers
+ *
+ * 	The cache calls access() on every demand access, with
+ * 	the PC of the memory instruction. miss is set when the
+ * 	line is not in the cache, prefetchHit on the first use
+ * 	of a line brought by a prefetch. The prefetcher writes
+ * 	the addresses of the lines to prefetch in candidates
+ * 	and returns their number; the cache queues them and
+ * 	issues them when the DRAM is not busy with demand
+ * 	misses.
+ *
+ * 	Stream buffers keep the prefetched lines out of the
+ * 	cache: the cache gives them each line it fetched with
+ * 	hold(), and takes a line from them with lookup() on a
+ * 	miss. The other prefetchers fill the cache directly.
+ *********************************************************/
+class Prefetcher{
+	protected:
+		int lineBits;
+		int degree;
+
+	public:
+		Prefetcher(int lineBytes, int degree);
+		virtual ~Prefetcher(){}
+
+		virtual int access(CORE_UINT(32) pc, CORE_UINT(32) address, bool miss, bool prefetchHit,
+				CORE_UINT(32) candidates[PREFETCH_MAXDEGREE]) = 0;
+
+		//False when the line goes into the cache
+		virtual bool hold(CORE_UINT(32) line, CORE_UINT(32) ready){
+			return false;
+		}
+
+		//True if the prefetcher holds the line, ready is the cycle at which its data is available
+		virtual bool lookup(CORE_UINT(32) line, CORE_UINT(32)* ready){
+			return false;
+		}
+};
+
+//Tagged next-line: the degree following lines on a miss or on the first use of a prefetched line
+class NextLinePrefetcher : public Prefetcher{
+	public:
+		NextLinePrefetcher(int lineBytes, int degree);
+
+		int access(CORE_UINT(32) pc, CORE_UINT(32) address, bool miss, bool prefetchHit,
+				CORE_UINT(32) candidates[PREFETCH_MAXDEGREE]);
+};
+
+//Reference prediction table indexed by the PC, prefetches once a stride has been seen twice in a row
+struct stride_entry{
+	CORE_UINT(32) pc;
+	CORE_UINT(32) address;
+	CORE_INT(32) stride;
+	CORE_UINT(2) confidence;
+	CORE_UINT(1) valid;
+};
+
+class StridePrefetcher : public Prefetcher{
+	private:
+		stride_entry table[PREFETCH_STRIDEENTRIES];
+
+	public:
+		StridePrefetcher(int lineBytes, int degree);
+
+		int access(CORE_UINT(32) pc, CORE_UINT(32) address, bool miss, bool prefetchHit,
+				CORE_UINT(32) candidates[PREFETCH_MAXDEGREE]);
+};
+
+//Sequential stream buffers: a miss which is not at the head of a buffer allocates the least recently used one
+struct stream_entry{
+	CORE_UINT(32) line;
+	CORE_UINT(32) ready; //0 until the prefetch is issued
+};
+
+struct stream_buffer{
+	stream_entry entries[PREFETCH_MAXDEGREE];
+	int head;
+	int count;
+	CORE_UINT(32) next; //Next line to prefetch
+	CORE_UINT(32) lastUse;
+	CORE_UINT(1) valid;
+};
+
+class StreamBufferPrefetcher : public Prefetcher{
+	private:
+		stream_buffer streams[PREFETCH_MAXSTREAMS];
+		int nbStreams;
+		int hitStream; //Stream which served the last lookup, -1 if none
+		CORE_UINT(32) uses;
+
+	public:
+		StreamBufferPrefetcher(int lineBytes, int degree, int streams);
+
+		int access(CORE_UINT(32) pc, CORE_UINT(32) address, bool miss, bool prefetchHit,
+				CORE_UINT(32) candidates[PREFETCH_MAXDEGREE]);
+		bool hold(CORE_UINT(32) line, CORE_UINT(32) ready);
+		bool lookup(CORE_UINT(32) line, CORE_UINT(32)* ready);
+};
+
+//NULL for NO_PREFETCHER
+Prefetcher* createPrefetcher(int type, int lineBytes, int degree, int streams);
+
+#endif /* PREFETCHER_H */
@@ -2,10 +2,12 @@
 #define REGISTERS_H_
 
 #include "portability.h"
+#include <branchpredictor.h>
 
 struct FtoDC{
 	CORE_UINT(32) pc;
 	CORE_UINT(32) instruction; //Instruction to execute
+	struct branch_prediction prediction;
 };
 	
 struct DCtoEx{
@@ -24,6 +26,7 @@ struct DCtoEx{
     CORE_UINT(6) shamt;
     CORE_UINT(5) rs1;
     CORE_UINT(5) rs2;        
+	struct branch_prediction prediction;
 };
 	
 struct ExtoMem{
@@ -38,6 +41,9 @@ struct ExtoMem{
 	CORE_UINT(5) rs2;
 	CORE_UINT(7) funct3;
 	CORE_UINT(2) sys_status;
+	struct branch_prediction prediction;
+	CORE_UINT(1) taken; //Of a control instruction, whose target is memValue
+	CORE_UINT(1) mispredict; //The younger instructions are on the wrong path
 };
 
 struct MemtoWB{
@@ -46,6 +52,11 @@ struct MemtoWB{
 	CORE_UINT(1) WBena; //Is a WB is needed ?
     CORE_UINT(7) opCode; 
     CORE_UINT(2) sys_status;
+	//What the instruction leaving do_Mem did, for the lockstep checker only
+	CORE_UINT(1) retire; //Set once per instruction on the correct path
+	CORE_UINT(32) pc;
+	CORE_INT(32) datac; //Stored data, at the address in result
+	CORE_UINT(7) funct3;
 };
 
 //CORE_INT(32) ins_memory[8192]; //Instruction Memory(byte addressable), so it is divided into 4 memory blocks to address 1 instruction
@@ -1,4 +1,21 @@
+#ifndef SYSCALL_H_
+#define SYSCALL_H_
+
 #include "portability.h"
+#include <map>
+#include <stdio.h>
+
+//The files of one simulated program, each pipeline has its own
+struct SyscallFiles{
+	std::map<CORE_INT(16), FILE*> fileMap;
+	FILE **inStreams, **outStreams;
+	int nbInStreams, nbOutStreams;
+	FILE* output; //Receives what the program writes to its standard output
+
+	SyscallFiles() : inStreams(NULL), outStreams(NULL), nbInStreams(0), nbOutStreams(0), output(stdout){}
+};
+
+CORE_UINT(32) solveSysCall(SyscallFiles* files, CORE_UINT(32) syscallId, CORE_UINT(32) arg1, CORE_UINT(32) arg2,
+ CORE_UINT(32) arg3, CORE_UINT(32) arg4, CORE_UINT(2) *sys_status);
 
-CORE_UINT(32) solveSysCall(CORE_UINT(32) syscallId, CORE_UINT(32) arg1, CORE_UINT(32) arg2,CORE_UINT(32) arg3,
- CORE_UINT(32) arg4, CORE_UINT(2) *sys_status);
\ No newline at end of file
+#endif /* SYSCALL_H_ */
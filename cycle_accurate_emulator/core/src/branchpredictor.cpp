@@ -0,0 +1,220 @@
+// vim: set ts=4 nu ai:
+#include <branchpredictor.h>
+#include <isa/riscvISA.h>
+#include <stddef.h>
+
+//x1 and x5 are the link registers of the calling convention
+static bool isLink(CORE_UINT(5) reg){
+	return reg == 1 || reg == 5;
+}
+
+static CORE_UINT(2) train(CORE_UINT(2) counter, bool taken){
+	if(taken && counter < 3)
+		return counter + 1;
+	if(!taken && counter > 0)
+		return counter - 1;
+	return counter;
+}
+
+BranchPredictor::BranchPredictor(PredictorConfig config){
+	this->config = config;
+	bimodal = NULL;
+	gshare = NULL;
+	chooser = NULL;
+	btb = NULL;
+	rasTop = 0;
+	rasCount = 0;
+	history = 0;
+	for(int i=0;i<PREDICTOR_KINDS;i++){
+		n_branches[i] = 0;
+		n_mispredicted[i] = 0;
+	}
+	if(config.type == NO_PREDICTOR)
+		return;
+
+	int entries = 1 << config.tableBits;
+	if(config.type == BIMODAL_PREDICTOR || config.type == TOURNAMENT_PREDICTOR){
+		bimodal = new CORE_UINT(2)[entries];
+		for(int i=0;i<entries;i++)
+			bimodal[i] = 1;
+	}
+	if(config.type == GSHARE_PREDICTOR || config.type == TOURNAMENT_PREDICTOR){
+		gshare = new CORE_UINT(2)[entries];
+		for(int i=0;i<entries;i++)
+			gshare[i] = 1;
+	}
+	if(config.type == TOURNAMENT_PREDICTOR){
+		chooser = new CORE_UINT(2)[entries];
+		for(int i=0;i<entries;i++)
+			chooser[i] = 1;
+	}
+	btb = new btb_entry[config.btbEntries];
+	for(int i=0;i<config.btbEntries;i++)
+		btb[i].valid = 0;
+}
+
+BranchPredictor::~BranchPredictor(){
+	delete[] bimodal;
+	delete[] gshare;
+	delete[] chooser;
+	delete[] btb;
+}
+
+bool BranchPredictor::isEnabled(){
+	return config.type != NO_PREDICTOR;
+}
+
+const char* BranchPredictor::getName(){
+	switch(config.type){
+		case NOTTAKEN_PREDICTOR:
+			return "nottaken";
+		case BTFN_PREDICTOR:
+			return "btfn";
+		case BIMODAL_PREDICTOR:
+			return "bimodal";
+		case GSHARE_PREDICTOR:
+			return "gshare";
+		case TOURNAMENT_PREDICTOR:
+			return "tournament";
+	}
+	return "none";
+}
+
+int BranchPredictor::getIndex(CORE_UINT(32) pc){
+	return ((pc >> 2) & ((1 << config.tableBits) - 1)).to_int();
+}
+
+int BranchPredictor::getGshareIndex(CORE_UINT(32) pc, CORE_UINT(16) history){
+	CORE_UINT(32) global = history & ((1 << config.historyBits) - 1);
+	return (((pc >> 2) ^ global) & ((1 << config.tableBits) - 1)).to_int();
+}
+
+bool BranchPredictor::predictDirection(CORE_UINT(32) pc, bool backward, CORE_UINT(16) history){
+	switch(config.type){
+		case BTFN_PREDICTOR:
+			return backward;
+		case BIMODAL_PREDICTOR:
+			return bimodal[getIndex(pc)] >= 2;
+		case GSHARE_PREDICTOR:
+			return gshare[getGshareIndex(pc, history)] >= 2;
+		case TOURNAMENT_PREDICTOR:
+			if(chooser[getIndex(pc)] >= 2)
+				return gshare[getGshareIndex(pc, history)] >= 2;
+			return bimodal[getIndex(pc)] >= 2;
+	}
+	return false;
+}
+
+CORE_UINT(32) BranchPredictor::predict(CORE_UINT(32) pc, CORE_UINT(32) instruction, branch_prediction* prediction){
+	CORE_UINT(7) opcode = instruction.SLC(7,0);
+	CORE_UINT(5) rd = instruction.SLC(5,7);
+	CORE_UINT(5) rs1 = instruction.SLC(5,15);
+
+	int kind = NOT_BRANCH;
+	if(opcode == RISCV_BR)
+		kind = CONDITIONAL_BRANCH;
+	else if(opcode == RISCV_JAL)
+		kind = DIRECT_JUMP;
+	//A JALR writing the link register it reads is a call, not a return
+	else if(opcode == RISCV_JALR)
+		kind = isLink(rs1) && (!isLink(rd) || rd != rs1) ? RETURN_JUMP : INDIRECT_JUMP;
+	//The sign of the offset of a branch
+	bool backward = instruction[31] == 1;
+	return predict(pc, kind, kind != CONDITIONAL_BRANCH && isLink(rd), backward, prediction);
+}
+
+CORE_UINT(32) BranchPredictor::predict(CORE_UINT(32) pc, int kind, bool call, bool backward, branch_prediction* prediction){
+	prediction->kind = kind;
+	prediction->taken = 0;
+	prediction->target = pc + 4;
+	prediction->history = history;
+
+	if(prediction->kind != NOT_BRANCH && config.type != NO_PREDICTOR && config.type != NOTTAKEN_PREDICTOR){
+		btb_entry& entry = btb[(pc >> 2).to_int() & (config.btbEntries - 1)];
+		bool hit = entry.valid && entry.pc == pc;
+		if(hit)
+			prediction->target = entry.target;
+
+		switch(prediction->kind){
+			case CONDITIONAL_BRANCH:
+				prediction->taken = hit && predictDirection(pc, backward, history);
+				history = (history << 1) | prediction->taken;
+				break;
+			case RETURN_JUMP:
+				if(config.rasEntries && rasCount > 0){
+					rasTop = rasTop == 0 ? config.rasEntries - 1 : rasTop.to_int() - 1;
+					rasCount--;
+					prediction->target = ras[rasTop.to_int()];
+					prediction->taken = 1;
+				}
+				else
+					prediction->taken = hit;
+				break;
+			default:
+				prediction->taken = hit;
+				break;
+		}
+
+		//The return address of a call is pushed, the oldest entry is lost when the stack is full
+		if(call && config.rasEntries){
+			ras[rasTop.to_int()] = pc + 4;
+			rasTop = rasTop.to_int() + 1 == config.rasEntries ? 0 : rasTop.to_int() + 1;
+			if(rasCount < config.rasEntries)
+				rasCount++;
+		}
+	}
+	prediction->rasTop = rasTop;
+	prediction->rasCount = rasCount;
+	if(prediction->taken)
+		return prediction->target;
+	return pc + 4;
+}
+
+void BranchPredictor::recover(const branch_prediction& prediction, bool taken){
+	history = prediction.history;
+	if(prediction.kind == CONDITIONAL_BRANCH)
+		history = (history << 1) | taken;
+	rasTop = prediction.rasTop;
+	rasCount = prediction.rasCount;
+}
+
+void BranchPredictor::update(CORE_UINT(32) pc, const branch_prediction& prediction, bool taken, CORE_UINT(32) target,
+		bool mispredicted){
+	int kind = prediction.kind.to_int();
+	n_branches[kind]++;
+	if(mispredicted)
+		n_mispredicted[kind]++;
+	if(config.type == NO_PREDICTOR || config.type == NOTTAKEN_PREDICTOR)
+		return;
+
+	if(taken){
+		btb_entry& entry = btb[(pc >> 2).to_int() & (config.btbEntries - 1)];
+		entry.pc = pc;
+		entry.target = target;
+		entry.valid = 1;
+	}
+	if(kind != CONDITIONAL_BRANCH)
+		return;
+
+	//The components are trained with the history the branch was predicted with
+	int index = getIndex(pc);
+	int gshareIndex = getGshareIndex(pc, prediction.history);
+	if(chooser != NULL){
+		bool bimodalTaken = bimodal[index] >= 2;
+		bool gshareTaken = gshare[gshareIndex] >= 2;
+		if(bimodalTaken != gshareTaken)
+			chooser[index] = train(chooser[index], gshareTaken == taken);
+	}
+	if(bimodal != NULL)
+		bimodal[index] = train(bimodal[index], taken);
+	if(gshare != NULL)
+		gshare[gshareIndex] = train(gshare[gshareIndex], taken);
+}
+
+CORE_UINT(32) BranchPredictor::getNumberBranches(int kind){
+	return n_branches[kind];
+}
+
+CORE_UINT(32) BranchPredictor::getNumberMispredicted(int kind){
+	return n_mispredicted[kind];
+}
@@ -0,0 +1,572 @@
+// vim: set ts=4 nu ai:
+#include <config.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+
+using namespace std;
+
+static string trim(const string& text){
+	size_t first = text.find_first_not_of(" \t\r\n");
+	if(first == string::npos)
+		return "";
+	size_t last = text.find_last_not_of(" \t\r\n");
+	return text.substr(first, last - first + 1);
+}
+
+static bool parseInt(const string& value, int* result){
+	char* end;
+	long number = strtol(value.c_str(), &end, 0);
+	if(value.empty() || *end != '\0' || number < 0 || number > 0x7fffffff)
+		return false;
+	*result = number;
+	return true;
+}
+
+static bool parsePolicy(const string& value, int* result){
+	if(value == "lru")
+		*result = LRU_POLICY;
+	else if(value == "plru")
+		*result = PLRU_POLICY;
+	else if(value == "fifo")
+		*result = FIFO_POLICY;
+	else if(value == "random")
+		*result = RANDOM_POLICY;
+	else
+		return false;
+	return true;
+}
+
+static bool parsePrefetcher(const string& value, int* result){
+	if(value == "none")
+		*result = NO_PREFETCHER;
+	else if(value == "nextline")
+		*result = NEXTLINE_PREFETCHER;
+	else if(value == "stride")
+		*result = STRIDE_PREFETCHER;
+	else if(value == "stream")
+		*result = STREAM_PREFETCHER;
+	else
+		return false;
+	return true;
+}
+
+static bool parseInclusion(const string& value, int* result){
+	if(value == "nine")
+		*result = NINE_INCLUSION;
+	else if(value == "inclusive")
+		*result = INCLUSIVE_INCLUSION;
+	else if(value == "exclusive")
+		*result = EXCLUSIVE_INCLUSION;
+	else
+		return false;
+	return true;
+}
+
+static bool parseDramModel(const string& value, int* result){
+	if(value == "fixed")
+		*result = FIXED_DRAM;
+	else if(value == "banked")
+		*result = BANKED_DRAM;
+	else
+		return false;
+	return true;
+}
+
+static bool parsePagePolicy(const string& value, int* result){
+	if(value == "open")
+		*result = OPEN_PAGE;
+	else if(value == "closed")
+		*result = CLOSED_PAGE;
+	else
+		return false;
+	return true;
+}
+
+static bool parseScheduler(const string& value, int* result){
+	if(value == "fcfs")
+		*result = FCFS_SCHEDULER;
+	else if(value == "frfcfs")
+		*result = FRFCFS_SCHEDULER;
+	else
+		return false;
+	return true;
+}
+
+static bool setDramValue(DramConfig* dram, const string& key, const string& value){
+	if(key == "model")
+		return parseDramModel(value, &dram->model);
+	if(key == "page_policy")
+		return parsePagePolicy(value, &dram->pagePolicy);
+	if(key == "scheduler")
+		return parseScheduler(value, &dram->scheduler);
+	if(key == "read_latency")
+		return parseInt(value, &dram->readLatency);
+	if(key == "write_latency")
+		return parseInt(value, &dram->writeLatency);
+	if(key == "bytes_per_cycle")
+		return parseInt(value, &dram->bytesPerCycle);
+	if(key == "banks")
+		return parseInt(value, &dram->banks);
+	if(key == "row")
+		return parseInt(value, &dram->rowBytes);
+	if(key == "t_cas")
+		return parseInt(value, &dram->tCas);
+	if(key == "t_rcd")
+		return parseInt(value, &dram->tRcd);
+	if(key == "t_rp")
+		return parseInt(value, &dram->tRp);
+	if(key == "burst_length")
+		return parseInt(value, &dram->burstLength);
+	if(key == "refresh_interval")
+		return parseInt(value, &dram->refreshInterval);
+	if(key == "refresh_cycles")
+		return parseInt(value, &dram->refreshCycles);
+	if(key == "queue_size")
+		return parseInt(value, &dram->queueSize);
+	if(key == "stats_window")
+		return parseInt(value, &dram->statsWindow);
+	return false;
+}
+
+static bool setL2Value(L2Config* l2, const string& key, const string& value){
+	if(key == "enabled")
+		return parseInt(value, &l2->enabled);
+	if(key == "policy")
+		return parsePolicy(value, &l2->policy);
+	if(key == "inclusion")
+		return parseInclusion(value, &l2->inclusion);
+	if(key == "sets")
+		return parseInt(value, &l2->sets);
+	if(key == "ways")
+		return parseInt(value, &l2->ways);
+	if(key == "line")
+		return parseInt(value, &l2->lineBytes);
+	if(key == "latency")
+		return parseInt(value, &l2->latency);
+	if(key == "bytes_per_cycle")
+		return parseInt(value, &l2->bytesPerCycle);
+	if(key == "classify_misses")
+		return parseInt(value, &l2->classifyMisses);
+	return false;
+}
+
+static bool parsePredictor(const string& value, int* result){
+	if(value == "none")
+		*result = NO_PREDICTOR;
+	else if(value == "nottaken")
+		*result = NOTTAKEN_PREDICTOR;
+	else if(value == "btfn")
+		*result = BTFN_PREDICTOR;
+	else if(value == "bimodal")
+		*result = BIMODAL_PREDICTOR;
+	else if(value == "gshare")
+		*result = GSHARE_PREDICTOR;
+	else if(value == "tournament")
+		*result = TOURNAMENT_PREDICTOR;
+	else
+		return false;
+	return true;
+}
+
+static bool parseTraceMode(const string& value, int* result){
+	if(value == "off")
+		*result = TRACE_OFF;
+	else if(value == "sampled")
+		*result = TRACE_SAMPLED;
+	else if(value == "full")
+		*result = TRACE_FULL;
+	else
+		return false;
+	return true;
+}
+
+static bool setPredictorValue(PredictorConfig* predictor, const string& key, const string& value){
+	if(key == "type")
+		return parsePredictor(value, &predictor->type);
+	if(key == "table_bits")
+		return parseInt(value, &predictor->tableBits);
+	if(key == "history_bits")
+		return parseInt(value, &predictor->historyBits);
+	if(key == "btb_entries")
+		return parseInt(value, &predictor->btbEntries);
+	if(key == "ras_entries")
+		return parseInt(value, &predictor->rasEntries);
+	return false;
+}
+
+static bool parseWritePolicy(const string& value, int* result){
+	if(value == "writeback")
+		*result = WRITE_BACK;
+	else if(value == "writethrough")
+		*result = WRITE_THROUGH;
+	else
+		return false;
+	return true;
+}
+
+static bool setCacheValue(CacheConfig* cache, const string& key, const string& value){
+	if(key == "policy")
+		return parsePolicy(value, &cache->policy);
+	if(key == "sets")
+		return parseInt(value, &cache->sets);
+	if(key == "ways")
+		return parseInt(value, &cache->ways);
+	if(key == "line")
+		return parseInt(value, &cache->lineBytes);
+	if(key == "mshrs")
+		return parseInt(value, &cache->mshrs);
+	if(key == "prefetcher")
+		return parsePrefetcher(value, &cache->prefetcher);
+	if(key == "prefetch_degree")
+		return parseInt(value, &cache->prefetchDegree);
+	if(key == "prefetch_streams")
+		return parseInt(value, &cache->prefetchStreams);
+	if(key == "write_policy")
+		return parseWritePolicy(value, &cache->writePolicy);
+	if(key == "write_allocate")
+		return parseInt(value, &cache->writeAllocate);
+	if(key == "write_buffer")
+		return parseInt(value, &cache->writeBuffer);
+	if(key == "victim_lines")
+		return parseInt(value, &cache->victimLines);
+	if(key == "victim_latency")
+		return parseInt(value, &cache->victimLatency);
+	if(key == "classify_misses")
+		return parseInt(value, &cache->classifyMisses);
+	return false;
+}
+
+bool setConfigValue(SimulatorConfig* config, const string& section, const string& key, const string& value){
+	bool valid = false;
+	if(section == "simulation"){
+		if(key == "elf"){
+			config->elfFile = value;
+			valid = true;
+		}
+		else if(key == "cycles")
+			valid = parseInt(value, &config->cycles);
+		else if(key == "miss_report"){
+			config->missReport = value;
+			valid = true;
+		}
+		else if(key == "reuse_report"){
+			config->reuseReport = value;
+			valid = true;
+		}
+		else if(key == "cpi_report"){
+			config->cpiReport = value;
+			valid = true;
+		}
+		else if(key == "trace")
+			valid = parseTraceMode(value, &config->traceMode);
+		else if(key == "trace_file"){
+			config->traceFile = value;
+			valid = true;
+		}
+		else if(key == "trace_interval")
+			valid = parseInt(value, &config->traceInterval);
+		else if(key == "lockstep")
+			valid = parseInt(value, &config->lockstep);
+	}
+	else if(section == "icache")
+		valid = setCacheValue(&config->icache, key, value);
+	else if(section == "dcache")
+		valid = setCacheValue(&config->dcache, key, value);
+	else if(section == "l2")
+		valid = setL2Value(&config->l2, key, value);
+	else if(section == "dram")
+		valid = setDramValue(&config->dram, key, value);
+	else if(section == "predictor")
+		valid = setPredictorValue(&config->predictor, key, value);
+
+	if(!valid)
+		cerr << "Invalid configuration " << section << "." << key << " = " << value << endl;
+	return valid;
+}
+
+bool readConfigFile(SimulatorConfig* config, const char* fileName){
+	ifstream file(fileName);
+	if(!file){
+		cerr << "Could not open configuration file " << fileName << endl;
+		return false;
+	}
+
+	string line, section;
+	int lineNumber = 0;
+	while(getline(file, line)){
+		lineNumber++;
+		line = trim(line);
+		if(line.empty() || line[0] == '#' || line[0] == ';')
+			continue;
+
+		if(line[0] == '['){
+			if(line[line.size() - 1] != ']'){
+				cerr << fileName << ":" << lineNumber << ": unterminated section" << endl;
+				return false;
+			}
+			section = trim(line.substr(1, line.size() - 2));
+			continue;
+		}
+
+		size_t equal = line.find('=');
+		if(equal == string::npos){
+			cerr << fileName << ":" << lineNumber << ": expected key = value" << endl;
+			return false;
+		}
+		if(!setConfigValue(config, section, trim(line.substr(0, equal)), trim(line.substr(equal + 1)))){
+			cerr << fileName << ":" << lineNumber << ": invalid entry" << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool checkCache(const char* name, const CacheConfig& cache){
+	bool valid = true;
+	if(cache.sets <= 0 || (cache.sets & (cache.sets - 1))){
+		cerr << name << ".sets must be a power of two" << endl;
+		valid = false;
+	}
+	if(cache.ways <= 0 || (cache.ways & (cache.ways - 1)) || cache.ways > CACHE_MAXWAYS){
+		cerr << name << ".ways must be a power of two, at most " << CACHE_MAXWAYS << endl;
+		valid = false;
+	}
+	if(cache.lineBytes < 4 || (cache.lineBytes & (cache.lineBytes - 1))){
+		cerr << name << ".line must be a power of two, at least 4 bytes" << endl;
+		valid = false;
+	}
+	if(cache.victimLines < 0 || cache.victimLines > CACHE_MAXVICTIMS){
+		cerr << name << ".victim_lines must be between 0 and " << CACHE_MAXVICTIMS << endl;
+		valid = false;
+	}
+	if(cache.classifyMisses < 0 || cache.classifyMisses > 1){
+		cerr << name << ".classify_misses must be 0 or 1" << endl;
+		valid = false;
+	}
+	if(cache.victimLatency < 1 || cache.victimLatency > 0x3fff){
+		cerr << name << ".victim_latency must be between 1 and " << 0x3fff << endl;
+		valid = false;
+	}
+	if(valid && (long) cache.sets * cache.ways * cache.lineBytes > 0x10000000){
+		cerr << name << " is larger than 256MB" << endl;
+		valid = false;
+	}
+	return valid;
+}
+
+bool checkConfig(const SimulatorConfig* config){
+	bool valid = checkCache("icache", config->icache);
+	valid = checkCache("dcache", config->dcache) && valid;
+	if(config->icache.mshrs != 0){
+		cerr << "icache.mshrs must be 0, instruction fetch blocks on misses" << endl;
+		valid = false;
+	}
+	if(config->dcache.mshrs > CACHE_MAXMSHRS){
+		cerr << "dcache.mshrs must be at most " << CACHE_MAXMSHRS << endl;
+		valid = false;
+	}
+	if(config->icache.prefetcher != NO_PREFETCHER){
+		cerr << "icache.prefetcher must be none, only the data cache has prefetchers" << endl;
+		valid = false;
+	}
+	if(config->icache.writePolicy != WRITE_BACK || config->icache.writeAllocate != 1 || config->icache.writeBuffer != 0){
+		cerr << "icache.write_policy, write_allocate and write_buffer cannot be changed, the icache is never written" << endl;
+		valid = false;
+	}
+	if(config->dcache.writeAllocate > 1){
+		cerr << "dcache.write_allocate must be 0 or 1" << endl;
+		valid = false;
+	}
+	if(config->dcache.writeBuffer > CACHE_MAXWRITEBUFFER){
+		cerr << "dcache.write_buffer must be at most " << CACHE_MAXWRITEBUFFER << endl;
+		valid = false;
+	}
+	if(config->dcache.prefetchDegree < 1 || config->dcache.prefetchDegree > PREFETCH_MAXDEGREE){
+		cerr << "dcache.prefetch_degree must be between 1 and " << PREFETCH_MAXDEGREE << endl;
+		valid = false;
+	}
+	if(config->dcache.prefetchStreams < 1 || config->dcache.prefetchStreams > PREFETCH_MAXSTREAMS){
+		cerr << "dcache.prefetch_streams must be between 1 and " << PREFETCH_MAXSTREAMS << endl;
+		valid = false;
+	}
+	if(config->l2.enabled){
+		CacheConfig l2;
+		l2.sets = config->l2.sets;
+		l2.ways = config->l2.ways;
+		l2.lineBytes = config->l2.lineBytes;
+		l2.classifyMisses = config->l2.classifyMisses;
+		valid = checkCache("l2", l2) && valid;
+		if(config->l2.lineBytes < config->icache.lineBytes || config->l2.lineBytes < config->dcache.lineBytes){
+			cerr << "l2.line must be at least the line of the L1 caches" << endl;
+			valid = false;
+		}
+		if(config->l2.inclusion == EXCLUSIVE_INCLUSION && (config->l2.lineBytes != config->icache.lineBytes
+				|| config->l2.lineBytes != config->dcache.lineBytes)){
+			cerr << "An exclusive l2 must have the line of the L1 caches" << endl;
+			valid = false;
+		}
+		if(config->l2.bytesPerCycle <= 0){
+			cerr << "l2.bytes_per_cycle must be positive" << endl;
+			valid = false;
+		}
+		if(config->l2.latency > 0x3fff){
+			cerr << "l2.latency is too large" << endl;
+			valid = false;
+		}
+	}
+	if(config->dram.bytesPerCycle <= 0){
+		cerr << "dram.bytes_per_cycle must be positive" << endl;
+		valid = false;
+	}
+	if(config->dram.banks <= 0 || (config->dram.banks & (config->dram.banks - 1)) || config->dram.banks > DRAM_MAXBANKS){
+		cerr << "dram.banks must be a power of two, at most " << DRAM_MAXBANKS << endl;
+		valid = false;
+	}
+	if(config->dram.rowBytes < 64 || (config->dram.rowBytes & (config->dram.rowBytes - 1))){
+		cerr << "dram.row must be a power of two, at least 64 bytes" << endl;
+		valid = false;
+	}
+	if(config->dram.burstLength <= 0){
+		cerr << "dram.burst_length must be positive" << endl;
+		valid = false;
+	}
+	if(config->dram.refreshInterval != 0 && config->dram.refreshCycles >= config->dram.refreshInterval){
+		cerr << "dram.refresh_cycles must be shorter than dram.refresh_interval (0 disables the refresh)" << endl;
+		valid = false;
+	}
+	if(config->dram.queueSize < 1 || config->dram.queueSize > DRAM_MAXQUEUE){
+		cerr << "dram.queue_size must be between 1 and " << DRAM_MAXQUEUE << endl;
+		valid = false;
+	}
+	if(config->dram.statsWindow <= 0){
+		cerr << "dram.stats_window must be positive" << endl;
+		valid = false;
+	}
+	if(config->predictor.tableBits < 1 || config->predictor.tableBits > PREDICTOR_MAXTABLEBITS){
+		cerr << "predictor.table_bits must be between 1 and " << PREDICTOR_MAXTABLEBITS << endl;
+		valid = false;
+	}
+	if(config->predictor.historyBits < 1 || config->predictor.historyBits > PREDICTOR_MAXHISTORYBITS){
+		cerr << "predictor.history_bits must be between 1 and " << PREDICTOR_MAXHISTORYBITS << endl;
+		valid = false;
+	}
+	if(config->predictor.btbEntries <= 0 || (config->predictor.btbEntries & (config->predictor.btbEntries - 1))
+			|| config->predictor.btbEntries > PREDICTOR_MAXBTB){
+		cerr << "predictor.btb_entries must be a power of two, at most " << PREDICTOR_MAXBTB << endl;
+		valid = false;
+	}
+	if(config->predictor.rasEntries > PREDICTOR_MAXRAS){
+		cerr << "predictor.ras_entries must be at most " << PREDICTOR_MAXRAS << endl;
+		valid = false;
+	}
+	//The stall counters of the pipeline are 16 bits wide, a dirty miss reads and writes the largest line
+	int lineBytes = config->l2.enabled ? config->l2.lineBytes : config->dcache.lineBytes;
+	if(config->icache.lineBytes > lineBytes)
+		lineBytes = config->icache.lineBytes;
+	int access = config->dram.model == BANKED_DRAM ? config->dram.tRp + config->dram.tRcd + config->dram.tCas
+			+ config->dram.refreshCycles : config->dram.readLatency + config->dram.writeLatency;
+	if(valid && lineBytes / config->dram.bytesPerCycle * 2 + access + config->l2.latency * 2 > 0x7fff){
+		cerr << "DRAM latencies are too large" << endl;
+		valid = false;
+	}
+	if(config->cycles <= 0){
+		cerr << "simulation.cycles must be positive" << endl;
+		valid = false;
+	}
+	if(config->traceMode != TRACE_OFF && config->traceFile.empty()){
+		cerr << "simulation.trace_file must be set to trace the cycles" << endl;
+		valid = false;
+	}
+	if(config->traceInterval <= 0){
+		cerr << "simulation.trace_interval must be positive" << endl;
+		valid = false;
+	}
+	if(config->lockstep && (!config->cpiReport.empty() || config->traceMode != TRACE_OFF)){
+		cerr << "simulation.lockstep cannot be combined with simulation.cpi_report or simulation.trace" << endl;
+		valid = false;
+	}
+	return valid;
+}
+
+void printConfigUsage(const char* program){
+	cerr << "Usage: " << program << " [-c file.ini] [-o section.key=value]... [-n cycles] [-b jobs [-j threads]] [elf]" << endl;
+	cerr << "  -c file.ini           read the configuration from an INI file" << endl;
+	cerr << "  -o section.key=value  override one value, applied after -c" << endl;
+	cerr << "  -n cycles             stop after this number of cycles (simulation.cycles)" << endl;
+	cerr << "  -b jobs               run a batch, one line per run: an ELF file (elf by default) and" << endl;
+	cerr << "                        section.key=value overrides applied after the others, separated by spaces" << endl;
+	cerr << "  -j threads            runs of the batch simulated at once (all the host threads by default)" << endl;
+	cerr << "Keys: simulation.{elf,cycles,miss_report,reuse_report,cpi_report,trace,trace_file,trace_interval,lockstep}," << endl;
+	cerr << "      icache/dcache.{sets,ways,line,policy,victim_lines,victim_latency,classify_misses}," << endl;
+	cerr << "      dcache.{mshrs,prefetcher,prefetch_degree,prefetch_streams,write_policy,write_allocate,write_buffer}," << endl;
+	cerr << "      l2.{enabled,sets,ways,line,policy,inclusion,latency,bytes_per_cycle,classify_misses}," << endl;
+	cerr << "      dram.{model,read_latency,write_latency,bytes_per_cycle,banks,row,t_cas,t_rcd,t_rp," << endl;
+	cerr << "      burst_length,refresh_interval,refresh_cycles,page_policy,scheduler,queue_size,stats_window}," << endl;
+	cerr << "      predictor.{type,table_bits,history_bits,btb_entries,ras_entries}" << endl;
+	cerr << "The default ELF file is " << CONFIG_DEFAULTELF << endl;
+}
+
+bool applyOverride(SimulatorConfig* config, const string& option){
+	size_t dot = option.find('.');
+	size_t equal = option.find('=');
+	if(dot == string::npos || equal == string::npos || dot > equal){
+		cerr << "Expected section.key=value, got " << option << endl;
+		return false;
+	}
+	return setConfigValue(config, option.substr(0, dot), option.substr(dot + 1, equal - dot - 1), option.substr(equal + 1));
+}
+
+bool parseArguments(SimulatorConfig* config, int argc, char** argv){
+	const char* configFile = NULL;
+	vector<string> overrides;
+	int option;
+
+	while((option = getopt(argc, argv, "c:o:n:b:j:h")) != -1){
+		switch(option){
+			case 'c':
+				configFile = optarg;
+				break;
+			case 'o':
+				overrides.push_back(optarg);
+				break;
+			case 'n':
+				overrides.push_back(string("simulation.cycles=") + optarg);
+				break;
+			case 'b':
+				config->jobFile = optarg;
+				break;
+			case 'j':
+				if(!parseInt(optarg, &config->jobThreads)){
+					cerr << "-j expects a number of threads" << endl;
+					return false;
+				}
+				break;
+			case 'h':
+				printConfigUsage(argv[0]);
+				exit(0);
+			default:
+				printConfigUsage(argv[0]);
+				return false;
+		}
+	}
+
+	if(configFile != NULL && !readConfigFile(config, configFile))
+		return false;
+	for(unsigned int i = 0; i < overrides.size(); i++){
+		if(!applyOverride(config, overrides[i]))
+			return false;
+	}
+
+	if(optind < argc - 1){
+		printConfigUsage(argv[0]);
+		return false;
+	}
+	if(optind == argc - 1)
+		config->elfFile = argv[optind];
+
+	return checkConfig(config);
+}
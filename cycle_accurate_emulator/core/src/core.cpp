@@ -5,23 +5,25 @@
 #if defined(__SIMULATOR__) || defined(__DEBUG__)
 	#include <debug.h>
 	#include <syscall.h>
-	#define print_simulator_output(...) PrintDebugStatements(__VA_ARGS__)
+	#define print_simulator_output(...) PrintDebugStatements(out, __VA_ARGS__)
 	#define EX_SYS_CALL() case RISCV_SYSTEM: \
-				extoMem->result = solveSysCall(dctoEx.dataa, dctoEx.datab, dctoEx.datac, dctoEx.datad, dctoEx.datae, &extoMem->sys_status); \
+				extoMem->result = CONFIG::Syscall::solve(&state->files, dctoEx.dataa, dctoEx.datab, dctoEx.datac, dctoEx.datad, dctoEx.datae, &extoMem->sys_status); \
 				break;
 	#define DC_SYS_CALL() case RISCV_SYSTEM: \
 			dctoEx->dest = 10; \
 			rs1 = 17; \
 			rs2 = 10; \
-			dctoEx->datac = (extoMem.dest == 11 && mem_lock < 2) ? extoMem.result : ((memtoWB.dest == 11 && mem_lock == 0) ? memtoWB.result : REG[11]);\
-			dctoEx->datad = (extoMem.dest == 12 && mem_lock < 2) ? extoMem.result : ((memtoWB.dest == 12 && mem_lock == 0) ? memtoWB.result : REG[12]);\
-			dctoEx->datae = (extoMem.dest == 13 && mem_lock < 2) ? extoMem.result : ((memtoWB.dest == 13 && mem_lock == 0) ? memtoWB.result : REG[13]);\
+			dctoEx->datac = (extoMem.dest == 11 && mem_lock < 2) ? extoMem.result : ((memtoWB.dest == 11 && mem_lock == 0) ? memtoWB.result : state->REG[11]);\
+			dctoEx->datad = (extoMem.dest == 12 && mem_lock < 2) ? extoMem.result : ((memtoWB.dest == 12 && mem_lock == 0) ? memtoWB.result : state->REG[12]);\
+			dctoEx->datae = (extoMem.dest == 13 && mem_lock < 2) ? extoMem.result : ((memtoWB.dest == 13 && mem_lock == 0) ? memtoWB.result : state->REG[13]);\
 			break;
 	#define WB_SYS_CALL() if(memtoWB->sys_status == 1){\
-			print_simulator_output("Exit system call received, Exiting... ");\
+			PrintDebugStatements(*state->out, "Exit system call received, Exiting...\n");\
+			mark_cycle(CYCLETRACE_EXIT);\
 			*early_exit = 1;}\
 			else if(memtoWB->sys_status == 2){\
-			print_simulator_output("Unknown system call received, Exiting... ");\
+			PrintDebugStatements(*state->out, "Unknown system call received, Exiting...\n");\
+			mark_cycle(CYCLETRACE_UNKNOWN);\
 			*early_exit = 1;}
 #else
 	#define print_simulator_output(...)
@@ -31,13 +33,16 @@
 #endif
 
 #ifdef __DEBUG__
-	#define print_debug(...) PrintDebugStatements(__VA_ARGS__)
-	#define nl() PrintNewLine()
+	#define print_debug(...) PrintDebugStatements(out, __VA_ARGS__)
+	#define nl() PrintNewLine(out)
 #else
 	#define print_debug(...)
 	#define nl()
 #endif
 
+//The messages of a cycle go to its record in the trace, see cycletrace.h, nothing is kept without one
+#define mark_cycle(marker) state->cycle_markers |= CONFIG::Trace::enabled ? marker : 0
+
 #ifdef __VIVADO
 	#include "DataMemory.h"
 	#define DO_MEM_PARAMETER DataMemory* data_memory
@@ -46,11 +51,7 @@
 #endif
 	
 
-CORE_INT(32) REG[32]; // Register file
-CORE_UINT(2) sys_status;
-
-
-CORE_INT(32) reg_controller(CORE_UINT(32) address, CORE_UINT(1) op, CORE_INT(32) val){
+CORE_INT(32) reg_controller(CORE_INT(32) REG[32], CORE_UINT(32) address, CORE_UINT(1) op, CORE_INT(32) val){
 	CORE_INT(32) return_val = 0;
 	switch(op){
 		case 0:
@@ -63,42 +64,27 @@ CORE_INT(32) reg_controller(CORE_UINT(32) address, CORE_UINT(1) op, CORE_INT(32)
 	return return_val;
 }
 
-void Ft(CORE_UINT(32) *pc, CORE_UINT(1) freeze_fetch, struct ExtoMem extoMem,
-	Cache* ICache, struct FtoDC *ftoDC, CORE_UINT(3) mem_lock, CORE_UINT(2) cache_miss, CORE_UINT(2) *icache_miss){
+template<class CONFIG>
+void Ft(struct CoreState* state, CORE_UINT(32) *pc, CORE_UINT(1) freeze_fetch, struct ExtoMem extoMem,
+	typename CONFIG::ICache* ICache, typename CONFIG::Predictor* predictor, struct FtoDC *ftoDC, CORE_UINT(3) mem_lock,
+	CORE_UINT(2) cache_miss, CORE_UINT(2) *icache_miss){
 
 	CORE_UINT(32) next_pc;
 	CORE_UINT(32) ins;
 	CORE_UINT(32) temp_pc;
 	CORE_UINT(32) jump_pc;
-	static CORE_UINT(7) icache_cycles;
-	CORE_UINT(1) control = 0;
+	CORE_UINT(16)& icache_cycles = state->icache_cycles;
+	//Ex resolved a control instruction differently from its prediction
+	CORE_UINT(1) control = extoMem.mispredict;
 	
 	if(icache_cycles == 0)
 		*icache_miss = 0;
-	
-	switch(extoMem.opCode){
-		case RISCV_BR:
-			control = extoMem.result > 0 ? 1 : 0;
-			break;
-		case RISCV_JAL:
-			control = 1;
-			break;
-		case RISCV_JALR:
-			control = 1;
-			break;
-		default:
-			control = 0;
-			break;
-	}
 
 	if(*icache_miss){
-		print_debug("[ICache miss] ");
+		mark_cycle(CYCLETRACE_ICACHE);
 		icache_cycles--;
 		control = 0;
 	}
-	else{
-		icache_cycles = 30;
-	}
 
 	if(freeze_fetch || cache_miss || *icache_miss){
 		next_pc =  *pc;
@@ -107,32 +93,46 @@ void Ft(CORE_UINT(32) *pc, CORE_UINT(1) freeze_fetch, struct ExtoMem extoMem,
 		next_pc = *pc + 4;
 	}
 
+	//The instructions being flushed do not redirect the fetch
 	if(mem_lock > 1){
-		jump_pc = next_pc;
+		control = 0;
 	}
-	else{
+	if(extoMem.taken){
 		jump_pc = extoMem.memValue;
 	}
+	else{
+		jump_pc = extoMem.pc + 4;
+	}
 
 	if(!freeze_fetch && !cache_miss && !*icache_miss){
-		ins = ICache->load(*pc,3,0,icache_miss);
-		if(!*icache_miss){
+		ins = ICache->load(*pc,3,0,icache_miss,*pc);
+		//A victim cache hit holds the fetch like a miss, for its shorter latency
+		if(!*icache_miss && ICache->getLatency() > 1){
+			*icache_miss = 1;
+			icache_cycles = ICache->getLatency() - 2;
+		}
+		else if(!*icache_miss){
 			(ftoDC->instruction).SET_SLC(0,ins);
 			ftoDC->pc=*pc;
+			next_pc = predictor->predict(*pc, ins, &ftoDC->prediction);
 		}
 		else{
-			print_debug("[ICache miss] ");
+			mark_cycle(CYCLETRACE_ICACHE);
+			icache_cycles = ICache->getLatency();
 		}
 	}
-	if(!*icache_miss)
+	if(!*icache_miss){
+		if(control)
+			predictor->recover(extoMem.prediction, extoMem.taken);
 		*pc = control ? jump_pc : next_pc;
+	}
 	
 }
 
-
-void DC(struct FtoDC ftoDC, struct ExtoMem extoMem, struct MemtoWB memtoWB, struct DCtoEx *dctoEx,
+void DC(struct CoreState* state, struct FtoDC ftoDC, struct ExtoMem extoMem, struct MemtoWB memtoWB, struct DCtoEx *dctoEx,
 CORE_UINT(7) *prev_opCode,CORE_UINT(32) *prev_pc, CORE_UINT(3) mem_lock, CORE_UINT(1) *freeze_fetch,
-CORE_UINT(1) *ex_bubble, CORE_UINT(2) cache_miss, CORE_UINT(2) icache_miss, CORE_UINT(32) n_inst, CORE_UINT(32)* counter_reg,CORE_UINT(1)* in_function_call){
+CORE_UINT(2) *ex_bubble, CORE_UINT(2) cache_miss, CORE_UINT(2) icache_miss, CORE_UINT(32) n_inst, CORE_UINT(32)* counter_reg,CORE_UINT(1)* in_function_call,
+CORE_UINT(32) reg_ready[32]){
 
 	if(!cache_miss && !icache_miss){
 	CORE_UINT(5) rs1 = ftoDC.instruction.SLC(5,15);       // Decoding the instruction, in the DC stage
@@ -151,7 +151,6 @@ CORE_UINT(1) *ex_bubble, CORE_UINT(2) cache_miss, CORE_UINT(2) icache_miss, CORE
 	imm13[11] = ftoDC.instruction[7];
 	CORE_INT(13) imm13_signed = 0;
 	imm13_signed.SET_SLC(0, imm13);
-	CORE_UINT(12) imm12_I = ftoDC.instruction.SLC(12,20);
 	CORE_INT(12) imm12_I_signed = ftoDC.instruction.SLC(12,20);
 	CORE_UINT(21) imm21_1 = 0;
 	imm21_1.SET_SLC(12, ftoDC.instruction.SLC(8,12));
@@ -171,8 +170,8 @@ CORE_UINT(1) *ex_bubble, CORE_UINT(2) cache_miss, CORE_UINT(2) icache_miss, CORE
 	store_imm.SET_SLC(0,ftoDC.instruction.SLC(5,7));
 	store_imm.SET_SLC(5,ftoDC.instruction.SLC(7,25));
 
-	CORE_INT(32) reg_rs1 = reg_controller(rs1,1,0);
-	CORE_INT(32) reg_rs2 = reg_controller(rs2,1,0);
+	CORE_INT(32) reg_rs1 = reg_controller(state->REG,rs1,1,0);
+	CORE_INT(32) reg_rs2 = reg_controller(state->REG,rs2,1,0);
 
 	dctoEx->opCode=opcode;
 	dctoEx->funct3=funct3;
@@ -182,6 +181,7 @@ CORE_UINT(1) *ex_bubble, CORE_UINT(2) cache_miss, CORE_UINT(2) icache_miss, CORE
 	dctoEx->rs1=rs1;
 	dctoEx->rs2=0;
 	dctoEx->pc=ftoDC.pc;
+	dctoEx->prediction = ftoDC.prediction;
 	*freeze_fetch = 0;
 	switch (opcode){
 		case RISCV_LUI:
@@ -218,7 +218,7 @@ CORE_UINT(1) *ex_bubble, CORE_UINT(2) cache_miss, CORE_UINT(2) icache_miss, CORE
 		case RISCV_OPI:
         	dctoEx->dest = rd;
         	dctoEx->memValue = imm12_I_signed;
-        	dctoEx->datab = imm12_I;
+        	dctoEx->datab = imm12_I_signed; //SLTIU compares it, sign-extended, as an unsigned value
 			break;
 		case RISCV_OP:
 			dctoEx->rs2=rs2;
@@ -249,6 +249,18 @@ CORE_UINT(1) *ex_bubble, CORE_UINT(2) cache_miss, CORE_UINT(2) icache_miss, CORE
 		*freeze_fetch = 1;
 		*ex_bubble = 1;
 	}
+
+	//Loads still waiting for their MSHR: stall on a true dependency, or on a write to the same register
+	CORE_UINT(1) read_rs1 = opcode != RISCV_LUI && opcode != RISCV_AUIPC && opcode != RISCV_JAL && opcode != RISCV_OP_CUST0;
+	CORE_UINT(1) read_rs2 = opcode == RISCV_BR || opcode == RISCV_ST || opcode == RISCV_OP || opcode == RISCV_SYSTEM;
+	CORE_UINT(5) write_rd = 0;
+	if(opcode != RISCV_OP_CUST0)
+		write_rd = dctoEx->dest;
+	if(((read_rs1 && reg_ready[rs1] > n_inst) || (read_rs2 && reg_ready[rs2] > n_inst) || reg_ready[write_rd] > n_inst)
+			&& mem_lock < 2){
+		*freeze_fetch = 1;
+		*ex_bubble = 2;
+	}
 	*prev_opCode = opcode;
 	*prev_pc = ftoDC.pc;
 	}
@@ -256,7 +268,8 @@ CORE_UINT(1) *ex_bubble, CORE_UINT(2) cache_miss, CORE_UINT(2) icache_miss, CORE
 
 
 
-void Ex(struct DCtoEx dctoEx, struct ExtoMem *extoMem, CORE_UINT(1) *ex_bubble, CORE_UINT(1) *mem_bubble,
+template<class CONFIG>
+void Ex(struct CoreState* state, struct DCtoEx dctoEx, struct ExtoMem *extoMem, CORE_UINT(2) *ex_bubble, CORE_UINT(2) *mem_bubble,
 	CORE_UINT(2) *sys_status, CORE_UINT(2) cache_miss, CORE_UINT(2) icache_miss, CORE_UINT(32)* branch_counter, CORE_UINT(32)* jump_counter,
 	CORE_UINT(1) in_function_call){
 
@@ -270,6 +283,7 @@ void Ex(struct DCtoEx dctoEx, struct ExtoMem *extoMem, CORE_UINT(1) *ex_bubble,
 		CORE_INT(66) longResult;
 		CORE_INT(33) srli_reg = 0;
 		CORE_INT(33) srli_result;                   // Execution of the Instruction in EX stage
+		extoMem->pc = dctoEx.pc;
 		extoMem->opCode= dctoEx.opCode;
 		extoMem->dest=dctoEx.dest;
 		extoMem->datac= dctoEx.datac;
@@ -345,7 +359,7 @@ void Ex(struct DCtoEx dctoEx, struct ExtoMem *extoMem, CORE_UINT(1) *ex_bubble,
 						extoMem->result = (dctoEx.dataa < dctoEx.memValue) ? 1 : 0;
 						break;
 					case RISCV_OPI_SLTIU:
-						extoMem->result = (unsignedReg1 < dctoEx.datab) ? 1 : 0;
+						extoMem->result = (unsignedReg1 < unsignedReg2) ? 1 : 0;
 						break;
 					case RISCV_OPI_XORI:
 						extoMem->result = dctoEx.dataa ^ dctoEx.memValue;
@@ -371,7 +385,40 @@ void Ex(struct DCtoEx dctoEx, struct ExtoMem *extoMem, CORE_UINT(1) *ex_bubble,
 				}
 				break;
 			case RISCV_OP:
-				if (dctoEx.funct7 == 1){
+				if (dctoEx.funct7 == 1 && dctoEx.funct3 >= RISCV_OP_M_DIV){
+					//Division (RV32M) does not trap: by zero and on overflow, the results are the ones of the specification
+					switch (dctoEx.funct3){
+						case RISCV_OP_M_DIV:
+							if(dctoEx.datab == 0)
+								extoMem->result = -1;
+							else if(dctoEx.datab == -1)
+								extoMem->result = -dctoEx.dataa;
+							else
+								extoMem->result = dctoEx.dataa / dctoEx.datab;
+							break;
+						case RISCV_OP_M_DIVU:
+							if(unsignedReg2 == 0)
+								extoMem->result = -1;
+							else
+								extoMem->result = unsignedReg1 / unsignedReg2;
+							break;
+						case RISCV_OP_M_REM:
+							if(dctoEx.datab == 0)
+								extoMem->result = dctoEx.dataa;
+							else if(dctoEx.datab == -1)
+								extoMem->result = 0;
+							else
+								extoMem->result = dctoEx.dataa % dctoEx.datab;
+							break;
+						case RISCV_OP_M_REMU:
+							if(unsignedReg2 == 0)
+								extoMem->result = dctoEx.dataa;
+							else
+								extoMem->result = unsignedReg1 % unsignedReg2;
+							break;
+					}
+				}
+				else if (dctoEx.funct7 == 1){
 					mul_reg_a = dctoEx.dataa;
 					mul_reg_b = dctoEx.datab;
 					mul_reg_a[32] = dctoEx.dataa[31];
@@ -402,7 +449,16 @@ void Ex(struct DCtoEx dctoEx, struct ExtoMem *extoMem, CORE_UINT(1) *ex_bubble,
 				        		extoMem->result = dctoEx.dataa - dctoEx.datab;
 							break;
 						case RISCV_OP_SLL:
-							extoMem->result = dctoEx.dataa << (dctoEx.datab & 0x3f);
+							extoMem->result = dctoEx.dataa << (dctoEx.datab & 0x1f);
+							break;
+						case RISCV_OP_SR:
+							if (dctoEx.funct7 == RISCV_OP_SR_SRL){
+								srli_reg.SET_SLC(0,dctoEx.dataa);
+								srli_result = srli_reg >> (dctoEx.datab & 0x1f);
+								extoMem->result = srli_result.SLC(32,0);
+							}
+							else //SRA
+								extoMem->result = dctoEx.dataa >> (dctoEx.datab & 0x1f);
 							break;
 						case RISCV_OP_SLT:
 							extoMem->result = (dctoEx.dataa < dctoEx.datab) ? 1 : 0;
@@ -426,9 +482,20 @@ void Ex(struct DCtoEx dctoEx, struct ExtoMem *extoMem, CORE_UINT(1) *ex_bubble,
 				break;
 			EX_SYS_CALL()
 		}
+
+		//Control instructions are resolved here, Ft redirects the fetch when they were mispredicted
+		extoMem->prediction = dctoEx.prediction;
+		extoMem->taken = dctoEx.opCode == RISCV_JAL || dctoEx.opCode == RISCV_JALR
+				|| (dctoEx.opCode == RISCV_BR && extoMem->result != 0);
+		extoMem->mispredict = 0;
+		if(dctoEx.opCode == RISCV_BR || dctoEx.opCode == RISCV_JAL || dctoEx.opCode == RISCV_JALR){
+			CORE_UINT(32) target = extoMem->memValue;
+			extoMem->mispredict = extoMem->taken != dctoEx.prediction.taken
+					|| (extoMem->taken && target != dctoEx.prediction.target);
+		}
 		
 		if(*ex_bubble){
-			*mem_bubble = 1;
+			*mem_bubble = *ex_bubble;
 			extoMem->pc = 0;
 			extoMem->result = 0; //Result of the EX stage
 			extoMem->datad = 0;
@@ -439,27 +506,35 @@ void Ex(struct DCtoEx dctoEx, struct ExtoMem *extoMem, CORE_UINT(1) *ex_bubble,
 			extoMem->memValue = 0;
 			extoMem->rs2 = 0;
 			extoMem->funct3 = 0;
+			extoMem->taken = 0;
+			extoMem->mispredict = 0;
 		}
 		*ex_bubble = 0;
 	}
 }
 
-void do_Mem(Cache* DCache, struct ExtoMem extoMem,struct MemtoWB *memtoWB, CORE_UINT(3) *mem_lock,
-CORE_UINT(1) *mem_bubble, CORE_UINT(1) *wb_bubble, CORE_UINT(2)* cache_miss, CORE_UINT(2) icache_miss){
-	static CORE_UINT(7) cycles;
+template<class CONFIG>
+void do_Mem(struct CoreState* state, typename CONFIG::DCache* DCache, typename CONFIG::Predictor* predictor, struct ExtoMem extoMem,struct MemtoWB *memtoWB, CORE_UINT(3) *mem_lock,
+CORE_UINT(2) *mem_bubble, CORE_UINT(1) *wb_bubble, CORE_UINT(2)* cache_miss, CORE_UINT(2) icache_miss,
+CORE_UINT(32) n_inst, CORE_UINT(32) reg_ready[32]){
+	CORE_UINT(16)& cycles = state->dcache_cycles;
 	if(!icache_miss){
 	if(*cache_miss == 0){
-	 cycles = 29;
 	if(*mem_bubble){
 		*mem_bubble = 0;
+		//A bubble takes the slot of a flushed instruction, or the first one of the correct path would be dropped
+		if(*mem_lock > 0)
+			*mem_lock = *mem_lock - 1;
 		//*wb_bubble = 1;
 		memtoWB->result = 0; //Result to be written back
 		memtoWB->dest = 0; //Register to be written at WB stage
 		memtoWB->WBena = 0; //Is a WB is needed ?
     	memtoWB->opCode = 0;
     	memtoWB->sys_status = 0;
+    	memtoWB->retire = 0;
 	}
 	else{
+		memtoWB->retire = 0;
 		if(*mem_lock > 0){
 			*mem_lock = *mem_lock - 1;
 			memtoWB->WBena = 0;
@@ -476,19 +551,27 @@ CORE_UINT(1) *mem_bubble, CORE_UINT(1) *wb_bubble, CORE_UINT(2)* cache_miss, COR
 		if(*mem_lock == 0){
 			memtoWB->WBena = extoMem.WBena;
 			memtoWB->dest = extoMem.dest; // Memory operaton in do_Mem stage
+			if(CONFIG::Checker::enabled){
+				memtoWB->retire = extoMem.opCode != 0;
+				memtoWB->pc = extoMem.pc;
+				memtoWB->datac = extoMem.datac;
+				memtoWB->funct3 = extoMem.funct3;
+			}
 			switch(extoMem.opCode){
  				case RISCV_BR:
-					if (extoMem.result){
+					if (extoMem.mispredict){
 						*mem_lock = 3;
 					}
+					predictor->update(extoMem.pc, extoMem.prediction, extoMem.taken, extoMem.memValue, extoMem.mispredict);
 					memtoWB->WBena = 0;
 					memtoWB->dest = 0;
 					break;
 				case RISCV_JAL:
-					*mem_lock = 3;
-					break;
 				case RISCV_JALR:
-					*mem_lock = 3;
+					if (extoMem.mispredict){
+						*mem_lock = 3;
+					}
+					predictor->update(extoMem.pc, extoMem.prediction, extoMem.taken, extoMem.memValue, extoMem.mispredict);
 					break;
 				case RISCV_LD:
 					switch(extoMem.funct3){
@@ -513,9 +596,7 @@ CORE_UINT(1) *mem_bubble, CORE_UINT(1) *wb_bubble, CORE_UINT(2)* cache_miss, COR
 							sign = 0;
 							break;
 		           		 }
-						memtoWB->result = DCache->load(memtoWB->result,ld_op,sign,cache_miss);
-						if(*cache_miss == 2)
-							cycles = 57;
+						memtoWB->result = DCache->load(memtoWB->result,ld_op,sign,cache_miss,extoMem.pc);
 		           		break;
 				case RISCV_ST:
 			   		switch(extoMem.funct3){
@@ -529,9 +610,7 @@ CORE_UINT(1) *mem_bubble, CORE_UINT(1) *wb_bubble, CORE_UINT(2)* cache_miss, COR
                         	st_op = 0;
                         	break;
                     }
-					DCache->store(memtoWB->result,extoMem.datac,st_op,cache_miss);
-					if(*cache_miss == 2)
-						cycles = 57;
+					DCache->store(memtoWB->result,extoMem.datac,st_op,cache_miss,extoMem.pc);
 					//MEM_SET(data_memory,memtoWB->result,extoMem.datac,st_op);
 					//data_memory[(memtoWB->result/4)%8192] = extoMem.datac;
 			   	break;
@@ -539,34 +618,142 @@ CORE_UINT(1) *mem_bubble, CORE_UINT(1) *wb_bubble, CORE_UINT(2)* cache_miss, COR
 					memtoWB->WBena = 0;	
 				break;
 			}
+
+			//The pipeline is frozen until the data is there, the current cycle included
+			if(extoMem.opCode == RISCV_LD || extoMem.opCode == RISCV_ST){
+				int latency = DCache->getLatency();
+				cycles = latency > 0 ? latency - 1 : 0;
+				if(!DCache->getMshrs()){
+					if(cycles == 0)
+						*cache_miss = 0;
+					else if(*cache_miss == 0)
+						*cache_miss = 1;
+				}
+				//With MSHRs, only a miss finding them all busy stalls the pipeline, until one is freed
+				else{
+					CORE_UINT(32) ready = n_inst + cycles;
+					if(*cache_miss){
+						CORE_UINT(32) issue = DCache->allocateMshr(extoMem.result, n_inst, cycles.to_int());
+						ready = issue + cycles;
+						cycles = issue - n_inst;
+						if(cycles == 0)
+							*cache_miss = 0;
+					}
+					else{
+						CORE_UINT(32) pending = DCache->getPendingReady(extoMem.result);
+						if(pending > ready)
+							ready = pending;
+					}
+					if(extoMem.opCode == RISCV_LD && extoMem.dest != 0 && ready > n_inst)
+						reg_ready[extoMem.dest] = ready;
+					//A store hit writing through, or finding the write buffer full, holds the pipeline
+					else if(!*cache_miss && DCache->getWriteStall() > 1){
+						cycles = DCache->getWriteStall() - 1;
+						*cache_miss = 1;
+					}
+				}
+			}
 		}
 	}
 	}
 	else{
 		cycles--;
 		memtoWB->WBena = 0;
+		memtoWB->retire = 0;
 		if(cycles == 0){
 			*cache_miss = 0;
 			memtoWB->WBena = extoMem.WBena;
 		}
 		else{
-			print_debug("[DCache miss] ");
+			mark_cycle(CYCLETRACE_DCACHE);
 		}
 	}
 	}
 }
 
-void doWB(struct MemtoWB *memtoWB, CORE_UINT(1) *wb_bubble, CORE_UINT(1) *early_exit, CORE_UINT(2) icache_miss){
+template<class CONFIG>
+void doWB(struct CoreState* state, typename CONFIG::Checker* checker, struct MemtoWB *memtoWB, CORE_UINT(1) *wb_bubble,
+	CORE_UINT(1) *early_exit, CORE_UINT(2) icache_miss, CORE_UINT(32) n_inst){
 		if (memtoWB->WBena == 1 && memtoWB->dest != 0 && !icache_miss){
-			reg_controller(memtoWB->dest, 0, memtoWB->result);
+			reg_controller(state->REG, memtoWB->dest, 0, memtoWB->result);
 		}
+		//do_Mem does not run during an icache miss, the instruction retires once it is over
+		if(CONFIG::Checker::enabled && memtoWB->retire && !icache_miss && !checker->retire(n_inst, *memtoWB, *state->out))
+			*early_exit = 1;
 		WB_SYS_CALL()
 }
 
-void doStep(CORE_UINT(32) pc, CORE_UINT(32) nbcycle, Cache* ICache,
-	Cache* DCache, CORE_INT(32) dm_out[8192]){//, CORE_INT(32) debug_arr[200]){
+template<class CACHE>
+static void printMissClassification(std::ostream& out, CACHE* cache){
+	MissClassifier* classifier = cache->getMissClassifier();
+	if(classifier == NULL)
+		return;
+	print_debug("Compulsory misses: ", classifier->getNumberCompulsory());
+	nl();
+	print_debug("Capacity misses: ", classifier->getNumberCapacity());
+	nl();
+	print_debug("Conflict misses: ", classifier->getNumberConflict());
+	nl();
+}
+
+//The hit rate is over the misses of the cache, which all look up its victim cache
+template<class CACHE>
+static void printVictimStatistics(std::ostream& out, CACHE* cache){
+	if(!cache->getVictimLines())
+		return;
+	print_debug("Victim cache hits: ", cache->getNumberVictimHits());
+	nl();
+	if(cache->getNumberVictimProbes() != 0){
+		print_debug("Victim cache hit rate: ", cache->getNumberVictimHits().to_double() / cache->getNumberVictimProbes().to_double());
+		nl();
+	}
+}
+
+//Over the control instructions on the correct path, whether or not they are in a measured function
+template<class PREDICTOR>
+static void printPredictorStatistics(std::ostream& out, PREDICTOR* predictor){
+	static const char* kinds[PREDICTOR_KINDS] = {"", "conditional branches", "direct jumps", "returns", "indirect jumps"};
+	if(!predictor->isEnabled())
+		return;
+	nl();
+	print_simulator_output("branch predictor: ", predictor->getName());
+	for(int kind = CONDITIONAL_BRANCH; kind < PREDICTOR_KINDS; kind++){
+		CORE_UINT(32) branches = predictor->getNumberBranches(kind);
+		if(branches == 0)
+			continue;
+		nl();
+		print_simulator_output(kinds[kind], ": ", branches, ", mispredicted: ", predictor->getNumberMispredicted(kind),
+				", accuracy: ", 1 - predictor->getNumberMispredicted(kind).to_double() / branches.to_double());
+	}
+}
+
+//Gives the cycle to one cause, from the state of do_Mem when it started
+template<class STATS>
+static void accountCycle(STATS* cpi, CORE_UINT(2) icache_miss, CORE_UINT(2) mem_stall, CORE_UINT(2) mem_bubble,
+	CORE_UINT(3) mem_lock, const struct ExtoMem& extoMem, const struct DCtoEx& dctoEx, CORE_UINT(32) fetch_pc){
+	if(icache_miss)
+		cpi->record(CPI_ICACHE, fetch_pc);
+	else if(mem_stall)
+		cpi->record(mem_stall == 2 ? CPI_DCACHE_DIRTY : CPI_DCACHE_CLEAN, extoMem.pc);
+	else if(mem_bubble)
+		cpi->record(mem_bubble == 2 ? CPI_PENDING_MISS : CPI_LOAD_USE, dctoEx.pc);
+	else if(mem_lock > 1)
+		cpi->recordLast(CPI_FLUSH);
+	else if(extoMem.opCode == 0)
+		cpi->recordLast(CPI_STRUCTURAL);
+	else if(extoMem.opCode == RISCV_SYSTEM)
+		cpi->record(CPI_SYSCALL, extoMem.pc);
+	else
+		cpi->record(CPI_BASE, extoMem.pc);
+}
+
+template<class CONFIG>
+void doStep(struct CoreState* state, CORE_UINT(32) pc, CORE_UINT(32) nbcycle, typename CONFIG::ICache* ICache,
+	typename CONFIG::DCache* DCache, typename CONFIG::Predictor* predictor, typename CONFIG::Stats* cpi,
+	typename CONFIG::Trace* trace, typename CONFIG::Checker* checker, CORE_INT(32) dm_out[8192]){//, CORE_INT(32) debug_arr[200]){
 
 	int i;
+	std::ostream& out = *state->out;
 	
 	#ifdef __VIVADO__
 	DataMemory data_memory;
@@ -579,10 +766,11 @@ void doStep(CORE_UINT(32) pc, CORE_UINT(32) nbcycle, Cache* ICache,
     }
 	#endif
 
-	struct MemtoWB memtoWB;
-	struct ExtoMem extoMem;
-	struct DCtoEx dctoEx;
-	struct FtoDC ftoDC;
+	//Zeroed, the fields not set below would otherwise hold whatever was on the stack
+	struct MemtoWB memtoWB = MemtoWB();
+	struct ExtoMem extoMem = ExtoMem();
+	struct DCtoEx dctoEx = DCtoEx();
+	struct FtoDC ftoDC = FtoDC();
 
 	CORE_UINT(32) n_inst=0;
 	CORE_UINT(32) counter_reg=0;
@@ -602,6 +790,8 @@ void doStep(CORE_UINT(32) pc, CORE_UINT(32) nbcycle, Cache* ICache,
 	memtoWB.opCode=0;
 	extoMem.opCode=0;
 	extoMem.sys_status = 0;
+	extoMem.taken = 0;
+	extoMem.mispredict = 0;
 	CORE_UINT(3) mem_lock=0;
 	dctoEx.opCode=0;
 	CORE_UINT(1) early_exit = 0;
@@ -611,49 +801,53 @@ void doStep(CORE_UINT(32) pc, CORE_UINT(32) nbcycle, Cache* ICache,
 	dctoEx.datac = 0;
 	dctoEx.datad = 0; //Third data used only for store instruction and corresponding to rb
 	dctoEx.dest = 0; //Register to be written
+	dctoEx.prediction.taken = 0;
+	ftoDC.prediction.taken = 0;
 
 	CORE_UINT(1) freeze_fetch = 0;
-	CORE_UINT(1) ex_bubble = 0;
-	CORE_UINT(1) mem_bubble = 0;
+	CORE_UINT(2) ex_bubble = 0; //1 for the load-use interlock, 2 for a load still in an MSHR
+	CORE_UINT(2) mem_bubble = 0;
 	CORE_UINT(1) wb_bubble = 0;
 	CORE_UINT(2) cache_miss = 0;
 	CORE_UINT(1) dummy_signal = 0;
 	CORE_UINT(2) icache_miss = 0;
+	CORE_UINT(32) reg_ready[32]; //Cycle at which the loads in flight write each register
 
 	for(i = 0;i<32;i++){
 		#pragma HLS PIPELINE
-		REG[i] = 0;
+		state->REG[i] = 0;
+		reg_ready[i] = 0;
 	}
 
-	REG[2] = 0xf00000;
-	sys_status = 0;
+	state->REG[2] = 0xf00000;
+	state->sys_status = 0;
+	state->icache_cycles = 0;
+	state->dcache_cycles = 0;
 
 	doStep_label1:while(n_inst < nbcycle){
 		#pragma HLS PIPELINE II=1
-			
-		#ifdef __DEBUG__
-  			print_debug(n_inst, ";");
-		#endif	
+		if(CONFIG::Trace::enabled)
+			state->cycle_markers = 0;
 
-   	    doWB(&memtoWB, &wb_bubble, &early_exit,icache_miss);
+   	    doWB<CONFIG>(state, checker, &memtoWB, &wb_bubble, &early_exit,icache_miss, n_inst);
+		ICache->tick(n_inst);
+		DCache->tick(n_inst);
 		#ifdef __VIVADO__
 			do_Mem(&data_memory, extoMem, &memtoWB, &mem_lock, &mem_bubble, &wb_bubble,icache_miss);
 		#else
-   			do_Mem(DCache, extoMem, &memtoWB, &mem_lock, &mem_bubble, &wb_bubble,&cache_miss,icache_miss);
-		#endif
- 		Ex(dctoEx, &extoMem, &ex_bubble, &mem_bubble, &sys_status,cache_miss,icache_miss,&branch_counter,&jump_counter,in_function_call);
-		DC(ftoDC, extoMem, memtoWB, &dctoEx, &prev_opCode, &prev_pc, mem_lock, &freeze_fetch, &ex_bubble,cache_miss,icache_miss,n_inst,&counter_reg,&in_function_call);
-		Ft(&pc,freeze_fetch, extoMem, ICache, &ftoDC, mem_lock,cache_miss, &icache_miss);	
-		#ifdef __DEBUG__
-  			print_debug(std::hex, (int)ftoDC.pc, ";",	(int)ftoDC.instruction," ");
+			CORE_UINT(2) mem_stall = cache_miss;
+			CORE_UINT(2) mem_bubble_cause = mem_bubble;
+			CORE_UINT(3) mem_flush = mem_lock;
+   			do_Mem<CONFIG>(state, DCache, predictor, extoMem, &memtoWB, &mem_lock, &mem_bubble, &wb_bubble,&cache_miss,icache_miss,n_inst,reg_ready);
+			if(CONFIG::Stats::enabled)
+				accountCycle(cpi, icache_miss, mem_stall, mem_bubble_cause, mem_flush, extoMem, dctoEx, pc);
 		#endif
+ 		Ex<CONFIG>(state, dctoEx, &extoMem, &ex_bubble, &mem_bubble, &state->sys_status,cache_miss,icache_miss,&branch_counter,&jump_counter,in_function_call);
+		DC(state, ftoDC, extoMem, memtoWB, &dctoEx, &prev_opCode, &prev_pc, mem_lock, &freeze_fetch, &ex_bubble,cache_miss,icache_miss,n_inst,&counter_reg,&in_function_call,reg_ready);
+		Ft<CONFIG>(state, &pc,freeze_fetch, extoMem, ICache, predictor, &ftoDC, mem_lock,cache_miss, &icache_miss);	
+		if(CONFIG::Trace::enabled)
+			trace->record(n_inst, state->cycle_markers, ftoDC.pc, ftoDC.instruction, state->REG);
 		n_inst++;
-		#ifdef __DEBUG__
-		for(i=0;i<32;i++){
-			print_debug(";",std::hex,(int)REG[i]);
-		}
-		nl();
-		#endif
 
 		if(early_exit == 1)
 			break;
@@ -676,6 +870,7 @@ void doStep(CORE_UINT(32) pc, CORE_UINT(32) nbcycle, Cache* ICache,
 	nl();
 	print_debug("cache miss: ", DCache->getNumberCacheMiss());
 	nl();
+	printMissClassification(out, DCache);
 
 	print_debug("Number of loads: ", DCache->getNumberLoads());
 	nl();
@@ -688,12 +883,52 @@ void doStep(CORE_UINT(32) pc, CORE_UINT(32) nbcycle, Cache* ICache,
 
 	print_debug("Number of DRAM writes: ", DCache->getNumberDramWrites());
 	nl();
+
+	if(DCache->hasPrefetcher()){
+		print_debug("Prefetches issued: ", DCache->getNumberPrefetchIssued());
+		nl();
+		print_debug("Useful prefetches: ", DCache->getNumberPrefetchUseful());
+		nl();
+		print_debug("Late prefetches: ", DCache->getNumberPrefetchLate());
+		nl();
+		print_debug("Polluting prefetches: ", DCache->getNumberPrefetchPolluting());
+		nl();
+		print_debug("Prefetched lines evicted unused: ", DCache->getNumberPrefetchUnused());
+		nl();
+	}
+
+	if(DCache->getNumberWriteThrough() != 0){
+		print_debug("Stores sent to the next level: ", DCache->getNumberWriteThrough());
+		nl();
+	}
+	if(DCache->getWriteBufferSize()){
+		print_debug("Writes merged in the write buffer: ", DCache->getNumberWriteBufferMerges());
+		nl();
+		print_debug("Writes stalled on a full write buffer: ", DCache->getNumberWriteBufferFull());
+		nl();
+	}
+	printVictimStatistics(out, DCache);
+
+	if(DCache->getMshrs()){
+		print_debug("Accesses merged into a pending MSHR: ", DCache->getNumberMshrMerges());
+		nl();
+		print_debug("Misses waiting for a free MSHR: ", DCache->getNumberMshrFull());
+		nl();
+		print_debug("Cycles with outstanding misses: ", DCache->getNumberMissCycles());
+		nl();
+		if(DCache->getNumberMissCycles() != 0){
+			print_debug("Average outstanding misses: ", DCache->getNumberOutstanding().to_double() / DCache->getNumberMissCycles().to_double());
+			nl();
+		}
+	}
 	nl();
 
 	print_debug("Printing ICache statistics :");
 	nl();
 	print_debug("cache miss: ",ICache->getNumberCacheMiss());
 	nl();
+	printMissClassification(out, ICache);
+	printVictimStatistics(out, ICache);
 	print_simulator_output("Successfully executed all instructions in ",n_inst," cycles");
 	nl();
 	print_simulator_output("cycle counter value: ",counter_reg);
@@ -701,4 +936,14 @@ void doStep(CORE_UINT(32) pc, CORE_UINT(32) nbcycle, Cache* ICache,
 	print_simulator_output("number of branches taken: ",branch_counter);
 	nl();
 	print_simulator_output("number of jumps taken: ",jump_counter);
+	printPredictorStatistics(out, predictor);
 }
+
+#define DOSTEP_INSTANCE(CONFIG) template void doStep<CONFIG>(struct CoreState* state, CORE_UINT(32) pc, CORE_UINT(32) nbcycle, \
+	CONFIG::ICache* ICache, CONFIG::DCache* DCache, CONFIG::Predictor* predictor, CONFIG::Stats* cpi, \
+	CONFIG::Trace* trace, CONFIG::Checker* checker, CORE_INT(32) dm_out[8192]);
+DOSTEP_INSTANCE(FastPipeline)
+DOSTEP_INSTANCE(ProfilePipeline)
+DOSTEP_INSTANCE(TracePipeline)
+DOSTEP_INSTANCE(FullPipeline)
+DOSTEP_INSTANCE(LockstepPipeline)
@@ -0,0 +1,94 @@
+// vim: set ts=4 nu ai:
+#include <cpistack.h>
+#include <algorithm>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const char* causeNames[CPI_CAUSES] = {"base", "icache miss", "dcache miss, clean", "dcache miss, dirty",
+	"load-use", "pending load miss", "branch/jump flush", "syscall", "structural"};
+static const char* causeColumns[CPI_CAUSES] = {"base", "icache", "dclean", "ddirty", "loaduse", "pending", "flush",
+	"syscall", "struct"};
+
+struct function_count{
+	string name;
+	cpi_count count;
+	unsigned long long cycles;
+	unsigned long long instructions;
+
+	function_count() : cycles(0), instructions(0){}
+};
+
+//Most cycles first, then by name so that the report is stable
+static bool moreCycles(const function_count& a, const function_count& b){
+	if(a.cycles != b.cycles)
+		return a.cycles > b.cycles;
+	return a.name < b.name;
+}
+
+static double perInstruction(unsigned long long cycles, unsigned long long instructions){
+	return instructions == 0 ? 0.0 : (double) cycles / instructions;
+}
+
+void CpiStack::record(CpiCause cause, CORE_UINT(32) pc){
+	byPc[pc.to_uint()].cycles[cause]++;
+	if(cause == CPI_BASE || cause == CPI_SYSCALL)
+		lastPc = pc.to_uint();
+}
+
+void CpiStack::recordLast(CpiCause cause){
+	byPc[lastPc].cycles[cause]++;
+}
+
+void CpiStack::writeReport(ostream& out, const SymbolTable& symbols){
+	unordered_map<string, function_count> functions;
+	function_count total;
+	for(unordered_map<unsigned int, cpi_count>::iterator it = byPc.begin(); it != byPc.end(); it++){
+		const char* name = symbols.getFunction(it->first);
+		function_count& function = functions[name ? name : "?"];
+		function.name = name ? name : "?";
+		for(int i=0;i<CPI_CAUSES;i++){
+			function.count.cycles[i] += it->second.cycles[i];
+			function.cycles += it->second.cycles[i];
+			total.count.cycles[i] += it->second.cycles[i];
+			total.cycles += it->second.cycles[i];
+		}
+		function.instructions += it->second.cycles[CPI_BASE] + it->second.cycles[CPI_SYSCALL];
+	}
+	total.instructions = total.count.cycles[CPI_BASE] + total.count.cycles[CPI_SYSCALL];
+
+	out << "cycles: " << total.cycles << endl;
+	out << "instructions retired: " << total.instructions << endl;
+	out << "CPI: " << fixed << setprecision(3) << perInstruction(total.cycles, total.instructions) << endl << endl;
+
+	out << "CPI stack" << endl;
+	out << left << setw(20) << "cause" << right << setw(14) << "cycles" << setw(8) << "%" << setw(8) << "CPI" << endl;
+	for(int i=0;i<CPI_CAUSES;i++){
+		out << left << setw(20) << causeNames[i] << right << setw(14) << total.count.cycles[i] << setw(8)
+			<< setprecision(2) << (total.cycles ? 100.0 * total.count.cycles[i] / total.cycles : 0.0) << setw(8)
+			<< setprecision(3) << perInstruction(total.count.cycles[i], total.instructions) << endl;
+	}
+	out << endl;
+
+	vector<function_count> sorted;
+	for(unordered_map<string, function_count>::iterator it = functions.begin(); it != functions.end(); it++)
+		sorted.push_back(it->second);
+	sort(sorted.begin(), sorted.end(), moreCycles);
+
+	out << "CPI stack by function (" << sorted.size() << " in total), each cause in cycles per instruction" << endl;
+	out << setw(12) << "cycles" << setw(8) << "%" << setw(12) << "instr" << setw(8) << "CPI";
+	for(int i=0;i<CPI_CAUSES;i++)
+		out << setw(8) << causeColumns[i];
+	out << "  function" << endl;
+	for(unsigned int f=0;f<sorted.size();f++){
+		const function_count& function = sorted[f];
+		out << setw(12) << function.cycles << setw(8) << setprecision(2)
+			<< (total.cycles ? 100.0 * function.cycles / total.cycles : 0.0) << setw(12) << function.instructions
+			<< setw(8) << setprecision(3) << perInstruction(function.cycles, function.instructions);
+		for(int i=0;i<CPI_CAUSES;i++)
+			out << setw(8) << perInstruction(function.count.cycles[i], function.instructions);
+		out << "  " << function.name << endl;
+	}
+}
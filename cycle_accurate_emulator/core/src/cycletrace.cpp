@@ -0,0 +1,82 @@
+// vim: set ts=4 nu ai:
+#include <cycletrace.h>
+#include <chrono>
+
+using namespace std;
+
+CycleTrace::CycleTrace() : file(NULL), interval(1), ring(NULL), head(0), tail(0), done(false){
+	lastCycle = 0;
+	lastPc = 0;
+	lastInstruction = 0;
+	for(int i=0;i<32;i++)
+		lastRegisters[i] = 0;
+}
+
+CycleTrace::~CycleTrace(){
+	close();
+}
+
+bool CycleTrace::open(const char* fileName, unsigned int interval){
+	close();
+	file = fopen(fileName, "wb");
+	if(file == NULL)
+		return false;
+	this->interval = interval;
+	unsigned char header[4];
+	putWord(header, interval);
+	fwrite(CYCLETRACE_MAGIC, 1, 8, file);
+	fwrite(header, 1, 4, file);
+
+	ring = new char[CYCLETRACE_RINGBYTES];
+	head = 0;
+	tail = 0;
+	done = false;
+	writer = thread(&CycleTrace::drain, this);
+	return true;
+}
+
+void CycleTrace::close(){
+	if(file == NULL)
+		return;
+	done.store(true, memory_order_release);
+	writer.join();
+	fclose(file);
+	file = NULL;
+	delete[] ring;
+	ring = NULL;
+}
+
+void CycleTrace::push(const unsigned char* data, unsigned int size){
+	unsigned long long position = head.load(memory_order_relaxed);
+	//Waits for the writer when the ring is full
+	while(position + size - tail.load(memory_order_acquire) > CYCLETRACE_RINGBYTES)
+		this_thread::yield();
+
+	unsigned int offset = position % CYCLETRACE_RINGBYTES;
+	unsigned int first = size < CYCLETRACE_RINGBYTES - offset ? size : CYCLETRACE_RINGBYTES - offset;
+	memcpy(ring + offset, data, first);
+	memcpy(ring, data + first, size - first);
+	head.store(position + size, memory_order_release);
+}
+
+//Body of the writer thread, it returns once the ring is empty after close()
+void CycleTrace::drain(){
+	while(true){
+		bool last = done.load(memory_order_acquire);
+		unsigned long long position = tail.load(memory_order_relaxed);
+		unsigned long long end = head.load(memory_order_acquire);
+		if(position == end){
+			if(last)
+				return;
+			this_thread::sleep_for(chrono::microseconds(100));
+			continue;
+		}
+
+		unsigned int offset = position % CYCLETRACE_RINGBYTES;
+		unsigned long long size = end - position;
+		if(size > CYCLETRACE_RINGBYTES - offset)
+			size = CYCLETRACE_RINGBYTES - offset;
+		fwrite(ring + offset, 1, size, file);
+		tail.store(position + size, memory_order_release);
+	}
+}
@@ -1,13 +1,308 @@
 // vim: set ts=4 nu ai:
 #include <dram.h>
 #include <stdlib.h>
+#include <string.h>
 #include <iostream>
 
+Dram::Dram(DramConfig config){
+	this->config = config;
+	for(int i = 0; i < DRAM_TABLEENTRIES; i++){
+		directory[i] = NULL;
+	}
+
+	columnBits = 0;
+	while((1 << columnBits) < config.rowBytes)
+		columnBits++;
+	bankBits = 0;
+	while((1 << bankBits) < config.banks)
+		bankBits++;
+	for(int i = 0; i < DRAM_MAXBANKS; i++){
+		bank[i].ready = 0;
+		bank[i].row = 0;
+		bank[i].open = false;
+	}
+	queueCount = 0;
+	busFree = 0;
+	nextRefresh = config.refreshInterval;
+
+	n_reads = 0;
+	n_writes = 0;
+	n_row_hits = 0;
+	n_row_empty = 0;
+	n_row_conflicts = 0;
+	n_refreshes = 0;
+	n_queue_full = 0;
+	readCycles = 0;
+}
+
+Dram::~Dram(){
+	for(int i = 0; i < DRAM_TABLEENTRIES; i++){
+		if(directory[i] != NULL){
+			for(int j = 0; j < DRAM_TABLEENTRIES; j++){
+				free(directory[i][j]);
+			}
+			free(directory[i]);
+		}
+	}
+}
+
+unsigned char* Dram::getPage(unsigned int address, bool allocate){
+	unsigned int first = address >> (DRAM_PAGEBITS + DRAM_TABLEBITS);
+	unsigned int second = (address >> DRAM_PAGEBITS) & (DRAM_TABLEENTRIES - 1);
+
+	if(directory[first] == NULL){
+		if(!allocate)
+			return NULL;
+		directory[first] = (unsigned char**) calloc(DRAM_TABLEENTRIES, sizeof(unsigned char*));
+	}
+	if(directory[first][second] == NULL && allocate){
+		directory[first][second] = (unsigned char*) calloc(DRAM_PAGEBYTES, sizeof(unsigned char));
+	}
+	return directory[first][second];
+}
+
 void Dram::setMemory(CORE_UINT(32) address, CORE_UINT(8) value){
-	memory[address] = value;		
+	unsigned int addr = address.to_uint();
+	getPage(addr, true)[addr & (DRAM_PAGEBYTES - 1)] = value.to_uint();
 }
 
 CORE_UINT(8) Dram::getMemory(CORE_UINT(32) address){
-	return memory[address];
+	unsigned int addr = address.to_uint();
+	unsigned char* page = getPage(addr, false);
+	if(page == NULL)
+		return 0;
+	return page[addr & (DRAM_PAGEBYTES - 1)];
+}
+
+//Precharges all the banks for each refresh due before cycle
+void Dram::refresh(long long cycle){
+	if(config.refreshInterval == 0)
+		return;
+	while(nextRefresh <= cycle){
+		for(int i = 0; i < config.banks; i++){
+			bank[i].open = false;
+			if(bank[i].ready < nextRefresh + config.refreshCycles)
+				bank[i].ready = nextRefresh + config.refreshCycles;
+		}
+		n_refreshes++;
+		nextRefresh += config.refreshInterval;
+	}
+}
+
+//Schedules one access arriving at cycle on its bank and on the data bus, returns the end of its transfer
+long long Dram::serve(unsigned int address, int bytes, long long cycle){
+	dram_bank& target = bank[(address >> columnBits) & (config.banks - 1)];
+	int row = address >> (columnBits + bankBits);
+
+	long long start = cycle > target.ready ? cycle : target.ready;
+	refresh(start);
+	if(start < target.ready)
+		start = target.ready;
+
+	int delay;
+	if(target.open && target.row == row){
+		n_row_hits++;
+		delay = config.tCas;
+	}
+	else if(!target.open){
+		n_row_empty++;
+		delay = config.tRcd + config.tCas;
+	}
+	else{
+		n_row_conflicts++;
+		delay = config.tRp + config.tRcd + config.tCas;
+	}
+
+	long long data = start + delay;
+	if(data < busFree)
+		data = busFree;
+	long long end = data + getTransferCycles(bytes);
+	busFree = end;
+	addBusy(data, end);
+
+	target.row = row;
+	target.open = config.pagePolicy == OPEN_PAGE;
+	target.ready = target.open ? end : end + config.tRp;
+	return end;
+}
+
+//Index in the write queue of the next write to serve
+int Dram::pickWrite(){
+	if(config.scheduler == FRFCFS_SCHEDULER){
+		for(int i = 0; i < queueCount; i++){
+			dram_bank& target = bank[(queue[i].address >> columnBits) & (config.banks - 1)];
+			if(target.open && target.row == (int) (queue[i].address >> (columnBits + bankBits)))
+				return i;
+		}
+	}
+	return 0;
+}
+
+//Serves the queued writes while the data bus is idle before cycle, or a single one when forced
+void Dram::drain(long long cycle, bool force){
+	while(queueCount != 0){
+		if(!force && (busFree >= cycle || queue[0].arrival >= cycle))
+			return;
+		int i = pickWrite();
+		serve(queue[i].address, queue[i].bytes, queue[i].arrival > busFree ? queue[i].arrival : busFree);
+		queueCount--;
+		for(int j = i; j < queueCount; j++)
+			queue[j] = queue[j + 1];
+		if(force)
+			return;
+	}
+}
+
+void Dram::addBusy(long long start, long long end){
+	while(start < end){
+		unsigned int window = start / config.statsWindow;
+		long long last = (long long) (window + 1) * config.statsWindow;
+		if(last > end)
+			last = end;
+		if(busy.size() <= window)
+			busy.resize(window + 1, 0);
+		busy[window] += last - start;
+		start = last;
+	}
+}
+
+int Dram::readLine(CORE_UINT(32) address, CORE_UINT(8)* line, int bytes, CORE_UINT(32) cycle, bool* dirty){
+	unsigned int addr = address.to_uint();
+	int done = 0;
+	while(done < bytes){
+		unsigned int offset = (addr + done) & (DRAM_PAGEBYTES - 1);
+		int chunk = DRAM_PAGEBYTES - offset;
+		if(chunk > bytes - done)
+			chunk = bytes - done;
+		unsigned char* page = getPage(addr + done, false);
+		for(int i = 0; i < chunk; i++){
+			line[done + i] = page == NULL ? 0 : page[offset + i];
+		}
+		done += chunk;
+	}
+	if(dirty != NULL)
+		*dirty = false;
+
+	n_reads++;
+	if(config.model == FIXED_DRAM)
+		return getReadCycles(bytes);
+
+	long long now = cycle.to_uint();
+	drain(now, false);
+	//A line still in the write queue is forwarded from it
+	for(int i = 0; i < queueCount; i++){
+		if(queue[i].address == addr){
+			readCycles += getTransferCycles(bytes);
+			return getTransferCycles(bytes);
+		}
+	}
+	int latency = serve(addr, bytes, now) - now;
+	readCycles += latency;
+	return latency;
+}
+
+int Dram::writeLine(CORE_UINT(32) address, CORE_UINT(8)* line, int bytes, CORE_UINT(32) cycle){
+	unsigned int addr = address.to_uint();
+	int done = 0;
+	while(done < bytes){
+		unsigned int offset = (addr + done) & (DRAM_PAGEBYTES - 1);
+		int chunk = DRAM_PAGEBYTES - offset;
+		if(chunk > bytes - done)
+			chunk = bytes - done;
+		unsigned char* page = getPage(addr + done, true);
+		for(int i = 0; i < chunk; i++){
+			page[offset + i] = line[done + i].to_uint();
+		}
+		done += chunk;
+	}
+
+	n_writes++;
+	if(config.model == FIXED_DRAM)
+		return getWriteCycles(bytes);
+
+	//The writer waits only when the queue is full, for the write which frees an entry
+	long long now = cycle.to_uint();
+	int latency = 0;
+	drain(now, false);
+	for(int i = 0; i < queueCount; i++){
+		if(queue[i].address == addr){
+			queue[i].bytes = bytes;
+			return 0;
+		}
+	}
+	if(queueCount == config.queueSize){
+		n_queue_full++;
+		drain(now, true);
+		if(busFree > now)
+			latency = busFree - now;
+	}
+	queue[queueCount].address = addr;
+	queue[queueCount].bytes = bytes;
+	queue[queueCount].arrival = now;
+	queueCount++;
+	return latency;
+}
+
+int Dram::getReadCycles(int bytes){
+	if(config.model == BANKED_DRAM)
+		return config.tRcd + config.tCas + getTransferCycles(bytes);
+	return config.readLatency + getTransferCycles(bytes);
+}
+
+int Dram::getWriteCycles(int bytes){
+	if(config.model == BANKED_DRAM)
+		return config.tRcd + config.tCas + getTransferCycles(bytes);
+	return config.writeLatency + getTransferCycles(bytes);
+}
+
+int Dram::getTransferCycles(int bytes){
+	if(config.model == BANKED_DRAM){
+		int burstBytes = config.bytesPerCycle * config.burstLength;
+		return (bytes + burstBytes - 1) / burstBytes * config.burstLength;
+	}
+	return (bytes + config.bytesPerCycle - 1) / config.bytesPerCycle;
 }
 
+bool Dram::isBanked(){
+	return config.model == BANKED_DRAM;
+}
+
+unsigned int Dram::getNumberReads(){
+	return n_reads;
+}
+
+unsigned int Dram::getNumberWrites(){
+	return n_writes;
+}
+
+unsigned int Dram::getNumberRowHits(){
+	return n_row_hits;
+}
+
+unsigned int Dram::getNumberRowEmpty(){
+	return n_row_empty;
+}
+
+unsigned int Dram::getNumberRowConflicts(){
+	return n_row_conflicts;
+}
+
+unsigned int Dram::getNumberRefreshes(){
+	return n_refreshes;
+}
+
+unsigned int Dram::getNumberQueueFull(){
+	return n_queue_full;
+}
+
+long long Dram::getReadCycleSum(){
+	return readCycles;
+}
+
+int Dram::getStatsWindow(){
+	return config.statsWindow;
+}
+
+const std::vector<long long>& Dram::getBusyCycles(){
+	return busy;
+}
@@ -0,0 +1,254 @@
+// vim: set ts=4 nu ai:
+#include <l2cache.h>
+
+L2Cache::L2Cache(MemoryLevel* next, L2Config config){
+	this->config = config;
+	next_level = next;
+	nbUppers = 0;
+	fillCycles = 0;
+	index = NULL;
+	cache = NULL;
+	policy = NULL;
+	classifier = NULL;
+
+	n_reads = 0;
+	n_read_misses = 0;
+	n_writes = 0;
+	n_write_misses = 0;
+	n_victims = 0;
+	n_dram_reads = 0;
+	n_dram_writes = 0;
+	n_back_invalidations = 0;
+
+	setBits = 0;
+	while((1 << setBits) < config.sets)
+		setBits++;
+	idBits = 0;
+	while((1 << idBits) < config.lineBytes)
+		idBits++;
+	if(!config.enabled)
+		return;
+
+	assert(1 << setBits == config.sets);
+	assert(1 << idBits == config.lineBytes);
+	assert((config.ways & (config.ways - 1)) == 0 && config.ways <= CACHE_MAXWAYS);
+
+	int lines = config.sets*config.ways;
+	index = new cache_index<32>[lines];
+	cache = new CORE_UINT(8)[lines*config.lineBytes];
+	policy = new ConfigurablePolicy<CACHE_DYNAMIC>[config.sets];
+	for(int i=0;i<lines;i++){
+		index[i].tag = 0;
+		index[i].dirtybit = 0;
+		index[i].invalid = 1;
+		index[i].prefetched = 0;
+	}
+	for(int i=0;i<config.sets;i++)
+		policy[i].configure(config.ways, config.policy);
+	if(config.classifyMisses)
+		classifier = new MissClassifier(lines);
+}
+
+L2Cache::~L2Cache(){
+	delete[] index;
+	delete[] cache;
+	delete[] policy;
+	delete classifier;
+}
+
+bool L2Cache::isEnabled(){
+	return config.enabled;
+}
+
+void L2Cache::addUpperCache(UpperCache* upper){
+	assert(nbUppers < L2_MAXUPPERS);
+	uppers[nbUppers++] = upper;
+}
+
+//Returns the way holding tag, -1 on a miss
+int L2Cache::findWay(int set, CORE_UINT(32) tag){
+	for(int way=0;way<config.ways;way++){
+		cache_index<32>& line = index[set*config.ways + way];
+		if(line.invalid == 0 && line.tag == tag)
+			return way;
+	}
+	return -1;
+}
+
+//Frees a way for tag, reading its line from the next level when fetch is set
+int L2Cache::allocate(int set, CORE_UINT(32) tag, bool fetch, CORE_UINT(32) cycle){
+	int way = -1;
+	for(int i=0;i<config.ways && way<0;i++){
+		if(index[set*config.ways + i].invalid)
+			way = i;
+	}
+	if(way < 0)
+		way = policy[set].victim();
+
+	cache_index<32>& line = index[set*config.ways + way];
+	CORE_UINT(8)* data = cache + (set*config.ways + way)*config.lineBytes;
+	CORE_UINT(32) address;
+	if(!line.invalid){
+		address = line.tag;
+		address = (address << (setBits + idBits)) | (set << idBits);
+		//Dirty L1 copies are newer than the victim, their data goes to the DRAM with it
+		if(config.inclusion == INCLUSIVE_INCLUSION){
+			for(int u=0;u<nbUppers;u++){
+				int step = uppers[u]->getLineBytes();
+				for(int offset=0;offset<config.lineBytes;offset+=step){
+					if(!uppers[u]->probe(address + offset))
+						continue;
+					n_back_invalidations++;
+					if(uppers[u]->invalidateLine(address + offset, data + offset))
+						line.dirtybit = 1;
+				}
+			}
+		}
+		if(line.dirtybit){
+			n_dram_writes++;
+			next_level->writeLine(address, data, config.lineBytes, cycle);
+		}
+	}
+
+	fillCycles = 0;
+	if(fetch){
+		n_dram_reads++;
+		address = tag;
+		address = (address << (setBits + idBits)) | (set << idBits);
+		fillCycles = next_level->readLine(address, data, config.lineBytes, cycle);
+	}
+	line.tag = tag;
+	line.dirtybit = 0;
+	line.invalid = 0;
+	policy[set].insert(way);
+	return way;
+}
+
+int L2Cache::readLine(CORE_UINT(32) address, CORE_UINT(8)* line, int bytes, CORE_UINT(32) cycle, bool* dirty){
+	int set = getSet(address);
+	CORE_UINT(32) tag = getTag(address);
+	int offset = (address & (config.lineBytes - 1)).to_int();
+	n_reads++;
+	if(dirty != NULL)
+		*dirty = false;
+
+	int way = findWay(set, tag);
+	int cycles = config.latency + getTransferCycles(bytes);
+	if(classifier != NULL)
+		classifier->access(address >> idBits, way < 0);
+	if(way < 0){
+		n_read_misses++;
+		if(config.inclusion == EXCLUSIVE_INCLUSION){
+			n_dram_reads++;
+			return config.latency + next_level->readLine(address, line, bytes, cycle + config.latency);
+		}
+		way = allocate(set, tag, true, cycle + config.latency);
+		cycles = config.latency + fillCycles;
+	}
+	else
+		policy[set].touch(way);
+
+	CORE_UINT(8)* data = cache + (set*config.ways + way)*config.lineBytes + offset;
+	for(int i=0;i<bytes;i++)
+		line[i] = data[i];
+
+	//The line moves up, the L1 now holds the only copy
+	if(config.inclusion == EXCLUSIVE_INCLUSION){
+		cache_index<32>& entry = index[set*config.ways + way];
+		if(dirty != NULL)
+			*dirty = entry.dirtybit;
+		else if(entry.dirtybit){
+			n_dram_writes++;
+			next_level->writeLine(address, line, bytes, cycle);
+		}
+		entry.invalid = 1;
+		entry.dirtybit = 0;
+	}
+	return cycles;
+}
+
+int L2Cache::writeLine(CORE_UINT(32) address, CORE_UINT(8)* line, int bytes, CORE_UINT(32) cycle){
+	int set = getSet(address);
+	CORE_UINT(32) tag = getTag(address);
+	int offset = (address & (config.lineBytes - 1)).to_int();
+	n_writes++;
+
+	int way = findWay(set, tag);
+	if(classifier != NULL)
+		classifier->access(address >> idBits, way < 0);
+	if(way < 0){
+		n_write_misses++;
+		//The rest of a larger L2 line comes from the DRAM
+		way = allocate(set, tag, bytes < config.lineBytes, cycle + config.latency);
+	}
+	else
+		policy[set].touch(way);
+
+	CORE_UINT(8)* data = cache + (set*config.ways + way)*config.lineBytes + offset;
+	for(int i=0;i<bytes;i++)
+		data[i] = line[i];
+	index[set*config.ways + way].dirtybit = 1;
+	return config.latency + getTransferCycles(bytes);
+}
+
+void L2Cache::evictLine(CORE_UINT(32) address, CORE_UINT(8)* line, int bytes, CORE_UINT(32) cycle){
+	if(config.inclusion != EXCLUSIVE_INCLUSION)
+		return;
+	int set = getSet(address);
+	CORE_UINT(32) tag = getTag(address);
+	//The other L1 may have given the same line already
+	int way = findWay(set, tag);
+	if(way >= 0){
+		policy[set].touch(way);
+		return;
+	}
+	n_victims++;
+	way = allocate(set, tag, false, cycle);
+	CORE_UINT(8)* data = cache + (set*config.ways + way)*config.lineBytes;
+	for(int i=0;i<bytes;i++)
+		data[i] = line[i];
+}
+
+int L2Cache::getReadCycles(int bytes){
+	return config.latency + getTransferCycles(bytes);
+}
+
+int L2Cache::getTransferCycles(int bytes){
+	return (bytes + config.bytesPerCycle - 1) / config.bytesPerCycle;
+}
+
+CORE_UINT(32) L2Cache::getNumberReads(){
+	return n_reads;
+}
+
+CORE_UINT(32) L2Cache::getNumberReadMisses(){
+	return n_read_misses;
+}
+
+CORE_UINT(32) L2Cache::getNumberWrites(){
+	return n_writes;
+}
+
+CORE_UINT(32) L2Cache::getNumberWriteMisses(){
+	return n_write_misses;
+}
+
+CORE_UINT(32) L2Cache::getNumberVictims(){
+	return n_victims;
+}
+
+CORE_UINT(32) L2Cache::getNumberDramReads(){
+	return n_dram_reads;
+}
+
+CORE_UINT(32) L2Cache::getNumberDramWrites(){
+	return n_dram_writes;
+}
+
+CORE_UINT(32) L2Cache::getNumberBackInvalidations(){
+	return n_back_invalidations;
+}
+
+MissClassifier* L2Cache::getMissClassifier(){
+	return classifier;
+}
@@ -0,0 +1,128 @@
+// vim: set ts=4 nu ai:
+#include <lockstep.h>
+#include <simulator/riscvSimulator.h>
+#include <isa/riscvISA.h>
+#include <lib/elfImage.h>
+#include <string.h>
+
+using namespace std;
+
+IssLockstep::IssLockstep() : iss(NULL), retired(0), diverged(false){
+	memset(history, 0, sizeof(history));
+}
+
+IssLockstep::~IssLockstep(){
+	delete iss;
+}
+
+//argc is 0 as the core starts with nothing on its stack
+void IssLockstep::load(const ElfImage& image){
+	iss = new RiscvSimulator();
+	if(image.is32Bits)
+		iss->useFlatMemory();
+	iss->load(image, 0, NULL);
+}
+
+//Opcodes writing rd in the instruction set simulator
+static bool writesRegister(int opCode){
+	return opCode == RISCV_LUI || opCode == RISCV_AUIPC || opCode == RISCV_JAL || opCode == RISCV_JALR
+		|| opCode == RISCV_LD || opCode == RISCV_OPI || opCode == RISCV_OP;
+}
+
+static void printWrite(ostream& out, int dest, int value){
+	if(dest == 0)
+		out << "no register written";
+	else
+		out << "x" << dec << dest << " = " << hex << value;
+}
+
+void IssLockstep::printHistory(ostream& out){
+	out << "Last retired instructions, the oldest first:" << endl;
+	unsigned int count = retired < LOCKSTEP_HISTORY ? retired : LOCKSTEP_HISTORY;
+	for(unsigned int i = 0; i < count; i++){
+		const LockstepRecord& record = history[(retired - count + i) % LOCKSTEP_HISTORY];
+		out << "  cycle " << hex << record.cycle << " pc " << record.pc << " "
+			<< printDecodedInstrRISCV(record.instruction) << " -> ";
+		printWrite(out, record.dest, record.value);
+		out << endl;
+	}
+}
+
+bool IssLockstep::check(unsigned int cycle, unsigned int pc, int opCode, int dest, int value, unsigned int address,
+		int data, int funct3, ostream& out){
+	unsigned int issPc = iss->pc;
+	unsigned int instruction = 0;
+	iss->readMemory(issPc, &instruction, 4);
+	int issOpCode = instruction & 0x7f;
+	int rd = (instruction >> 7) & 0x1f;
+	int rs1 = (instruction >> 15) & 0x1f;
+	int rs2 = (instruction >> 20) & 0x1f;
+	int issFunct3 = (instruction >> 12) & 0x7;
+
+	//Stores are checked against the registers they read, before the step
+	unsigned int issAddress = 0;
+	int issData = 0;
+	if(issOpCode == RISCV_ST){
+		int offset = ((int) instruction >> 20 & ~0x1f) | rd;
+		issAddress = iss->getRegister(rs1) + offset;
+		issData = iss->getRegister(rs2);
+	}
+
+	//The system calls are run by the core, the simulator only takes their result
+	int error = SIM_ERROR_NONE;
+	if(issOpCode == RISCV_SYSTEM && pc == issPc){
+		iss->pc = issPc + 4;
+		iss->n_inst++;
+		iss->setRegister(dest, value);
+	}
+	else if(pc == issPc && opCode == issOpCode && iss->run(1) == SIM_ERROR)
+		error = iss->error;
+	int issDest = rd != 0 && writesRegister(issOpCode) ? rd : 0;
+	int issValue = issDest != 0 ? iss->getRegister(issDest) : 0;
+	if(issOpCode == RISCV_SYSTEM){
+		issDest = dest;
+		issValue = value;
+	}
+
+	const char* reason = NULL;
+	if(pc != issPc)
+		reason = "the core retires another instruction";
+	else if(opCode != issOpCode)
+		reason = "the core retires another opcode";
+	else if(error != SIM_ERROR_NONE)
+		reason = iss->errorMessage.c_str();
+	else if(dest != issDest || (dest != 0 && value != issValue))
+		reason = "the register written differs";
+	else if(opCode == RISCV_ST){
+		unsigned int mask = issFunct3 == RISCV_ST_STB ? 0xff : (issFunct3 == RISCV_ST_STH ? 0xffff : 0xffffffff);
+		if(address != issAddress || funct3 != issFunct3 || ((data ^ issData) & mask) != 0)
+			reason = "the store differs";
+	}
+
+	if(reason == NULL){
+		LockstepRecord& record = history[retired % LOCKSTEP_HISTORY];
+		record.cycle = cycle;
+		record.pc = pc;
+		record.instruction = instruction;
+		record.dest = dest;
+		record.value = value;
+		retired++;
+		return true;
+	}
+
+	diverged = true;
+	out << endl << "Lockstep divergence at cycle " << hex << cycle << ", after " << dec << retired
+		<< " matching instructions: " << reason << endl;
+	out << "  core: pc " << hex << pc << ", opcode " << opCode << ", ";
+	printWrite(out, dest, value);
+	if(opCode == RISCV_ST)
+		out << ", stores " << hex << data << " at " << address << " (funct3 " << funct3 << ")";
+	out << endl << "  ISS:  pc " << hex << issPc << " " << printDecodedInstrRISCV(instruction) << ", ";
+	printWrite(out, issDest, issValue);
+	if(issOpCode == RISCV_ST)
+		out << ", stores " << hex << issData << " at " << issAddress << " (funct3 " << issFunct3 << ")";
+	out << endl;
+	printHistory(out);
+	out << hex;
+	return false;
+}
@@ -0,0 +1,50 @@
+// vim: set ts=4 nu ai:
+#include <missclassifier.h>
+
+MissClassifier::MissClassifier(int lines){
+	capacity = lines;
+	n_compulsory = 0;
+	n_capacity = 0;
+	n_conflict = 0;
+}
+
+void MissClassifier::access(CORE_UINT(32) lineAddress, bool miss, bool allocate){
+	unsigned int line = lineAddress.to_uint();
+	bool compulsory = seen.find(line) == seen.end();
+	std::unordered_map<unsigned int, std::list<unsigned int>::iterator>::iterator entry = lines.find(line);
+	bool capacityMiss = entry == lines.end();
+
+	if(miss){
+		if(compulsory)
+			n_compulsory++;
+		else if(capacityMiss)
+			n_capacity++;
+		else
+			n_conflict++;
+	}
+
+	if(!capacityMiss)
+		lru.splice(lru.begin(), lru, entry->second);
+	else if(allocate){
+		if(lru.size() == capacity){
+			lines.erase(lru.back());
+			lru.pop_back();
+		}
+		lru.push_front(line);
+		lines[line] = lru.begin();
+	}
+	if(allocate)
+		seen.insert(line);
+}
+
+CORE_UINT(32) MissClassifier::getNumberCompulsory(){
+	return n_compulsory;
+}
+
+CORE_UINT(32) MissClassifier::getNumberCapacity(){
+	return n_capacity;
+}
+
+CORE_UINT(32) MissClassifier::getNumberConflict(){
+	return n_conflict;
+}
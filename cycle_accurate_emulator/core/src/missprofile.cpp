@@ -0,0 +1,84 @@
+// vim: set ts=4 nu ai:
+#include <missprofile.h>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+typedef pair<string, miss_count> named_count;
+
+//Most misses first, then most writebacks, then by name so that the report is stable
+static bool moreMisses(const named_count& a, const named_count& b){
+	if(a.second.misses != b.second.misses)
+		return a.second.misses > b.second.misses;
+	if(a.second.writebacks != b.second.writebacks)
+		return a.second.writebacks > b.second.writebacks;
+	return a.first < b.first;
+}
+
+static string hexAddress(unsigned int address){
+	ostringstream name;
+	name << "0x" << hex << setw(8) << setfill('0') << address;
+	return name.str();
+}
+
+void MissProfile::record(CORE_UINT(32) pc, CORE_UINT(32) address, bool writeback){
+	miss_count& instruction = byPc[pc.to_uint()];
+	miss_count& data = byAddress[address.to_uint()];
+	instruction.misses++;
+	data.misses++;
+	if(writeback){
+		instruction.writebacks++;
+		data.writebacks++;
+	}
+}
+
+void MissProfile::writeTable(ostream& out, const char* title, const char* column,
+		const unordered_map<string, miss_count>& counts){
+	vector<named_count> sorted(counts.begin(), counts.end());
+	sort(sorted.begin(), sorted.end(), moreMisses);
+	unsigned long long total = 0;
+	for(unsigned int i=0;i<sorted.size();i++)
+		total += sorted[i].second.misses;
+
+	out << title << " (" << sorted.size() << " in total)" << endl;
+	out << setw(12) << "misses" << setw(8) << "%" << setw(12) << "writebacks" << "  " << column << endl;
+	for(unsigned int i=0;i<sorted.size() && i<MISSPROFILE_TOP;i++){
+		out << setw(12) << sorted[i].second.misses << setw(8) << fixed << setprecision(2)
+			<< (total ? 100.0 * sorted[i].second.misses / total : 0.0) << setw(12) << sorted[i].second.writebacks
+			<< "  " << sorted[i].first << endl;
+	}
+	out << endl;
+}
+
+void MissProfile::writeReport(ostream& out, const char* cache, const SymbolTable& symbols, bool objects){
+	unordered_map<string, miss_count> instructions;
+	unordered_map<string, miss_count> functions;
+	unordered_map<string, miss_count> data;
+
+	for(unordered_map<unsigned int, miss_count>::iterator it = byPc.begin(); it != byPc.end(); it++){
+		const char* function = symbols.getFunction(it->first);
+		string name = hexAddress(it->first) + " " + (function ? function : "?");
+		instructions[name] = it->second;
+		miss_count& count = functions[function ? function : "?"];
+		count.misses += it->second.misses;
+		count.writebacks += it->second.writebacks;
+	}
+	for(unordered_map<unsigned int, miss_count>::iterator it = byAddress.begin(); it != byAddress.end(); it++){
+		const char* object = symbols.getObject(it->first);
+		miss_count& count = data[object ? object : "[stack, heap or unnamed data]"];
+		count.misses += it->second.misses;
+		count.writebacks += it->second.writebacks;
+	}
+
+	string title = string(cache) + " misses by instruction";
+	writeTable(out, title.c_str(), "pc function", instructions);
+	title = string(cache) + " misses by function";
+	writeTable(out, title.c_str(), "function", functions);
+	if(objects){
+		title = string(cache) + " misses by data object";
+		writeTable(out, title.c_str(), "object", data);
+	}
+}
@@ -0,0 +1,162 @@
+// vim: set ts=4 nu ai:
+#include <pipeline.h>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+
+using namespace std;
+
+Pipeline::Pipeline(const SimulatorConfig& config, const ElfImage& image, ostream& out) : dram(config.dram),
+	l2(&dram, config.l2), icache(config.l2.enabled ? (MemoryLevel*) &l2 : &dram, config.icache),
+	dcache(config.l2.enabled ? (MemoryLevel*) &l2 : &dram, config.dcache), predictor(config.predictor),
+	image(image), missReport(config.missReport), reuseReport(config.reuseReport), reuse(config.dcache.lineBytes),
+	cpiReport(config.cpiReport), out(out){
+	if(l2.isEnabled()){
+		l2.addUpperCache(&icache);
+		l2.addUpperCache(&dcache);
+	}
+	if(!missReport.empty()){
+		icache.setMissProfile(&icacheProfile);
+		dcache.setMissProfile(&dcacheProfile);
+	}
+	if(!reuseReport.empty())
+		dcache.setStackDistance(&reuse);
+	state.out = &out;
+	loadImage();
+	if(config.lockstep)
+		lockstep.load(image);
+}
+
+void Pipeline::loadImage(){
+	for(unsigned int i = 0; i < image.sections.size(); i++){
+		const ElfImageSection& section = image.sections[i];
+		for(unsigned int byteNumber = 0; byteNumber < section.content.size(); byteNumber++)
+			dram.setMemory(section.address + byteNumber, (CORE_UINT(8)) section.content[byteNumber]);
+	}
+}
+
+bool Pipeline::openCycleTrace(const SimulatorConfig& config){
+	if(config.traceMode == TRACE_OFF)
+		return true;
+	if(!trace.open(config.traceFile.c_str(), config.traceMode == TRACE_FULL ? 1 : config.traceInterval)){
+		cerr << "Cannot write the trace to " << config.traceFile << endl;
+		return false;
+	}
+	return true;
+}
+
+//Runs the instantiation of doStep with only the instrumentation asked for, see pipelineconfig.h
+void Pipeline::run(CORE_UINT(32) cycles){
+	CORE_INT(32)* dm_out = new CORE_INT(32)[8192];
+	CORE_UINT(32) pc = image.start;
+	CpiStack* cpiStack = cpiReport.empty() ? NULL : &cpi;
+	CycleTrace* cycleTrace = trace.isOpen() ? &trace : NULL;
+	if(lockstep.isLoaded())
+		doStep<LockstepPipeline>(&state, pc, cycles, &icache, &dcache, &predictor, NULL, NULL, &lockstep, dm_out);
+	else if(cpiStack != NULL && cycleTrace != NULL)
+		doStep<FullPipeline>(&state, pc, cycles, &icache, &dcache, &predictor, cpiStack, cycleTrace, NULL, dm_out);
+	else if(cpiStack != NULL)
+		doStep<ProfilePipeline>(&state, pc, cycles, &icache, &dcache, &predictor, cpiStack, NULL, NULL, dm_out);
+	else if(cycleTrace != NULL)
+		doStep<TracePipeline>(&state, pc, cycles, &icache, &dcache, &predictor, NULL, cycleTrace, NULL, dm_out);
+	else
+		doStep<FastPipeline>(&state, pc, cycles, &icache, &dcache, &predictor, NULL, NULL, NULL, dm_out);
+	delete[] dm_out;
+	if(lockstep.isLoaded() && !lockstep.hasDiverged())
+		out << endl << "Lockstep: the " << dec << lockstep.getNumberRetired()
+			<< " retired instructions match the instruction set simulator" << hex << endl;
+}
+
+bool Pipeline::writeReports(){
+	printL2Statistics();
+	printDramStatistics();
+	bool written = writeMissReport();
+	written = writeReuseReport() && written;
+	return writeCpiReport() && written;
+}
+
+void Pipeline::printL2Statistics(){
+	if(!l2.isEnabled())
+		return;
+	out << endl << "Printing L2 statistics :" << endl;
+	out << "reads: " << l2.getNumberReads() << endl;
+	out << "read misses: " << l2.getNumberReadMisses() << endl;
+	out << "writes: " << l2.getNumberWrites() << endl;
+	out << "write misses: " << l2.getNumberWriteMisses() << endl;
+	if(l2.getMissClassifier() != NULL){
+		out << "Compulsory misses: " << l2.getMissClassifier()->getNumberCompulsory() << endl;
+		out << "Capacity misses: " << l2.getMissClassifier()->getNumberCapacity() << endl;
+		out << "Conflict misses: " << l2.getMissClassifier()->getNumberConflict() << endl;
+	}
+	if(l2.getNumberVictims() != 0)
+		out << "L1 victims kept: " << l2.getNumberVictims() << endl;
+	if(l2.getNumberBackInvalidations() != 0)
+		out << "Back-invalidated L1 lines: " << l2.getNumberBackInvalidations() << endl;
+	out << "Number of DRAM reads: " << l2.getNumberDramReads() << endl;
+	out << "Number of DRAM writes: " << l2.getNumberDramWrites() << endl;
+}
+
+void Pipeline::printDramStatistics(){
+	if(!dram.isBanked())
+		return;
+	out << endl << "Printing DRAM statistics :" << endl;
+	out << "reads: " << dram.getNumberReads() << endl;
+	out << "writes: " << dram.getNumberWrites() << endl;
+	out << "row hits: " << dram.getNumberRowHits() << endl;
+	out << "row misses: " << dram.getNumberRowEmpty() << endl;
+	out << "row conflicts: " << dram.getNumberRowConflicts() << endl;
+	out << "refreshes: " << dram.getNumberRefreshes() << endl;
+	out << "writes waiting for a full queue: " << dram.getNumberQueueFull() << endl;
+	if(dram.getNumberReads() != 0)
+		out << "Average read latency: " << dec << (double) dram.getReadCycleSum() / dram.getNumberReads() << hex << endl;
+
+	//One line per stats window, in decimal
+	const vector<long long>& busy = dram.getBusyCycles();
+	long long window = dram.getStatsWindow();
+	out << "Data bus utilization:" << dec << endl;
+	for(unsigned int i = 0; i < busy.size(); i++)
+		out << "  cycles " << i*window << "-" << (i + 1)*window - 1 << ": " << fixed << setprecision(1)
+			<< 100.0 * busy[i] / window << "%" << endl;
+	out.unsetf(ios::floatfield);
+	out << hex;
+}
+
+bool Pipeline::writeMissReport(){
+	if(missReport.empty())
+		return true;
+	ofstream report(missReport.c_str());
+	if(!report){
+		cerr << "Cannot write the miss report to " << missReport << endl;
+		return false;
+	}
+	report << "Misses of " << image.path << endl << endl;
+	dcacheProfile.writeReport(report, "DCache", image.symbols, true);
+	icacheProfile.writeReport(report, "ICache", image.symbols, false);
+	return true;
+}
+
+bool Pipeline::writeReuseReport(){
+	if(reuseReport.empty())
+		return true;
+	ofstream report(reuseReport.c_str());
+	if(!report){
+		cerr << "Cannot write the reuse report to " << reuseReport << endl;
+		return false;
+	}
+	report << "Data accesses of " << image.path << endl;
+	reuse.writeReport(report);
+	return true;
+}
+
+bool Pipeline::writeCpiReport(){
+	if(cpiReport.empty())
+		return true;
+	ofstream report(cpiReport.c_str());
+	if(!report){
+		cerr << "Cannot write the CPI report to " << cpiReport << endl;
+		return false;
+	}
+	report << "Cycles of " << image.path << endl;
+	cpi.writeReport(report, image.symbols);
+	return true;
+}
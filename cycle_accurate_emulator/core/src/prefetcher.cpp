@@ -0,0 +1,169 @@
+// vim: set ts=4 nu ai:
+#include <prefetcher.h>
+#include <stdlib.h>
+
+Prefetcher::Prefetcher(int lineBytes, int degree){
+	lineBits = 0;
+	while((1 << lineBits) < lineBytes)
+		lineBits++;
+	this->degree = degree;
+}
+
+
+NextLinePrefetcher::NextLinePrefetcher(int lineBytes, int degree) : Prefetcher(lineBytes, degree){
+}
+
+int NextLinePrefetcher::access(CORE_UINT(32) pc, CORE_UINT(32) address, bool miss, bool prefetchHit,
+		CORE_UINT(32) candidates[PREFETCH_MAXDEGREE]){
+	if(!miss && !prefetchHit)
+		return 0;
+	CORE_UINT(32) line = address >> lineBits;
+	for(int i=0;i<degree;i++)
+		candidates[i] = (line + i + 1) << lineBits;
+	return degree;
+}
+
+
+StridePrefetcher::StridePrefetcher(int lineBytes, int degree) : Prefetcher(lineBytes, degree){
+	for(int i=0;i<PREFETCH_STRIDEENTRIES;i++)
+		table[i].valid = 0;
+}
+
+int StridePrefetcher::access(CORE_UINT(32) pc, CORE_UINT(32) address, bool miss, bool prefetchHit,
+		CORE_UINT(32) candidates[PREFETCH_MAXDEGREE]){
+	stride_entry& entry = table[(pc >> 2).to_int() % PREFETCH_STRIDEENTRIES];
+	if(!entry.valid || entry.pc != pc){
+		entry.pc = pc;
+		entry.address = address;
+		entry.stride = 0;
+		entry.confidence = 0;
+		entry.valid = 1;
+		return 0;
+	}
+
+	CORE_INT(32) stride = address - entry.address;
+	entry.address = address;
+	if(stride == entry.stride){
+		if(entry.confidence < 3)
+			entry.confidence++;
+	}
+	else if(entry.confidence > 0)
+		entry.confidence--;
+	else
+		entry.stride = stride;
+
+	if(entry.confidence < 2 || entry.stride == 0)
+		return 0;
+
+	//Strides shorter than a line look degree lines ahead in the same direction
+	int n = 0;
+	int lineBytes = 1 << lineBits;
+	int step = entry.stride.to_int();
+	if(step < lineBytes && step > -lineBytes)
+		step = step > 0 ? lineBytes : -lineBytes;
+	for(int i=1;i<=degree;i++)
+		candidates[n++] = ((address + step * i) >> lineBits) << lineBits;
+	return n;
+}
+
+
+StreamBufferPrefetcher::StreamBufferPrefetcher(int lineBytes, int degree, int streams) : Prefetcher(lineBytes, degree){
+	nbStreams = streams;
+	hitStream = -1;
+	uses = 0;
+	for(int i=0;i<PREFETCH_MAXSTREAMS;i++)
+		this->streams[i].valid = 0;
+}
+
+bool StreamBufferPrefetcher::lookup(CORE_UINT(32) line, CORE_UINT(32)* ready){
+	hitStream = -1;
+	for(int i=0;i<nbStreams;i++){
+		stream_buffer& stream = streams[i];
+		if(!stream.valid || stream.count == 0 || stream.entries[stream.head].line != line)
+			continue;
+		stream_entry& entry = stream.entries[stream.head];
+		stream.head = (stream.head + 1) % degree;
+		stream.count--;
+		//The prefetch of the head was dropped before being issued, the miss goes to the DRAM
+		if(entry.ready == 0)
+			return false;
+		*ready = entry.ready;
+		hitStream = i;
+		return true;
+	}
+	return false;
+}
+
+bool StreamBufferPrefetcher::hold(CORE_UINT(32) line, CORE_UINT(32) ready){
+	for(int i=0;i<nbStreams;i++){
+		stream_buffer& stream = streams[i];
+		if(!stream.valid)
+			continue;
+		for(int j=0;j<stream.count;j++){
+			stream_entry& entry = stream.entries[(stream.head + j) % degree];
+			if(entry.line == line && entry.ready == 0){
+				entry.ready = ready;
+				return true;
+			}
+		}
+	}
+	//The stream was reallocated while the prefetch was queued, the line is dropped
+	return true;
+}
+
+int StreamBufferPrefetcher::access(CORE_UINT(32) pc, CORE_UINT(32) address, bool miss, bool prefetchHit,
+		CORE_UINT(32) candidates[PREFETCH_MAXDEGREE]){
+	CORE_UINT(32) line = address >> lineBits;
+	uses++;
+
+	//The head of a stream was used: keep the buffer full
+	if(prefetchHit && hitStream >= 0){
+		stream_buffer& stream = streams[hitStream];
+		hitStream = -1;
+		stream.lastUse = uses;
+		stream.entries[(stream.head + stream.count) % degree].line = stream.next;
+		stream.entries[(stream.head + stream.count) % degree].ready = 0;
+		stream.count++;
+		candidates[0] = stream.next << lineBits;
+		stream.next++;
+		return 1;
+	}
+	if(!miss)
+		return 0;
+
+	int victim = 0;
+	for(int i=0;i<nbStreams;i++){
+		if(!streams[i].valid){
+			victim = i;
+			break;
+		}
+		if(streams[i].lastUse < streams[victim].lastUse)
+			victim = i;
+	}
+	stream_buffer& stream = streams[victim];
+	stream.valid = 1;
+	stream.head = 0;
+	stream.count = degree;
+	stream.lastUse = uses;
+	for(int i=0;i<degree;i++){
+		stream.entries[i].line = line + i + 1;
+		stream.entries[i].ready = 0;
+		candidates[i] = (line + i + 1) << lineBits;
+	}
+	stream.next = line + degree + 1;
+	return degree;
+}
+
+
+Prefetcher* createPrefetcher(int type, int lineBytes, int degree, int streams){
+	switch(type){
+		case NEXTLINE_PREFETCHER:
+			return new NextLinePrefetcher(lineBytes, degree);
+		case STRIDE_PREFETCHER:
+			return new StridePrefetcher(lineBytes, degree);
+		case STREAM_PREFETCHER:
+			return new StreamBufferPrefetcher(lineBytes, degree, streams);
+		default:
+			return NULL;
+	}
+}
@@ -1,19 +1,21 @@
 /* vim: set ts=4 ai nu: */
 #include <lib/elfFile.h>
-#include <fcntl.h>
+#include <lib/elfImage.h>
 #include <unistd.h>
 #include <stdlib.h>
-#include <sys/stat.h>
-#include <sys/time.h>
 #include <stdio.h>
 #include <iostream>
-#include <string.h>
-#include <core.h>
-#include <portability.h>
+#include <fstream>
+#include <sstream>
+#include <string>
 #include <vector>
-#include <dram.h>
-#include <cache.h>
-#include <iomanip>
+#include <map>
+#include <set>
+#include <atomic>
+#include <thread>
+#include <portability.h>
+#include <config.h>
+#include <pipeline.h>
 //#include "sds_lib.h"
 
 #ifdef __VIVADO__
@@ -21,105 +23,168 @@
 #endif
 
 using namespace std;
-//cout << showbase << hex;
-class Simulator{
-
-	private:
-		//counters
-		Dram dram;
-		Cache icache;
-		Cache dcache;
-		ElfFile elfFile;
-		CORE_UINT(32) pc;
-
-	public:
-
-		Simulator(const char* binaryFile): elfFile(binaryFile), icache(&dram), dcache(&dram){
-
-		}
-
-		void loadElfIntoDram(){
-			unsigned int sectionCounter;
-			unsigned int sectionTableSize = elfFile.sectionTable->size();
-			unsigned char* sectionContent;
-			unsigned int byteNumber;
-
-			for (sectionCounter = 0; sectionCounter < sectionTableSize;  sectionCounter++){
-        		ElfSection *oneSection = elfFile.sectionTable->at(sectionCounter);
-        		if(oneSection->address != 0 && oneSection->getName().compare(".text")){
-            		//If the address is not null we place its content into memory
-            		sectionContent = oneSection->getSectionCode();
-            		for (byteNumber = 0; byteNumber<oneSection->size; byteNumber++){
-						//cout << oneSection->address + byteNumber  << " : " << (CORE_UINT(8)) sectionContent[byteNumber] << endl;
-           				dram.setMemory(oneSection->address + byteNumber, (CORE_UINT(8))sectionContent[byteNumber]); 
-					}
-       		 	}		
-
-     		   	if(!oneSection->getName().compare(".text")){
-        			sectionContent = oneSection->getSectionCode();
-            		for (byteNumber = 0;byteNumber<oneSection->size; byteNumber++){
-                		dram.setMemory(oneSection->address + byteNumber, sectionContent[byteNumber]);
-            		}
-    			}
-    		}
-		}
-
-		Cache* getICache(){
-			return &icache;
-		}
 
+/*********************************************************
+ * 	Batch of runs
+ *
+ * 	catapult.sim -b jobs simulates every line of the job
+ * 	file: an ELF file, or the default one, and overrides
+ * 	applied after the -c and -o options. The runs are
+ * 	spread over a pool of threads, each with its own
+ * 	pipeline, the ELF files being read once and shared.
+ * 	Their outputs are printed in the order of the file
+ * 	once all of them are done.
+ *********************************************************/
+
+struct BatchJob{
+	string name; //The line of the job file
+	SimulatorConfig config;
+	string output;
+	bool failed;
+
+	BatchJob() : failed(false){}
+};
 
-		Cache* getDCache(){
-			return &dcache;
+static bool readJobs(const char* fileName, const SimulatorConfig& base, vector<BatchJob>* jobs){
+	ifstream in(fileName);
+	if(!in){
+		cerr << "Cannot open " << fileName << endl;
+		return false;
+	}
+	string line;
+	while(getline(in, line)){
+		istringstream tokens(line);
+		string option;
+		BatchJob job;
+		job.config = base;
+		while(tokens >> option){
+			if(option[0] == '#')
+				break;
+			if(option.find('=') == string::npos)
+				job.config.elfFile = option;
+			else if(!applyOverride(&job.config, option))
+				return false;
+			job.name += (job.name.empty() ? "" : " ") + option;
 		}
+		if(job.name.empty())
+			continue;
+		if(!checkConfig(&job.config))
+			return false;
+		jobs->push_back(job);
+	}
+	return true;
+}
 
-		void setPC(){
-			int oneSymbol;
-			const char* name;
-   			for (oneSymbol = 0; oneSymbol < elfFile.symbols->size(); oneSymbol++){
-				ElfSymbol *symbol = elfFile.symbols->at(oneSymbol);
-				name = (const char*) &(elfFile.sectionTable->at(elfFile.indexOfSymbolNameSection)->getSectionCode()[symbol->name]);
-				if (strcmp(name, "_start") == 0){
-					pc = symbol->offset;
-				}
+//Two runs writing the same report or trace would overwrite each other
+static bool checkOutputs(const vector<BatchJob>& jobs){
+	set<string> files;
+	for(unsigned int i = 0; i < jobs.size(); i++){
+		const SimulatorConfig& config = jobs[i].config;
+		string outputs[4] = {config.missReport, config.reuseReport, config.cpiReport,
+			config.traceMode != TRACE_OFF ? config.traceFile : ""};
+		for(int j = 0; j < 4; j++){
+			if(outputs[j].empty())
+				continue;
+			if(!files.insert(outputs[j]).second){
+				cerr << outputs[j] << " is written by several runs of the batch" << endl;
+				return false;
 			}
 		}
+	}
+	return true;
+}
 
-		CORE_UINT(32) getPC(){
-			return pc;
+//What the program writes comes first, then the messages and the statistics of the pipeline
+static void runJob(BatchJob* job, const ElfImage& image){
+	ostringstream out;
+	out << hex;
+	char* programOutput = NULL;
+	size_t programSize = 0;
+	FILE* program = open_memstream(&programOutput, &programSize);
+	{
+		Pipeline pipeline(job->config, image, out);
+		if(program != NULL)
+			pipeline.setProgramOutput(program);
+		if(pipeline.openCycleTrace(job->config)){
+			pipeline.run(job->config.cycles);
+			job->failed = !pipeline.writeReports() || pipeline.hasDiverged();
 		}
-};
+		else
+			job->failed = true;
+	}
+	if(program != NULL){
+		fclose(program);
+		job->output.assign(programOutput, programSize);
+		free(programOutput);
+	}
+	job->output += out.str();
+}
 
+static int runBatch(const SimulatorConfig& base){
+	vector<BatchJob> jobs;
+	if(!readJobs(base.jobFile.c_str(), base, &jobs) || !checkOutputs(jobs))
+		return 1;
+
+	//Read-only once loaded, the runs of the same program share its image
+	map<string, ElfImage*> images;
+	for(unsigned int i = 0; i < jobs.size(); i++){
+		const string& elf = jobs[i].config.elfFile;
+		if(images.count(elf))
+			continue;
+		if(access(elf.c_str(), R_OK) != 0){
+			cerr << "Cannot read " << elf << endl;
+			return 1;
+		}
+		ElfFile elfFile(elf.c_str());
+		images[elf] = new ElfImage(&elfFile);
+	}
+
+	unsigned int threads = base.jobThreads > 0 ? base.jobThreads : thread::hardware_concurrency();
+	if(threads < 1)
+		threads = 1;
+	if(threads > jobs.size())
+		threads = jobs.size();
+	atomic<unsigned int> nextJob(0);
+	vector<thread> pool;
+	for(unsigned int t = 0; t < threads; t++){
+		pool.push_back(thread([&](){
+			unsigned int i;
+			while((i = nextJob++) < jobs.size())
+				runJob(&jobs[i], *images.find(jobs[i].config.elfFile)->second);
+		}));
+	}
+	for(unsigned int t = 0; t < pool.size(); t++)
+		pool[t].join();
+
+	int failed = 0;
+	for(unsigned int i = 0; i < jobs.size(); i++){
+		cout << "==== Run " << dec << i << ": " << jobs[i].name << endl;
+		cout << jobs[i].output << endl;
+		if(jobs[i].failed)
+			failed++;
+	}
+	cout << dec << jobs.size() << " runs on " << threads << " threads, " << failed << " failed" << endl;
+
+	for(map<string, ElfImage*>::iterator it = images.begin(); it != images.end(); it++)
+		delete it->second;
+	return failed == 0 ? 0 : 1;
+}
 
 int main(int argc, char** argv){
-	const char* binaryFile;
-	if(argc != 2)
-		binaryFile = "benchmarks/build/median.out";
-	else
-		binaryFile = argv[1];
+	SimulatorConfig config;
+	if(!parseArguments(&config, argc, argv))
+		return 1;
+	if(!config.jobFile.empty())
+		return runBatch(config);
 
 	cout  << hex;
-	Simulator sim(binaryFile);
-	sim.loadElfIntoDram();
-	sim.setPC();
-	
-	//debugging 
-	//sim.printMem();
-
-    CORE_INT(32)* dm_out = (CORE_INT(32) *)malloc(8192 * sizeof(CORE_INT(32)));
-    int ins = 1000000;
-	//cout << "pc start is: " << (int)sim.getPC() << endl;
-	
-    doStep(sim.getPC(),ins,sim.getICache(),sim.getDCache(),dm_out);
-    /*for(int i = 0;i<34;i++){ 
-    	std::cout << std::dec << i << " : ";
-    	std::cout << std::hex << debug_out[i] << std::endl;
-    }*/
-    //std::cout << "dm" <<std::endl;
-    //for(int i = 0;i<8192;i++){
-    //	   	std::cout << std::dec << i << " : ";
-    //    	std::cout << std::dec << dm_out[i] << std::endl;
-    // }
-    free(dm_out);
-	return 0;
+	ElfFile elfFile(config.elfFile.c_str());
+	ElfImage image(&elfFile);
+	Pipeline pipeline(config, image);
+	if(!pipeline.openCycleTrace(config))
+		return 1;
+
+	pipeline.run(config.cycles);
+	pipeline.writeReports();
+	return pipeline.hasDiverged() ? 1 : 0;
 }
@@ -9,10 +9,7 @@
 #include <sys/types.h>
 #include <map>
 #include <portability.h>
-
-std::map<CORE_INT(16), FILE*> fileMap;
-FILE **inStreams, **outStreams;
-int nbInStreams, nbOutStreams;
+#include <syscall.h>
 
 void stb(CORE_UINT(32) addr, CORE_INT(8) value){
 }
@@ -72,19 +69,19 @@ CORE_INT(32) ldd(CORE_UINT(32) addr){
 	return result;
 }
 
-CORE_UINT(32) doRead(CORE_UINT(32) file, CORE_UINT(32) bufferAddr, CORE_UINT(32) size){
+CORE_UINT(32) doRead(SyscallFiles* files, CORE_UINT(32) file, CORE_UINT(32) bufferAddr, CORE_UINT(32) size){
 	//printf("Doign read on file %x\n", file);
 	int localSize = size.SLC(32,0);
 	char* localBuffer = (char*) malloc(localSize*sizeof(char));
 	CORE_UINT(32) result;
 	if (file == 0){
-		if (nbInStreams == 1)
-			result = fread(localBuffer, 1, size, inStreams[0]);
+		if (files->nbInStreams == 1)
+			result = fread(localBuffer, 1, size, files->inStreams[0]);
 		else
 			result = fread(localBuffer, 1, size, stdin);
 	}
 	else{
-		FILE* localFile = fileMap[file.SLC(16,0)];
+		FILE* localFile = files->fileMap[file.SLC(16,0)];
 		result = fread(localBuffer, 1, size, localFile);
 		if (localFile == 0)
 			return -1;
@@ -95,22 +92,22 @@ CORE_UINT(32) doRead(CORE_UINT(32) file, CORE_UINT(32) bufferAddr, CORE_UINT(32)
 	return result;
 }
 
-CORE_UINT(32) doWrite(CORE_UINT(32) file, CORE_UINT(32) bufferAddr, CORE_UINT(32) size){
+CORE_UINT(32) doWrite(SyscallFiles* files, CORE_UINT(32) file, CORE_UINT(32) bufferAddr, CORE_UINT(32) size){
 	int localSize = size.SLC(32,0);
 	char* localBuffer = (char*) malloc(localSize*sizeof(char));
 	for (int i=0; i<size; i++)
 		localBuffer[i] = ldb(bufferAddr + i);
 	if (file < 5){
 		CORE_UINT(32) result = 0;
-		int streamNB = (int) file-nbInStreams;
-		if (nbOutStreams + nbInStreams > file)
-			result = fwrite(localBuffer, 1, size, outStreams[streamNB]);
+		int streamNB = (int) file-files->nbInStreams;
+		if (files->nbOutStreams + files->nbInStreams > file)
+			result = fwrite(localBuffer, 1, size, files->outStreams[streamNB]);
 		else
-			result = fwrite(localBuffer, 1, size, stdout);
+			result = fwrite(localBuffer, 1, size, files->output);
 		return result;
 	}
 	else{
-		FILE* localFile = fileMap[file.SLC(16,0)];
+		FILE* localFile = files->fileMap[file.SLC(16,0)];
 		if (localFile == 0)
 			return -1;
 		CORE_UINT(32) result = fwrite(localBuffer, 1, size, localFile);
@@ -118,7 +115,7 @@ CORE_UINT(32) doWrite(CORE_UINT(32) file, CORE_UINT(32) bufferAddr, CORE_UINT(32
 	}
 }
 
-CORE_UINT(32) doOpen(CORE_UINT(32) path, CORE_UINT(32) flags, CORE_UINT(32) mode){
+CORE_UINT(32) doOpen(SyscallFiles* files, CORE_UINT(32) path, CORE_UINT(32) flags, CORE_UINT(32) mode){
 	int oneStringElement = ldb(path);
 	int index = 0;
 	while (oneStringElement != 0){
@@ -150,7 +147,7 @@ CORE_UINT(32) doOpen(CORE_UINT(32) path, CORE_UINT(32) flags, CORE_UINT(32) mode
 	CORE_INT(32) returnedResult = 0;
 	returnedResult.SET_SLC(0, result_ac.SLC(15,0) ^ result_ac.SLC(15,16));
 	returnedResult[15] = 0;
-	fileMap[returnedResult.SLC(16,0)] = test;
+	files->fileMap[returnedResult.SLC(16,0)] = test;
 	return returnedResult;
 }
 
@@ -159,9 +156,9 @@ CORE_UINT(32) doOpenat(CORE_UINT(32) dir, CORE_UINT(32) path, CORE_UINT(32) flag
 	exit(-1);
 }
 
-CORE_UINT(32) doClose(CORE_UINT(32) file){
+CORE_UINT(32) doClose(SyscallFiles* files, CORE_UINT(32) file){
 	if (file > 2 ){
-		FILE* localFile = fileMap[file.SLC(16,0)];
+		FILE* localFile = files->fileMap[file.SLC(16,0)];
 		int result = fclose(localFile);
 		return result;
 	}
@@ -169,9 +166,9 @@ CORE_UINT(32) doClose(CORE_UINT(32) file){
 		return 0;
 }
 
-CORE_INT(32) doLseek(CORE_UINT(32) file, CORE_UINT(32) ptr, CORE_UINT(32) dir){
+CORE_INT(32) doLseek(SyscallFiles* files, CORE_UINT(32) file, CORE_UINT(32) ptr, CORE_UINT(32) dir){
 	if (file>2){
-		FILE* localFile = fileMap[file.SLC(16,0)];
+		FILE* localFile = files->fileMap[file.SLC(16,0)];
 		if (localFile == 0)
 			return -1;
 		int result = fseek(localFile, ptr, dir);
@@ -226,7 +223,7 @@ CORE_UINT(32) doUnlink(CORE_UINT(32) path){
 	return result;
 }
 
-CORE_UINT(32) solveSysCall(CORE_UINT(32) syscallId, CORE_UINT(32) arg1, CORE_UINT(32) arg2,
+CORE_UINT(32) solveSysCall(SyscallFiles* files, CORE_UINT(32) syscallId, CORE_UINT(32) arg1, CORE_UINT(32) arg2,
  CORE_UINT(32) arg3, CORE_UINT(32) arg4, CORE_UINT(2) *sys_status){
 	CORE_UINT(32) result = 0;
 	switch (syscallId){
@@ -234,25 +231,25 @@ CORE_UINT(32) solveSysCall(CORE_UINT(32) syscallId, CORE_UINT(32) arg1, CORE_UIN
 			*sys_status = 1; //Currently we break on ECALL
 			break;
 		case SYS_read:
-			result = doRead(arg1, arg2, arg3);
+			result = doRead(files, arg1, arg2, arg3);
 			break;
 		case SYS_write:
-			result = doWrite(arg1, arg2, arg3);
+			result = doWrite(files, arg1, arg2, arg3);
 			break;
 		case SYS_brk:
 			result = doSbrk(arg1);
 			break;
 		case SYS_open:
-			result = doOpen(arg1, arg2, arg3);
+			result = doOpen(files, arg1, arg2, arg3);
 			break;
 		case SYS_openat:
 			result = doOpenat(arg1, arg2, arg3, arg4);
 			break;
 		case SYS_lseek:
-			result = doLseek(arg1, arg2, arg3);
+			result = doLseek(files, arg1, arg2, arg3);
 			break;
 		case SYS_close:
-			result = doClose(arg1);
+			result = doClose(files, arg1);
 			break;
 		case SYS_fstat:
 			result = 0;
@@ -11,6 +11,14 @@
 #ifndef __NIOS
 
 #include <map>
+#include <string>
+#include <stdio.h>
+#include <stdint.h>
+#include <setjmp.h>
+
+class StackDistance;
+class MemoryTraceWriter;
+class BranchTraceWriter;
 
 /*********************************************************
  *    Definition of system calls IDs
@@ -60,6 +68,32 @@
 #define SYS_getdents 61
 #define SYS_dup 23
 
+/*********************************************************
+ * Size of the flat guest memory and of the guard area
+ * placed after it. Accesses spilling past 4GB land in the
+ * guard area and are reported as out of range.
+ *********************************************************/
+#define FLAT_MEMORY_SIZE 0x100000000ULL
+#define FLAT_MEMORY_GUARD 0x10000ULL
+
+/*********************************************************
+ * Stores are watched at a 4KB page granularity so that
+ * simulators keeping pre-decoded instructions can drop
+ * them when the code is modified.
+ *********************************************************/
+#define CODE_PAGEBITS 12
+#define CODE_PAGES 0x100000
+
+/*********************************************************
+ * Why a simulation stopped before its instruction budget.
+ * The simulators never exit the process: they stop, keep
+ * the error and its message, and let their user decide.
+ *********************************************************/
+#define SIM_ERROR_NONE 0
+#define SIM_ERROR_ILLEGAL_INSTRUCTION 1
+#define SIM_ERROR_SYSCALL 2
+#define SIM_ERROR_MEMORY 3
+
 /*********************************************************
  * 	Definition of the GenericSimulator class
  *
@@ -72,16 +106,64 @@
 class GenericSimulator {
 public:
 
-GenericSimulator(void) : memory(){this->debugLevel = 0;};
+GenericSimulator(void) : memory(){this->debugLevel = 0; this->flatMemory = NULL; this->codePages = NULL; this->reuse = NULL; this->trace = NULL; this->branches = NULL;
+	this->inStreams = NULL; this->outStreams = NULL; this->nbInStreams = 0; this->nbOutStreams = 0; this->heapAddress = 0;
+	this->programInput = stdin; this->programOutput = stdout;};
+virtual ~GenericSimulator(void);
 
 int debugLevel = 0;
 int stop = 0;
 
+//Set with stop when the simulation cannot go on, see SIM_ERROR_*
+int error = SIM_ERROR_NONE;
+std::string errorMessage;
+int exitStatus = 0; //Given by the program to SYS_exit
+void fail(int error, const char* format, ...);
+
+//Several simulators run at once from different threads: an access past the flat
+//memory of the one running on this thread jumps back to faultTarget, set by its run loop
+static thread_local GenericSimulator* running;
+sigjmp_buf faultTarget;
+unsigned long long faultOffset;
+
 std::map<ac_int<64, false>, ac_int<8, true> > memory;
-ac_int<32, true> REG[64];
+
+//Flat guest memory for RV32 binaries: the whole 4GB address space is reserved
+//with MAP_NORESERVE and backed on demand by the host. When it is NULL, the
+//std::map above is used instead.
+unsigned char* flatMemory;
+bool useFlatMemory();
+
+int32_t REG[64];
 float regf[64];
 void initialize(int argc, char* argv[]);
 
+//One flag per 4KB page of the 32-bit address space, set when the page holds
+//pre-decoded instructions. NULL when the simulator does not pre-decode.
+unsigned char* codePages;
+virtual void invalidateCode(unsigned int page){};
+
+inline void checkCodeStore(unsigned int addr, int size){
+	unsigned int firstPage = addr >> CODE_PAGEBITS;
+	unsigned int lastPage = (addr + size - 1) >> CODE_PAGEBITS;
+	if (this->codePages[firstPage])
+		this->invalidateCode(firstPage);
+	if (lastPage != firstPage && this->codePages[lastPage])
+		this->invalidateCode(lastPage);
+}
+
+
+//Stack distance analysis of the loads and stores of the program, NULL when
+//disabled. Owned by the caller.
+StackDistance* reuse;
+
+//Binary trace of the fetches, loads and stores of the program, NULL when
+//disabled. Owned by the caller.
+MemoryTraceWriter* trace;
+
+//Trace of the control instructions and of their outcome, NULL when disabled.
+//Owned by the caller.
+BranchTraceWriter* branches;
 
 //********************************************************
 //Memory interfaces
@@ -96,6 +178,10 @@ ac_int<16, true> ldh(ac_int<64, false> addr);
 ac_int<32, true> ldw(ac_int<64, false> addr);
 ac_int<64, true> ldd(ac_int<64, false> addr);
 
+//Copies between the guest memory and the host
+void readMemory(uint32_t addr, void* buffer, uint32_t size);
+void writeMemory(uint32_t addr, const void* buffer, uint32_t size);
+
 //********************************************************
 //System calls
 
@@ -104,6 +190,11 @@ FILE **inStreams, **outStreams;
 int nbInStreams, nbOutStreams;
 unsigned int heapAddress;
 
+//Standard input and output of the program when -i and -o do not redirect them. A NULL
+//input reads as an empty file.
+FILE* programInput;
+FILE* programOutput;
+
 ac_int<64, false> solveSyscall(ac_int<64, false> syscallId, ac_int<64, false> arg1, ac_int<64, false> arg2, ac_int<64, false> arg3, ac_int<64, false> arg4);
 
 ac_int<64, false> doRead(ac_int<64, false> file, ac_int<64, false> bufferAddr, ac_int<64, false> size);
@@ -0,0 +1,119 @@
+/*
+ * riscvJit.h
+ *
+ * Translation of hot RV32IM basic blocks to x86-64 host code.
+ */
+
+#ifndef INCLUDES_SIMULATOR_RISCVJIT_H_
+#define INCLUDES_SIMULATOR_RISCVJIT_H_
+
+#ifndef __NIOS
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+
+class RiscvSimulator;
+struct DecodedInstruction;
+
+/*********************************************************
+ * 	Dynamic binary translation tier
+ *
+ * 	The interpreter counts how many times each basic block
+ * 	is entered. Once a block reaches JIT_HOT_THRESHOLD it is
+ * 	translated into the code cache, as a straight sequence
+ * 	of host instructions working on the REG array and on the
+ * 	flat guest memory. Blocks stop at the first control flow
+ * 	instruction, at the end of the 4KB code page or before
+ * 	any instruction which is not translated (system calls,
+ * 	floating point...): those are left to the interpreter.
+ *
+ * 	Direct exits are chained to the translated successor
+ * 	once it exists, indirect jumps look the target up. Each
+ * 	block entry checks the instruction budget so that
+ * 	n_inst stops at the same value as with the interpreter.
+ *
+ * 	When the simulator runs in verbose mode, the translated
+ * 	code calls back into the simulator to print the same
+ * 	per-instruction trace as the interpreter, so that both
+ * 	can be compared line by line.
+ *
+ * 	A store to a page holding translated code flushes the
+ * 	whole code cache.
+ *
+ *********************************************************/
+
+#define JIT_HOT_THRESHOLD 16
+#define JIT_CODECACHE_SIZE 0x1000000 //16MB of host code
+#define JIT_MAX_BLOCK_INSTRUCTIONS 64
+#define JIT_MAX_BLOCK_BYTES 0x4000 //Bound on the host code of a single block
+
+class RiscvJit{
+public:
+	RiscvJit(RiscvSimulator* simulator);
+	~RiscvJit(void);
+
+	//False when the code cache could not be allocated or the host is not x86-64
+	bool isAvailable();
+
+	//Translates the block starting at address, returns the entry point or NULL
+	void* translate(uint32_t address);
+
+	//Runs translated code until it exits back to the interpreter
+	void execute(void* block);
+
+	//Entry point of the block at address, or the return to the interpreter
+	void* lookup(uint32_t address);
+
+	//True if the instruction can be part of a translated block
+	static bool isTranslated(const DecodedInstruction* decoded);
+
+	void invalidatePage(unsigned int page);
+	void flush();
+
+	unsigned int translatedBlocks;
+	unsigned int flushes;
+
+private:
+	RiscvSimulator* simulator;
+
+	unsigned char* codeCache;
+	unsigned char* current;
+	unsigned char* blocksStart;
+	unsigned char* epilogue;
+	void (*enter)(RiscvSimulator*, void*);
+
+	//One flag per 4KB guest page holding translated code
+	unsigned char* translatedPages;
+	std::vector<uint32_t> blockAddresses;
+
+	//Exits waiting for their target to be translated: address of the rel32 to patch
+	std::unordered_map<uint32_t, std::vector<unsigned char*> > pendingLinks;
+
+	int pcOffset, nInstOffset, limitOffset;
+	bool tracing;
+
+	void emit8(uint8_t value);
+	void emit32(uint32_t value);
+	void emit64(uint64_t value);
+	void emitBytes(const char* bytes, int size);
+	void emitLoadReg(int hostReg, int guestReg);
+	void emitStoreReg(int hostReg, int guestReg);
+	void emitSimulatorAccess(uint8_t rex, uint8_t opcode, int hostReg, int offset);
+	void emitCall(void* function);
+	void emitJump(unsigned char* target);
+	void patchRel32(unsigned char* site, unsigned char* target);
+
+	void emitPrologue(uint32_t address, int size);
+	void emitTraceRegisters();
+	void emitExit(uint32_t target);
+	void emitIndirectExit();
+	void emitEarlyExit(uint32_t nextAddress, int remaining);
+	void emitStoreCheck(uint32_t address, int size, int remaining);
+	bool emitInstruction(uint32_t address, const DecodedInstruction* decoded, int remaining);
+	void generateTrampoline();
+};
+
+#endif
+
+#endif /* INCLUDES_SIMULATOR_RISCVJIT_H_ */
@@ -14,18 +14,94 @@
 #include <map>
 #include <unordered_map>
 #include <string>
+#include <stdint.h>
 #include <types.h>
 #include <simulator/genericSimulator.h>
+#include <simulator/riscvJit.h>
+
+class RiscvSimulator;
+class ElfImage;
+
+//What run returns
+#define SIM_RUNNING 0 //The instruction budget is spent, run can be called again
+#define SIM_EXITED 1 //The program called exit, see exitStatus
+#define SIM_ERROR 2 //See error and errorMessage
+
+/*********************************************************
+ * 	Pre-decoded instructions
+ *
+ * 	An instruction is decoded the first time it is executed
+ * 	into the handler performing the operation and its
+ * 	register indexes and sign-extended immediate. Decoded
+ * 	instructions are kept per 4KB page of code, through a
+ * 	two-level table indexed by the PC. A store into such a
+ * 	page drops all the decoded instructions of that page.
+ *
+ *********************************************************/
+
+struct DecodedInstruction;
+typedef void (*InstructionHandler)(RiscvSimulator* simulator, const DecodedInstruction* decoded);
+
+struct DecodedInstruction{
+	InstructionHandler handler; //NULL when the slot has not been decoded yet
+	uint32_t instruction;
+	int32_t imm;
+	uint8_t rd;
+	uint8_t rs1;
+	uint8_t rs2;
+	uint8_t rs3;
+	uint8_t funct3;
+	uint8_t funct7;
+	void* block; //Translated code starting at this instruction, see riscvJit.h
+	uint32_t executions; //Number of times a block started at this instruction
+};
+
+#define DECODED_PAGEINSTRUCTIONS 1024 // (1 << CODE_PAGEBITS) / 4
+#define DECODED_TABLEENTRIES 1024
+#define DECODED_TABLEBITS 10 // (32 - CODE_PAGEBITS) / 2
 
 class RiscvSimulator : public GenericSimulator{
 	public:
-	ac_int<64, true> pc;
+	uint32_t pc;
 	uint64_t n_inst;
 	uint64_t function_counter;
-	RiscvSimulator(void) : GenericSimulator(){};
+	RiscvSimulator(void);
+	~RiscvSimulator(void);
 	int doSimulation(int nbCycles);
 
+	/*********************************************************
+	 * 	Embedding the simulator
+	 *
+	 * 	Instances share no state and each one can run on its
+	 * 	own thread. load puts the sections of an image in
+	 * 	memory, argc and argv on the stack and points the PC
+	 * 	to _start; the image is only read, so one image serves
+	 * 	any number of instances. run executes at most the given
+	 * 	number of instructions, counted in n_inst, and can be
+	 * 	called again to continue. The guest memory is reached
+	 * 	with readMemory and writeMemory.
+	 *********************************************************/
+	void load(const ElfImage& image, int argc, char** argv);
+	int run(uint64_t instructions);
+	int32_t getRegister(int index);
+	void setRegister(int index, int32_t value); //Writes to x0 are ignored
+
 	void doStep();
+
+	DecodedInstruction** decodedPages[DECODED_TABLEENTRIES];
+	DecodedInstruction* getDecodedInstruction(uint32_t address);
+	DecodedInstruction* probeDecodedInstruction(uint32_t address); //NULL when not decoded yet
+	void decode(uint32_t ins, DecodedInstruction* decoded);
+	void invalidateCode(unsigned int page);
+
+	void traceInstruction(uint32_t address, uint32_t ins);
+	void traceRegisters();
+
+	//Translation of hot blocks, NULL when only the interpreter is used
+	RiscvJit* jit;
+	bool jitBlockStart;
+	uint64_t jitLimit;
+	bool enableJit();
 };
 
 #endif
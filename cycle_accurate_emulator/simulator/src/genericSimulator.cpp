@@ -15,6 +15,73 @@
 #include <types.h>
 #include <simulator/genericSimulator.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <sys/mman.h>
+
+thread_local GenericSimulator* GenericSimulator::running = NULL;
+
+static void flatMemoryFaultHandler(int sig, siginfo_t* info, void* context){
+	GenericSimulator* simulator = GenericSimulator::running;
+	unsigned char* faultAddress = (unsigned char*) info->si_addr;
+	if (simulator != NULL && simulator->flatMemory != NULL){
+		unsigned char* guardStart = simulator->flatMemory + FLAT_MEMORY_SIZE;
+		if (faultAddress >= guardStart && faultAddress < guardStart + FLAT_MEMORY_GUARD){
+			//The run loop reports the error, SA_NODEFER leaves the signal unblocked after the jump
+			simulator->faultOffset = faultAddress - guardStart;
+			siglongjmp(simulator->faultTarget, 1);
+		}
+	}
+	//Not ours: restore the default action, the fault will be raised again
+	signal(sig, SIG_DFL);
+}
+
+void GenericSimulator::fail(int error, const char* format, ...){
+	char message[256];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+
+	this->error = error;
+	this->errorMessage = message;
+	this->stop = 1;
+}
+
+GenericSimulator::~GenericSimulator(void){
+	if (this->flatMemory != NULL)
+		munmap(this->flatMemory, FLAT_MEMORY_SIZE + FLAT_MEMORY_GUARD);
+	free(this->codePages);
+}
+
+bool GenericSimulator::useFlatMemory(){
+	//We reserve 4GB of address space plus a guard area. Nothing is committed until touched.
+	void* area = mmap(NULL, FLAT_MEMORY_SIZE + FLAT_MEMORY_GUARD, PROT_NONE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (area == MAP_FAILED)
+		return false;
+
+	if (mprotect(area, FLAT_MEMORY_SIZE, PROT_READ | PROT_WRITE) != 0){
+		munmap(area, FLAT_MEMORY_SIZE + FLAT_MEMORY_GUARD);
+		return false;
+	}
+
+	this->flatMemory = (unsigned char*) area;
+
+	//Content already written in the sparse memory is moved into the flat one
+	for (std::map<ac_int<64, false>, ac_int<8, true> >::iterator it = this->memory.begin(); it != this->memory.end(); it++)
+		this->flatMemory[it->first.slc<32>(0).to_uint()] = it->second.to_int();
+	this->memory.clear();
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_sigaction = flatMemoryFaultHandler;
+	action.sa_flags = SA_SIGINFO | SA_NODEFER;
+	sigaction(SIGSEGV, &action, NULL);
+
+	return true;
+}
 
 void GenericSimulator::initialize(int argc, char** argv){
 
@@ -54,17 +121,37 @@ void GenericSimulator::initialize(int argc, char** argv){
 
 
 void GenericSimulator::stb(ac_int<64, false> addr, ac_int<8, true> value){
-	this->memory[addr] = value & 0xff;
+	if (this->flatMemory != NULL)
+		this->flatMemory[addr.slc<32>(0).to_uint()] = value.to_int();
+	else
+		this->memory[addr] = value & 0xff;
+
+	if (this->codePages != NULL)
+		this->checkCodeStore(addr.slc<32>(0).to_uint(), 1);
 }
 
 
 
 void GenericSimulator::sth(ac_int<64, false> addr, ac_int<16, true> value){
+	if (this->flatMemory != NULL){
+		int16_t hostValue = value.to_int();
+		memcpy(this->flatMemory + addr.slc<32>(0).to_uint(), &hostValue, 2);
+		if (this->codePages != NULL)
+			this->checkCodeStore(addr.slc<32>(0).to_uint(), 2);
+		return;
+	}
 	this->stb(addr+1, value.slc<8>(8));
 	this->stb(addr+0, value.slc<8>(0));
 }
 
 void GenericSimulator::stw(ac_int<64, false> addr, ac_int<32, true> value){
+	if (this->flatMemory != NULL){
+		int32_t hostValue = value.to_int();
+		memcpy(this->flatMemory + addr.slc<32>(0).to_uint(), &hostValue, 4);
+		if (this->codePages != NULL)
+			this->checkCodeStore(addr.slc<32>(0).to_uint(), 4);
+		return;
+	}
 	this->stb(addr+3, value.slc<8>(24));
 	this->stb(addr+2, value.slc<8>(16));
 	this->stb(addr+1, value.slc<8>(8));
@@ -73,6 +160,13 @@ void GenericSimulator::stw(ac_int<64, false> addr, ac_int<32, true> value){
 }
 
 void GenericSimulator::std(ac_int<64, false> addr, ac_int<64, true> value){
+	if (this->flatMemory != NULL){
+		int64_t hostValue = value.to_int64();
+		memcpy(this->flatMemory + addr.slc<32>(0).to_uint(), &hostValue, 8);
+		if (this->codePages != NULL)
+			this->checkCodeStore(addr.slc<32>(0).to_uint(), 8);
+		return;
+	}
 	this->stb(addr+7, value.slc<8>(56));
 	this->stb(addr+6, value.slc<8>(48));
 	this->stb(addr+5, value.slc<8>(40));
@@ -86,9 +180,13 @@ void GenericSimulator::std(ac_int<64, false> addr, ac_int<64, true> value){
 
 ac_int<8, true> GenericSimulator::ldb(ac_int<64, false> addr){
 
+	if (this->flatMemory != NULL)
+		return (signed char) this->flatMemory[addr.slc<32>(0).to_uint()];
+
 	ac_int<8, true> result = 0;
-	if (this->memory.find(addr) != this->memory.end())
-		result = this->memory[addr];
+	std::map<ac_int<64, false>, ac_int<8, true> >::iterator it = this->memory.find(addr);
+	if (it != this->memory.end())
+		result = it->second;
 	else
 		result= 0;
 
@@ -100,6 +198,12 @@ ac_int<8, true> GenericSimulator::ldb(ac_int<64, false> addr){
 //Little endian version
 ac_int<16, true> GenericSimulator::ldh(ac_int<64, false> addr){
 
+	if (this->flatMemory != NULL){
+		int16_t hostValue;
+		memcpy(&hostValue, this->flatMemory + addr.slc<32>(0).to_uint(), 2);
+		return hostValue;
+	}
+
 	ac_int<16, true> result = 0;
 	result.set_slc(8, this->ldb(addr+1));
 	result.set_slc(0, this->ldb(addr));
@@ -108,6 +212,12 @@ ac_int<16, true> GenericSimulator::ldh(ac_int<64, false> addr){
 
 ac_int<32, true> GenericSimulator::ldw(ac_int<64, false> addr){
 
+	if (this->flatMemory != NULL){
+		int32_t hostValue;
+		memcpy(&hostValue, this->flatMemory + addr.slc<32>(0).to_uint(), 4);
+		return hostValue;
+	}
+
 	ac_int<32, true> result = 0;
 	result.set_slc(24, this->ldb(addr+3));
 	result.set_slc(16, this->ldb(addr+2));
@@ -118,6 +228,12 @@ ac_int<32, true> GenericSimulator::ldw(ac_int<64, false> addr){
 
 ac_int<64, true> GenericSimulator::ldd(ac_int<64, false> addr){
 
+	if (this->flatMemory != NULL){
+		int64_t hostValue;
+		memcpy(&hostValue, this->flatMemory + addr.slc<32>(0).to_uint(), 8);
+		return hostValue;
+	}
+
 	ac_int<64, true> result = 0;
 	result.set_slc(56, this->ldb(addr+7));
 	result.set_slc(48, this->ldb(addr+6));
@@ -135,11 +251,36 @@ ac_int<64, true> GenericSimulator::ldd(ac_int<64, false> addr){
 
 
 
+void GenericSimulator::readMemory(uint32_t addr, void* buffer, uint32_t size){
+	if (this->flatMemory != NULL && (uint64_t) addr + size <= FLAT_MEMORY_SIZE){
+		memcpy(buffer, this->flatMemory + addr, size);
+		return;
+	}
+	for (uint32_t i = 0; i < size; i++)
+		((unsigned char*) buffer)[i] = this->ldb(addr + i).to_int();
+}
+
+void GenericSimulator::writeMemory(uint32_t addr, const void* buffer, uint32_t size){
+	if (size == 0)
+		return;
+	if (this->flatMemory != NULL && (uint64_t) addr + size <= FLAT_MEMORY_SIZE){
+		memcpy(this->flatMemory + addr, buffer, size);
+		if (this->codePages != NULL)
+			for (unsigned int page = addr >> CODE_PAGEBITS; page <= (addr + size - 1) >> CODE_PAGEBITS; page++)
+				if (this->codePages[page])
+					this->invalidateCode(page);
+		return;
+	}
+	for (uint32_t i = 0; i < size; i++)
+		this->stb(addr + i, ((const signed char*) buffer)[i]);
+}
+
 ac_int<64, false> GenericSimulator::solveSyscall(ac_int<64, false> syscallId, ac_int<64, false> arg1, ac_int<64, false> arg2, ac_int<64, false> arg3, ac_int<64, false> arg4){
 	ac_int<64, false> result = 0;
 	switch (syscallId){
 		case SYS_exit:
 			stop = 1; //Currently we break on ECALL
+			exitStatus = arg1.slc<32>(0).to_int();
 		break;
 		case SYS_read:
 			result = this->doRead(arg1, arg2, arg3);
@@ -175,8 +316,7 @@ ac_int<64, false> GenericSimulator::solveSyscall(ac_int<64, false> syscallId, ac
 			result = this->doUnlink(arg1);
 		break;
 		default:
-			printf("Unknown syscall with code %d\n", syscallId.slc<32>(0));
-			exit(-1);
+			this->fail(SIM_ERROR_SYSCALL, "Unknown syscall with code %d", syscallId.slc<32>(0).to_int());
 		break;
 		}
 	return result;
@@ -193,20 +333,25 @@ ac_int<64, false> GenericSimulator::doRead(ac_int<64, false> file, ac_int<64, fa
 	if (file == 0){
 		if (nbInStreams == 1)
 			result = fread(localBuffer, 1, size, inStreams[0]);
+		else if (programInput != NULL)
+			result = fread(localBuffer, 1, size, programInput);
 		else
-			result = fread(localBuffer, 1, size, stdin);
+			result = 0;
 	}
 	else{
 		FILE* localFile = this->fileMap[file.slc<16>(0)];
-		result = fread(localBuffer, 1, size, localFile);
-		if (localFile == 0)
+		if (localFile == 0){
+			free(localBuffer);
 			return -1;
+		}
+		result = fread(localBuffer, 1, size, localFile);
 	}
 
 	for (int i=0; i<result; i++){
 		this->stb(bufferAddr + i, localBuffer[i]);
 	}
 
+	free(localBuffer);
 	return result;
 }
 
@@ -217,24 +362,24 @@ ac_int<64, false> GenericSimulator::doWrite(ac_int<64, false> file, ac_int<64, f
 	for (int i=0; i<size; i++)
 		localBuffer[i] = this->ldb(bufferAddr + i);
 
+	ac_int<64, false> result = 0;
 	if (file < 5){
-		ac_int<64, false> result = 0;
 		int streamNB = (int) file-nbInStreams;
 		if (nbOutStreams + nbInStreams > file)
 			result = fwrite(localBuffer, 1, size, outStreams[streamNB]);
 		else
-			result = fwrite(localBuffer, 1, size, stdout);
-		return result;
+			result = fwrite(localBuffer, 1, size, programOutput);
 	}
 	else{
 
 		FILE* localFile = this->fileMap[file.slc<16>(0)];
 		if (localFile == 0)
-			return -1;
-
-		ac_int<64, false> result = fwrite(localBuffer, 1, size, localFile);
-		return result;
+			result = -1;
+		else
+			result = fwrite(localBuffer, 1, size, localFile);
 	}
+	free(localBuffer);
+	return result;
 }
 
 
@@ -262,11 +407,13 @@ ac_int<64, false> GenericSimulator::doOpen(ac_int<64, false> path, ac_int<64, fa
 	else if (flags == O_WRONLY|O_CREAT|O_EXCL)
 		localMode = "wx";
 	else{
-		fprintf(stderr, "Trying to open files with unknown flags... %d\n", flags);
-		exit(-1);
+		free(localPath);
+		this->fail(SIM_ERROR_SYSCALL, "Trying to open files with unknown flags... %d", flags.slc<32>(0).to_int());
+		return -1;
 	}
 
 	FILE* test = fopen(localPath, localMode);
+	free(localPath);
 	uint64_t result = (uint64_t) test;
 	ac_int<64, true> result_ac = result;
 
@@ -286,8 +433,8 @@ ac_int<64, false> GenericSimulator::doOpen(ac_int<64, false> path, ac_int<64, fa
 }
 
 ac_int<64, false> GenericSimulator::doOpenat(ac_int<64, false> dir, ac_int<64, false> path, ac_int<64, false> flags, ac_int<64, false> mode){
-	fprintf(stderr, "Syscall openat not implemented yet...\n");
-	exit(-1);
+	this->fail(SIM_ERROR_SYSCALL, "Syscall openat not implemented yet...");
+	return -1;
 }
 
 ac_int<64, false> GenericSimulator::doClose(ac_int<64, false> file){
@@ -329,6 +476,7 @@ ac_int<64, false> GenericSimulator::doStat(ac_int<64, false> filename, ac_int<64
 
 	struct stat fileStat;
 	int result = stat(localPath, &fileStat);
+	free(localPath);
 
 	//We copy the result in simulator memory
 	for (int oneChar = 0; oneChar<sizeof(struct stat); oneChar++)
@@ -348,9 +496,8 @@ ac_int<64, false> GenericSimulator::doSbrk(ac_int<64, false> value){
 }
 
 ac_int<64, false> GenericSimulator::doGettimeofday(ac_int<64, false> timeValPtr){
-	timeval* oneTimeVal;
-	struct timezone* oneTimeZone;
-	int result = gettimeofday(oneTimeVal, oneTimeZone);
+	timeval oneTimeVal;
+	int result = gettimeofday(&oneTimeVal, NULL);
 
 //	this->std(timeValPtr, oneTimeVal->tv_sec);
 //	this->std(timeValPtr+8, oneTimeVal->tv_usec);
@@ -376,6 +523,7 @@ ac_int<64, false> GenericSimulator::doUnlink(ac_int<64, false> path){
 
 
 	int result = unlink(localPath);
+	free(localPath);
 
 	return result;
 
@@ -0,0 +1,651 @@
+/*
+ * riscvJit.cpp
+ *
+ * Translation of hot RV32IM basic blocks to x86-64 host code.
+ *
+ * Host register usage inside translated code:
+ * 	rbx	address of REG[0]
+ * 	r12	base of the flat guest memory
+ * 	r13	code page flags of the simulator
+ * 	r14	the simulator
+ * 	rax, rcx, rdx, rsi, rdi, r8	scratch, nothing is kept across guest instructions
+ */
+
+#ifndef __NIOS
+
+#include <isa/riscvISA.h>
+#include <simulator/riscvSimulator.h>
+#include <simulator/riscvJit.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define HOST_EAX 0
+#define HOST_ECX 1
+#define HOST_EDX 2
+
+//******************************************************************************************
+//Functions called from the translated code
+
+static void* jitLookup(RiscvSimulator* simulator){
+	return simulator->jit->lookup(simulator->pc);
+}
+
+static void jitCodeStore(RiscvSimulator* simulator, uint32_t address, int size){
+	simulator->checkCodeStore(address, size);
+}
+
+static void jitTraceInstruction(RiscvSimulator* simulator, uint32_t address, uint32_t instruction){
+	simulator->traceInstruction(address, instruction);
+}
+
+static void jitTraceRegisters(RiscvSimulator* simulator){
+	simulator->n_inst = simulator->n_inst + 1;
+	simulator->traceRegisters();
+}
+
+//******************************************************************************************
+
+RiscvJit::RiscvJit(RiscvSimulator* simulator){
+	this->simulator = simulator;
+	this->translatedBlocks = 0;
+	this->flushes = 0;
+	this->codeCache = NULL;
+	this->translatedPages = NULL;
+	this->tracing = simulator->debugLevel > 1;
+
+	this->pcOffset = (char*) &(simulator->pc) - (char*) simulator;
+	this->nInstOffset = (char*) &(simulator->n_inst) - (char*) simulator;
+	this->limitOffset = (char*) &(simulator->jitLimit) - (char*) simulator;
+
+#if defined(__x86_64__)
+	void* area = mmap(NULL, JIT_CODECACHE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (area == MAP_FAILED)
+		return;
+
+	this->codeCache = (unsigned char*) area;
+	this->translatedPages = (unsigned char*) calloc(CODE_PAGES, sizeof(unsigned char));
+	this->generateTrampoline();
+#endif
+}
+
+RiscvJit::~RiscvJit(void){
+	if (this->codeCache != NULL)
+		munmap(this->codeCache, JIT_CODECACHE_SIZE);
+	free(this->translatedPages);
+}
+
+bool RiscvJit::isAvailable(){
+	return this->codeCache != NULL;
+}
+
+void RiscvJit::execute(void* block){
+	this->enter(this->simulator, block);
+}
+
+void* RiscvJit::lookup(uint32_t address){
+	if (address & 0x3)
+		return this->epilogue;
+
+	DecodedInstruction* decoded = this->simulator->probeDecodedInstruction(address);
+	if (decoded == NULL || decoded->block == NULL)
+		return this->epilogue;
+	return decoded->block;
+}
+
+void RiscvJit::invalidatePage(unsigned int page){
+	if (this->translatedPages != NULL && this->translatedPages[page])
+		this->flush();
+}
+
+void RiscvJit::flush(){
+	for (unsigned int i=0; i<blockAddresses.size(); i++){
+		DecodedInstruction* decoded = this->simulator->probeDecodedInstruction(blockAddresses[i]);
+		if (decoded != NULL){
+			decoded->block = NULL;
+			decoded->executions = 0;
+		}
+		this->translatedPages[blockAddresses[i] >> CODE_PAGEBITS] = 0;
+	}
+	this->blockAddresses.clear();
+	this->pendingLinks.clear();
+	this->current = this->blocksStart;
+	this->flushes++;
+}
+
+//******************************************************************************************
+//Instructions which are left to the interpreter end the block before them
+
+bool RiscvJit::isTranslated(const DecodedInstruction* decoded){
+	uint32_t ins = decoded->instruction;
+	uint8_t funct3 = decoded->funct3;
+	uint8_t funct7 = decoded->funct7;
+
+	switch (ins & 0x7f)
+	{
+	case RISCV_LUI:
+	case RISCV_AUIPC:
+	case RISCV_JAL:
+	case RISCV_JALR:
+	case RISCV_OPI:
+		return true;
+	case RISCV_OP:
+		return funct7 != 1 || funct3 < RISCV_OP_M_DIV; //Division is left to the interpreter, which checks its operands
+	case RISCV_BR:
+		return funct3 != 2 && funct3 != 3;
+	case RISCV_LD:
+		return funct3 != 7;
+	case RISCV_ST:
+		return funct3 < 4;
+	case RISCV_OPIW:
+		return funct3 == RISCV_OPIW_ADDIW || funct3 == RISCV_OPIW_SLLIW || funct3 == RISCV_OPIW_SRW;
+	case RISCV_OPW:
+		if (funct7 == 1)
+			return funct3 < RISCV_OP_M_DIV;
+		return funct3 == RISCV_OPW_ADDSUBW || funct3 == RISCV_OPW_SLLW
+				|| (funct3 == RISCV_OPW_SRW && funct7 == RISCV_OPW_SRW_SRLW);
+	default:
+		return false;
+	}
+}
+
+static bool isControlFlow(const DecodedInstruction* decoded){
+	uint32_t opcode = decoded->instruction & 0x7f;
+	return opcode == RISCV_BR || opcode == RISCV_JAL || opcode == RISCV_JALR;
+}
+
+//******************************************************************************************
+//Host code emission
+
+void RiscvJit::emit8(uint8_t value){
+	*(this->current++) = value;
+}
+
+void RiscvJit::emit32(uint32_t value){
+	memcpy(this->current, &value, 4);
+	this->current += 4;
+}
+
+void RiscvJit::emit64(uint64_t value){
+	memcpy(this->current, &value, 8);
+	this->current += 8;
+}
+
+void RiscvJit::emitBytes(const char* bytes, int size){
+	memcpy(this->current, bytes, size);
+	this->current += size;
+}
+
+//mov host, dword [rbx + 4*guest]
+void RiscvJit::emitLoadReg(int hostReg, int guestReg){
+	emit8(0x8b);
+	emit8(0x43 | (hostReg << 3));
+	emit8(guestReg * 4);
+}
+
+//mov dword [rbx + 4*guest], host. Writes to x0 are dropped.
+void RiscvJit::emitStoreReg(int hostReg, int guestReg){
+	if (guestReg == 0)
+		return;
+	emit8(0x89);
+	emit8(0x43 | (hostReg << 3));
+	emit8(guestReg * 4);
+}
+
+//Instruction with a [r14 + offset] operand
+void RiscvJit::emitSimulatorAccess(uint8_t rex, uint8_t opcode, int hostReg, int offset){
+	emit8(rex);
+	emit8(opcode);
+	emit8(0x86 | (hostReg << 3));
+	emit32(offset);
+}
+
+//mov rdi, r14 is done by the caller when arguments are needed
+void RiscvJit::emitCall(void* function){
+	emit8(0x48); emit8(0xb8); emit64((uint64_t) function);		//mov rax, function
+	emit8(0xff); emit8(0xd0);									//call rax
+}
+
+void RiscvJit::patchRel32(unsigned char* site, unsigned char* target){
+	int32_t displacement = target - (site + 4);
+	memcpy(site, &displacement, 4);
+}
+
+void RiscvJit::emitJump(unsigned char* target){
+	emit8(0xe9);
+	emit32(0);
+	patchRel32(this->current - 4, target);
+}
+
+static const char movRdiR14[] = {0x4c, (char) 0x89, (char) 0xf7};
+
+void RiscvJit::generateTrampoline(){
+	this->current = this->codeCache;
+
+	this->enter = (void (*)(RiscvSimulator*, void*)) this->current;
+	emit8(0x53);												//push rbx
+	emit8(0x55);												//push rbp
+	emit8(0x41); emit8(0x54);									//push r12
+	emit8(0x41); emit8(0x55);									//push r13
+	emit8(0x41); emit8(0x56);									//push r14
+	emit8(0x41); emit8(0x57);									//push r15
+	emit8(0x48); emit8(0x83); emit8(0xec); emit8(0x08);			//sub rsp, 8 (keeps calls aligned)
+	emit8(0x49); emit8(0x89); emit8(0xfe);						//mov r14, rdi
+	emit8(0x48); emit8(0x8d); emit8(0x9f);						//lea rbx, [rdi + REG]
+	emit32((char*) &(simulator->REG[0]) - (char*) simulator);
+	emit8(0x4c); emit8(0x8b); emit8(0xa7);						//mov r12, [rdi + flatMemory]
+	emit32((char*) &(simulator->flatMemory) - (char*) simulator);
+	emit8(0x4c); emit8(0x8b); emit8(0xaf);						//mov r13, [rdi + codePages]
+	emit32((char*) &(simulator->codePages) - (char*) simulator);
+	emit8(0xff); emit8(0xe6);									//jmp rsi
+
+	this->epilogue = this->current;
+	emit8(0x48); emit8(0x83); emit8(0xc4); emit8(0x08);			//add rsp, 8
+	emit8(0x41); emit8(0x5f);									//pop r15
+	emit8(0x41); emit8(0x5e);									//pop r14
+	emit8(0x41); emit8(0x5d);									//pop r13
+	emit8(0x41); emit8(0x5c);									//pop r12
+	emit8(0x5d);												//pop rbp
+	emit8(0x5b);												//pop rbx
+	emit8(0xc3);												//ret
+
+	while (((uint64_t) this->current) & 0xf)
+		emit8(0xcc);
+	this->blocksStart = this->current;
+}
+
+//******************************************************************************************
+//Block entry: the block only runs if all its instructions fit in the instruction budget
+
+void RiscvJit::emitPrologue(uint32_t address, int size){
+	emitSimulatorAccess(0x49, 0x8b, HOST_EAX, nInstOffset);	//mov rax, n_inst
+	emit8(0x48); emit8(0x05); emit32(size);						//add rax, size
+	emitSimulatorAccess(0x49, 0x3b, HOST_EAX, limitOffset);		//cmp rax, jitLimit
+	emit8(0x0f); emit8(0x86); emit32(0);						//jbe body
+	unsigned char* body = this->current - 4;
+
+	emitSimulatorAccess(0x41, 0xc7, 0, pcOffset);				//mov pc, address
+	emit32(address);
+	emitJump(this->epilogue);
+
+	patchRel32(body, this->current);
+	if (!this->tracing)
+		emitSimulatorAccess(0x49, 0x89, HOST_EAX, nInstOffset);	//mov n_inst, rax
+}
+
+//Direct exit, chained to the successor when it is translated
+void RiscvJit::emitExit(uint32_t target){
+	emitSimulatorAccess(0x41, 0xc7, 0, pcOffset);				//mov pc, target
+	emit32(target);
+
+	void* successor = this->lookup(target);
+	emitJump((unsigned char*) successor);
+	if (successor == this->epilogue && !(target & 0x3))
+		this->pendingLinks[target].push_back(this->current - 4);
+}
+
+//Indirect exit, the target is already in pc
+void RiscvJit::emitIndirectExit(){
+	emitBytes(movRdiR14, 3);
+	emitCall((void*) jitLookup);
+	emit8(0xff); emit8(0xe0);									//jmp rax
+}
+
+//In verbose mode, completes the trace line of the instruction
+void RiscvJit::emitTraceRegisters(){
+	if (this->tracing){
+		emitBytes(movRdiR14, 3);
+		emitCall((void*) jitTraceRegisters);
+	}
+}
+
+//Exit in the middle of a block, remaining is the number of instructions not executed
+void RiscvJit::emitEarlyExit(uint32_t nextAddress, int remaining){
+	emitTraceRegisters();
+	if (!this->tracing && remaining != 0){
+		emitSimulatorAccess(0x49, 0x81, 5, nInstOffset);		//sub n_inst, remaining
+		emit32(remaining);
+	}
+	emitSimulatorAccess(0x41, 0xc7, 0, pcOffset);				//mov pc, nextAddress
+	emit32(nextAddress);
+	emitJump(this->epilogue);
+}
+
+//The guest address of the store is in eax. If it touches a page holding decoded code,
+//the simulator invalidates it and we leave the block, which may have been modified.
+void RiscvJit::emitStoreCheck(uint32_t address, int size, int remaining){
+	static const char checkFirstPage[] = {
+			(char) 0x89, (char) 0xc2,								//mov edx, eax
+			(char) 0xc1, (char) 0xea, 0x0c,							//shr edx, 12
+			0x41, (char) 0x80, 0x7c, 0x15, 0x00, 0x00};				//cmp byte [r13 + rdx], 0
+	static const char checkLastPage[] = {
+			(char) 0xc1, (char) 0xea, 0x0c,							//shr edx, 12
+			0x41, (char) 0x80, 0x7c, 0x15, 0x00, 0x00};				//cmp byte [r13 + rdx], 0
+
+	unsigned char* slowPath = NULL;
+	emitBytes(checkFirstPage, sizeof(checkFirstPage));
+	if (size > 1){
+		emit8(0x75); emit8(0);									//jne slow
+		slowPath = this->current - 1;
+		emit8(0x8d); emit8(0x50); emit8(size - 1);				//lea edx, [rax + size - 1]
+		emitBytes(checkLastPage, sizeof(checkLastPage));
+	}
+	emit8(0x74); emit8(0);										//je done
+	unsigned char* done = this->current - 1;
+
+	if (slowPath != NULL)
+		*slowPath = this->current - (slowPath + 1);
+	emitBytes(movRdiR14, 3);
+	emit8(0x89); emit8(0xc6);									//mov esi, eax
+	emit8(0xba); emit32(size);									//mov edx, size
+	emitCall((void*) jitCodeStore);
+	emitEarlyExit(address + 4, remaining);
+
+	*done = this->current - (done + 1);
+}
+
+//******************************************************************************************
+//Translation of a single instruction. Returns true when it ends the block.
+
+bool RiscvJit::emitInstruction(uint32_t address, const DecodedInstruction* decoded, int remaining){
+	uint32_t ins = decoded->instruction;
+	uint8_t rd = decoded->rd, rs1 = decoded->rs1, rs2 = decoded->rs2, funct3 = decoded->funct3, funct7 = decoded->funct7;
+	int32_t imm = decoded->imm;
+
+	//Sequences shared by several instructions
+	static const char signExtendRs1[] = {0x48, 0x63, 0x43};		//movsxd rax, [rbx + d8]
+	static const char signExtendRs2[] = {0x48, 0x63, 0x4b};		//movsxd rcx, [rbx + d8]
+
+	switch (ins & 0x7f)
+	{
+	case RISCV_LUI:
+		if (rd != 0){
+			emit8(0xc7); emit8(0x43); emit8(rd * 4); emit32(imm);	//mov [rd], imm
+		}
+		return false;
+	case RISCV_AUIPC:
+		if (rd != 0){
+			emit8(0xc7); emit8(0x43); emit8(rd * 4); emit32(address + imm);
+		}
+		return false;
+	case RISCV_JAL:
+		if (rd != 0){
+			emit8(0xc7); emit8(0x43); emit8(rd * 4); emit32(address + 4);
+		}
+		emitTraceRegisters();
+		emitExit(address + imm);
+		return true;
+	case RISCV_JALR:
+		emitLoadReg(HOST_EAX, rs1);
+		emit8(0x05); emit32(imm);								//add eax, imm
+		emit8(0x83); emit8(0xe0); emit8(0xfe);					//and eax, -2
+		emitSimulatorAccess(0x41, 0x89, HOST_EAX, pcOffset);	//mov pc, eax
+		if (rd != 0){
+			emit8(0xc7); emit8(0x43); emit8(rd * 4); emit32(address + 4);
+		}
+		emitTraceRegisters();
+		emitIndirectExit();
+		return true;
+	case RISCV_BR:
+	{
+		static const uint8_t conditions[8] = {0x84, 0x85, 0, 0, 0x8c, 0x8d, 0x82, 0x83}; //je jne - - jl jge jb jae
+		emitTraceRegisters();
+		emitLoadReg(HOST_EAX, rs1);
+		emit8(0x3b); emit8(0x43); emit8(rs2 * 4);				//cmp eax, [rs2]
+		emit8(0x0f); emit8(conditions[funct3]); emit32(0);		//jcc taken
+		unsigned char* taken = this->current - 4;
+		emitExit(address + 4);
+		patchRel32(taken, this->current);
+		emitExit(address + imm);
+		return true;
+	}
+	case RISCV_LD:
+	{
+		static const uint8_t loads[8][4] = {
+				{0x41, 0x0f, 0xbe, 0},		//movsx ecx, byte [r12 + rax]
+				{0x41, 0x0f, 0xbf, 0},		//movsx ecx, word [r12 + rax]
+				{0x41, 0x8b, 0, 0},			//mov ecx, [r12 + rax]
+				{0x49, 0x8b, 0, 0},			//mov rcx, [r12 + rax]
+				{0x41, 0x0f, 0xb6, 0},		//movzx ecx, byte [r12 + rax]
+				{0x41, 0x0f, 0xb7, 0},		//movzx ecx, word [r12 + rax]
+				{0x41, 0x8b, 0, 0},			//mov ecx, [r12 + rax]
+				{0, 0, 0, 0}};
+		emitLoadReg(HOST_EAX, rs1);
+		emit8(0x05); emit32(imm);								//add eax, imm
+		for (int i=0; i<4 && loads[funct3][i] != 0; i++)
+			emit8(loads[funct3][i]);
+		emit8(0x0c); emit8(0x04);
+		emitStoreReg(HOST_ECX, rd);
+		return false;
+	}
+	case RISCV_ST:
+	{
+		static const int sizes[4] = {1, 2, 4, 8};
+		emitLoadReg(HOST_EAX, rs1);
+		emit8(0x05); emit32(imm);								//add eax, imm
+		switch (funct3)
+		{
+		case RISCV_ST_STB:
+			emitLoadReg(HOST_ECX, rs2);
+			emit8(0x41); emit8(0x88);							//mov [r12 + rax], cl
+			break;
+		case RISCV_ST_STH:
+			emitLoadReg(HOST_ECX, rs2);
+			emit8(0x66); emit8(0x41); emit8(0x89);				//mov [r12 + rax], cx
+			break;
+		case RISCV_ST_STW:
+			emitLoadReg(HOST_ECX, rs2);
+			emit8(0x41); emit8(0x89);							//mov [r12 + rax], ecx
+			break;
+		default:
+			emitBytes(signExtendRs2, 3); emit8(rs2 * 4);
+			emit8(0x49); emit8(0x89);							//mov [r12 + rax], rcx
+			break;
+		}
+		emit8(0x0c); emit8(0x04);
+		emitStoreCheck(address, sizes[funct3], remaining);
+		return false;
+	}
+	case RISCV_OPI:
+	case RISCV_OPIW:
+		if ((ins & 0x7f) == RISCV_OPIW && funct3 != RISCV_OPIW_ADDIW){
+			static const uint8_t shifts[3] = {0xe0, 0xe8, 0xf8};	//shl shr sar
+			emitLoadReg(HOST_EAX, rs1);
+			emit8(0xc1);
+			if (funct3 == RISCV_OPIW_SLLIW)
+				emit8(shifts[0]);
+			else
+				emit8(funct7 == RISCV_OPIW_SRW_SRLIW ? shifts[1] : shifts[2]);
+			emit8(rs2);
+			emitStoreReg(HOST_EAX, rd);
+			return false;
+		}
+		switch (funct3)
+		{
+		case RISCV_OPI_ADDI:
+		case RISCV_OPI_XORI:
+		case RISCV_OPI_ORI:
+		case RISCV_OPI_ANDI:
+		{
+			static const uint8_t operations[8] = {0x05, 0, 0, 0, 0x35, 0, 0x0d, 0x25};	//add - - - xor - or and
+			emitLoadReg(HOST_EAX, rs1);
+			emit8(operations[funct3]); emit32(imm);
+			break;
+		}
+		case RISCV_OPI_SLTI:
+		case RISCV_OPI_SLTIU:
+			emitLoadReg(HOST_EAX, rs1);
+			emit8(0x3d); emit32(imm);							//cmp eax, imm
+			emit8(0x0f); emit8(funct3 == RISCV_OPI_SLTI ? 0x9c : 0x92); emit8(0xc0);	//setl/setb al
+			emit8(0x0f); emit8(0xb6); emit8(0xc0);				//movzx eax, al
+			break;
+		case RISCV_OPI_SLLI:
+			emitLoadReg(HOST_EAX, rs1);
+			emit8(0xc1); emit8(0xe0); emit8(imm & 0x1f);		//shl eax, imm
+			break;
+		default: //Shift right
+			emitLoadReg(HOST_EAX, rs1);
+			emit8(0xc1); emit8((ins >> 26) == 0 ? 0xe8 : 0xf8); emit8(imm & 0x1f);	//shr/sar eax, imm
+			break;
+		}
+		emitStoreReg(HOST_EAX, rd);
+		return false;
+	case RISCV_OP:
+	case RISCV_OPW:
+		if (funct7 == 1){
+			switch (funct3)
+			{
+			case RISCV_OP_M_MUL:
+				emitLoadReg(HOST_EAX, rs1);
+				emit8(0x0f); emit8(0xaf); emit8(0x43); emit8(rs2 * 4);	//imul eax, [rs2]
+				emitStoreReg(HOST_EAX, rd);
+				break;
+			case RISCV_OP_M_MULH:
+				if ((ins & 0x7f) == RISCV_OPW)
+					break;
+				emitBytes(signExtendRs1, 3); emit8(rs1 * 4);
+				emitBytes(signExtendRs2, 3); emit8(rs2 * 4);
+				emit8(0x48); emit8(0x0f); emit8(0xaf); emit8(0xc1);		//imul rax, rcx
+				emit8(0x48); emit8(0xc1); emit8(0xf8); emit8(0x20);		//sar rax, 32
+				emitStoreReg(HOST_EAX, rd);
+				break;
+			case RISCV_OP_M_MULHSU:
+				if ((ins & 0x7f) == RISCV_OPW)
+					break;
+				emitBytes(signExtendRs1, 3); emit8(rs1 * 4);
+				emitLoadReg(HOST_ECX, rs2);								//zero-extended to rcx
+				emit8(0x48); emit8(0x0f); emit8(0xaf); emit8(0xc1);		//imul rax, rcx
+				emit8(0x48); emit8(0xc1); emit8(0xf8); emit8(0x20);		//sar rax, 32
+				emitStoreReg(HOST_EAX, rd);
+				break;
+			default: //MULHU, the divisions are not translated
+				if ((ins & 0x7f) == RISCV_OPW)
+					break;
+				emitLoadReg(HOST_EAX, rs1);
+				emitLoadReg(HOST_ECX, rs2);
+				emit8(0x48); emit8(0x0f); emit8(0xaf); emit8(0xc1);		//imul rax, rcx
+				emit8(0x48); emit8(0xc1); emit8(0xe8); emit8(0x20);		//shr rax, 32
+				emitStoreReg(HOST_EAX, rd);
+				break;
+			}
+			return false;
+		}
+
+		if ((ins & 0x7f) == RISCV_OPW && funct3 != RISCV_OPW_ADDSUBW){
+			//SLLW and SRLW
+			emitLoadReg(HOST_ECX, rs2);
+			emitLoadReg(HOST_EAX, rs1);
+			emit8(0xd3); emit8(funct3 == RISCV_OPW_SLLW ? 0xe0 : 0xe8);	//shl/shr eax, cl
+			emitStoreReg(HOST_EAX, rd);
+			return false;
+		}
+
+		switch (funct3)
+		{
+		case RISCV_OP_ADD:
+			emitLoadReg(HOST_EAX, rs1);
+			emit8(funct7 == RISCV_OP_ADD_ADD ? 0x03 : 0x2b); emit8(0x43); emit8(rs2 * 4);	//add/sub eax, [rs2]
+			break;
+		case RISCV_OP_XOR:
+		case RISCV_OP_OR:
+		case RISCV_OP_AND:
+		{
+			static const uint8_t operations[8] = {0, 0, 0, 0, 0x33, 0, 0x0b, 0x23};	//xor or and
+			emitLoadReg(HOST_EAX, rs1);
+			emit8(operations[funct3]); emit8(0x43); emit8(rs2 * 4);
+			break;
+		}
+		case RISCV_OP_SLT:
+		case RISCV_OP_SLTU:
+			emitLoadReg(HOST_EAX, rs1);
+			emit8(0x3b); emit8(0x43); emit8(rs2 * 4);			//cmp eax, [rs2]
+			emit8(0x0f); emit8(funct3 == RISCV_OP_SLT ? 0x9c : 0x92); emit8(0xc0);	//setl/setb al
+			emit8(0x0f); emit8(0xb6); emit8(0xc0);				//movzx eax, al
+			break;
+		case RISCV_OP_SLL:
+			emitLoadReg(HOST_ECX, rs2);
+			emitLoadReg(HOST_EAX, rs1);
+			emit8(0xd3); emit8(0xe0);							//shl eax, cl, which takes the low 5 bits of cl
+			break;
+		default: //Shift right
+			emitLoadReg(HOST_ECX, rs2);
+			emitLoadReg(HOST_EAX, rs1);
+			emit8(0xd3); emit8(funct7 == RISCV_OP_SR_SRL ? 0xe8 : 0xf8);	//shr/sar eax, cl
+			break;
+		}
+		emitStoreReg(HOST_EAX, rd);
+		return false;
+	}
+
+	return true;
+}
+
+//******************************************************************************************
+
+void* RiscvJit::translate(uint32_t address){
+	if (this->codeCache == NULL || (address & 0x3))
+		return NULL;
+
+	//We first find the extent of the block
+	DecodedInstruction* instructions[JIT_MAX_BLOCK_INSTRUCTIONS];
+	int size = 0;
+	uint32_t instructionAddress = address;
+	while (size < JIT_MAX_BLOCK_INSTRUCTIONS){
+		DecodedInstruction* decoded = this->simulator->getDecodedInstruction(instructionAddress);
+		if (!isTranslated(decoded))
+			break;
+		instructions[size++] = decoded;
+		instructionAddress += 4;
+		if (isControlFlow(decoded) || (instructionAddress >> CODE_PAGEBITS) != (address >> CODE_PAGEBITS))
+			break;
+	}
+	if (size == 0)
+		return NULL;
+
+	if (this->current + JIT_MAX_BLOCK_BYTES > this->codeCache + JIT_CODECACHE_SIZE)
+		this->flush();
+
+	unsigned char* block = this->current;
+	emitPrologue(address, size);
+
+	bool ended = false;
+	for (int i=0; i<size; i++){
+		uint32_t pc = address + 4*i;
+		if (this->tracing){
+			emitBytes(movRdiR14, 3);
+			emit8(0xbe); emit32(pc);							//mov esi, pc
+			emit8(0xba); emit32(instructions[i]->instruction);	//mov edx, instruction
+			emitCall((void*) jitTraceInstruction);
+		}
+
+		//Control flow instructions complete their trace line before leaving the block
+		ended = emitInstruction(pc, instructions[i], size - i - 1);
+		if (!ended)
+			emitTraceRegisters();
+	}
+	if (!ended)
+		emitExit(address + 4*size);
+
+	while (((uint64_t) this->current) & 0xf)
+		emit8(0xcc);
+
+	//The block is registered, and exits which were waiting for it are linked
+	DecodedInstruction* entry = this->simulator->getDecodedInstruction(address);
+	entry->block = block;
+	this->blockAddresses.push_back(address);
+	this->translatedPages[address >> CODE_PAGEBITS] = 1;
+	this->translatedBlocks++;
+
+	std::unordered_map<uint32_t, std::vector<unsigned char*> >::iterator links = this->pendingLinks.find(address);
+	if (links != this->pendingLinks.end()){
+		for (unsigned int i=0; i<links->second.size(); i++)
+			patchRel32(links->second[i], block);
+		this->pendingLinks.erase(links);
+	}
+
+	return block;
+}
+
+#endif
@@ -9,39 +9,55 @@
 
 #include <isa/riscvISA.h>
 #include <simulator/riscvSimulator.h>
+#include <lib/stackDistance.h>
+#include <lib/memoryTrace.h>
+#include <lib/branchTrace.h>
+#include <lib/elfImage.h>
 
 #include <types.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <fcntl.h>
 
-ac_int<64, false> shiftMask[64];
-float regf[32];
 #define MAX(a,b) ((a) > (b) ? a : b)
 #define MIN(a,b) ((a) < (b) ? a : b)
 
-int RiscvSimulator::doSimulation(int nbkCycle){
-	long long hilo;
-
-	//We initialize shiftmask
-	ac_int<64, false> value = 0xffffffff;
-	value = (value << 32) + value;
+RiscvSimulator::RiscvSimulator(void) : GenericSimulator(){
+	for (int i=0; i<DECODED_TABLEENTRIES; i++)
+		decodedPages[i] = NULL;
+	codePages = (unsigned char*) calloc(CODE_PAGES, sizeof(unsigned char));
+	jit = NULL;
+	jitBlockStart = true;
+	jitLimit = 0;
+	pc = 0;
+	n_inst = 0;
 	function_counter = 0;
-	for (int i=0; i<64; i++){
-		shiftMask[i] = value;
-		value = value >> 1;
+	memset(REG, 0, sizeof(REG));
+	memset(regf, 0, sizeof(regf));
+}
+
+RiscvSimulator::~RiscvSimulator(void){
+	delete jit;
+	for (int i=0; i<DECODED_TABLEENTRIES; i++){
+		if (decodedPages[i] != NULL){
+			for (int j=0; j<DECODED_TABLEENTRIES; j++)
+				free(decodedPages[i][j]);
+			free(decodedPages[i]);
+		}
 	}
+}
+
+int RiscvSimulator::doSimulation(int nbkCycle){
+	function_counter = 0;
 
 	//We initialize instruction counter
 	n_inst = 0;
+	this->run((uint64_t) nbkCycle*1000);
 
-	do{
-		this->doStep();
-	}
-	while (stop != 1 && n_inst<nbkCycle*1000);
-
-	if (this->stop){
+	if (this->stop && this->error == SIM_ERROR_NONE){
 		fprintf(stderr,"Simulation finished in %d cycles\n",n_inst);
 		printf("Function call cycles: %d \n",function_counter);
 	}
@@ -50,590 +66,937 @@ int RiscvSimulator::doSimulation(int nbkCycle){
 
 }
 
-void RiscvSimulator::doStep(){
+void RiscvSimulator::load(const ElfImage& image, int argc, char** argv){
+	this->initialize(argc, argv);
+
+	unsigned int heapAddress = 0;
+	for (unsigned int i = 0; i < image.sections.size(); i++){
+		const ElfImageSection& section = image.sections[i];
+		if (section.address == 0 || section.content.empty())
+			continue;
+		this->writeMemory(section.address, &section.content[0], section.content.size());
+		if (section.address + section.content.size() > heapAddress)
+			heapAddress = section.address + section.content.size();
+	}
+	this->heapAddress = heapAddress;
+	this->pc = image.start != 0 ? image.start : 0x10000;
+}
 
+int RiscvSimulator::run(uint64_t instructions){
+	uint64_t limit = n_inst + instructions;
+	jitLimit = limit;
 
-	int storedVerbose = this->debugLevel;
+	GenericSimulator* previous = GenericSimulator::running;
+	GenericSimulator::running = this;
+	if (sigsetjmp(faultTarget, 0) == 0){
+		while (stop != 1 && n_inst < limit)
+			this->doStep();
+	}
+	else
+		this->fail(SIM_ERROR_MEMORY, "Guest memory access out of range (offset %llx past the 4GB address space)", faultOffset);
+	GenericSimulator::running = previous;
 
-	/*Fetching new instruction */
-	ac_int<32, false> ins = this->ldw(pc);
+	if (this->error != SIM_ERROR_NONE)
+		return SIM_ERROR;
+	return this->stop ? SIM_EXITED : SIM_RUNNING;
+}
+
+int32_t RiscvSimulator::getRegister(int index){
+	return REG[index & 0x1f];
+}
 
-	if (this->debugLevel>1){
-		fprintf(stderr,"%d;%x;%x", (int)n_inst, (int)pc, (int) ins);
-		std::cerr << printDecodedInstrRISCV(ins);
+void RiscvSimulator::setRegister(int index, int32_t value){
+	if (index & 0x1f)
+		REG[index & 0x1f] = value;
+}
+
+//******************************************************************************************
+//Control instructions go to the branch trace once executed, pc then holds their successor.
+//x1 and x5 are the link registers, a JALR reading one is a return unless it writes it back.
+
+static void recordBranch(RiscvSimulator* simulator, const DecodedInstruction* decoded, uint32_t currentPc){
+	uint32_t opcode = decoded->instruction & 0x7f;
+	bool rdLink = decoded->rd == 1 || decoded->rd == 5;
+	bool rs1Link = decoded->rs1 == 1 || decoded->rs1 == 5;
+	uint8_t call = rdLink ? BRANCHTRACE_CALL : 0;
+
+	if (opcode == RISCV_BR){
+		uint32_t target = currentPc + decoded->imm;
+		simulator->branches->write(currentPc, target, BRANCHTRACE_CONDITIONAL,
+				simulator->pc == target ? BRANCHTRACE_TAKEN : 0);
+	}
+	else if (opcode == RISCV_JAL)
+		simulator->branches->write(currentPc, simulator->pc, BRANCHTRACE_JUMP, BRANCHTRACE_TAKEN | call);
+	else if (opcode == RISCV_JALR){
+		uint8_t kind = rs1Link && (!rdLink || decoded->rd != decoded->rs1) ? BRANCHTRACE_RETURN : BRANCHTRACE_INDIRECT;
+		simulator->branches->write(currentPc, simulator->pc, kind, BRANCHTRACE_TAKEN | call);
 	}
+}
 
-	pc = pc + 4;
+//******************************************************************************************
+//Native memory accesses. The flat memory is accessed directly, otherwise we go through
+//the generic memory interface. Both are seen by the stack distance analysis and
+//by the memory trace. pc already points to the next instruction when they run.
 
+static inline void observeAccess(RiscvSimulator* simulator, uint32_t addr, uint8_t size, uint8_t type){
+	if (simulator->reuse != NULL)
+		simulator->reuse->access(addr);
+	if (simulator->trace != NULL)
+		simulator->trace->write(simulator->pc - 4, addr, size, type);
+}
 
-	//We decode the instruction to execute
-	ac_int<7, false> opcode = ins.slc<7>(0);
-	ac_int<5, false> rs1 = ins.slc<5>(15);
-	ac_int<5, false> rs2 = ins.slc<5>(20);
-	ac_int<5, false> rs3 = ins.slc<5>(27);
+static inline int32_t loadByte(RiscvSimulator* simulator, uint32_t addr){
+	observeAccess(simulator, addr, 1, TRACE_READ);
+	if (simulator->flatMemory != NULL)
+		return (int8_t) simulator->flatMemory[addr];
+	return simulator->ldb(addr).to_int();
+}
 
-	ac_int<5, false> rd = ins.slc<5>(7);
-	ac_int<7, false> funct7 = ins.slc<7>(25);
-	ac_int<7, false> funct7_smaller = 0;
-	funct7_smaller.set_slc(1, ins.slc<6>(26));
+static inline int32_t loadHalf(RiscvSimulator* simulator, uint32_t addr){
+	observeAccess(simulator, addr, 2, TRACE_READ);
+	if (simulator->flatMemory != NULL){
+		int16_t value;
+		memcpy(&value, simulator->flatMemory + addr, 2);
+		return value;
+	}
+	return simulator->ldh(addr).to_int();
+}
 
-	ac_int<3, false> funct3 = ins.slc<3>(12);
-	ac_int<12, false> imm12_I = ins.slc<12>(20);
-	ac_int<12, false> imm12_S = 0;
-	imm12_S.set_slc(5, ins.slc<7>(25));
-	imm12_S.set_slc(0, ins.slc<5>(7));
+//Instruction fetches of the decoder are not data accesses
+static inline int32_t fetchWord(RiscvSimulator* simulator, uint32_t addr){
+	if (simulator->flatMemory != NULL){
+		int32_t value;
+		memcpy(&value, simulator->flatMemory + addr, 4);
+		return value;
+	}
+	return simulator->ldw(addr).to_int();
+}
 
-	ac_int<12, true> imm12_I_signed = ins.slc<12>(20);
-	ac_int<12, true> imm12_S_signed = 0;
-	imm12_S_signed.set_slc(0, imm12_S.slc<12>(0));
+static inline int32_t loadWord(RiscvSimulator* simulator, uint32_t addr){
+	observeAccess(simulator, addr, 4, TRACE_READ);
+	return fetchWord(simulator, addr);
+}
 
+static inline int64_t loadDouble(RiscvSimulator* simulator, uint32_t addr){
+	observeAccess(simulator, addr, 8, TRACE_READ);
+	if (simulator->flatMemory != NULL){
+		int64_t value;
+		memcpy(&value, simulator->flatMemory + addr, 8);
+		return value;
+	}
+	return simulator->ldd(addr).to_int64();
+}
 
-	ac_int<13, false> imm13 = 0;
-	imm13[12] = ins[31];
-	imm13.set_slc(5, ins.slc<6>(25));
-	imm13.set_slc(1, ins.slc<4>(8));
-	imm13[11] = ins[7];
+static inline void storeByte(RiscvSimulator* simulator, uint32_t addr, int32_t value){
+	observeAccess(simulator, addr, 1, TRACE_WRITE);
+	if (simulator->flatMemory != NULL){
+		simulator->flatMemory[addr] = value;
+		simulator->checkCodeStore(addr, 1);
+	}
+	else
+		simulator->stb(addr, value);
+}
 
-	ac_int<13, true> imm13_signed = 0;
-	imm13_signed.set_slc(0, imm13);
+static inline void storeHalf(RiscvSimulator* simulator, uint32_t addr, int32_t value){
+	observeAccess(simulator, addr, 2, TRACE_WRITE);
+	if (simulator->flatMemory != NULL){
+		int16_t hostValue = value;
+		memcpy(simulator->flatMemory + addr, &hostValue, 2);
+		simulator->checkCodeStore(addr, 2);
+	}
+	else
+		simulator->sth(addr, value);
+}
 
-	ac_int<32, true> imm31_12 = 0;
-	imm31_12.set_slc(12, ins.slc<20>(12));
+static inline void storeWord(RiscvSimulator* simulator, uint32_t addr, int32_t value){
+	observeAccess(simulator, addr, 4, TRACE_WRITE);
+	if (simulator->flatMemory != NULL){
+		memcpy(simulator->flatMemory + addr, &value, 4);
+		simulator->checkCodeStore(addr, 4);
+	}
+	else
+		simulator->stw(addr, value);
+}
 
-	ac_int<21, false> imm21_1 = 0;
-	imm21_1.set_slc(12, ins.slc<8>(12));
-	imm21_1[11] = ins[20];
-	imm21_1.set_slc(1, ins.slc<10>(21));
-	imm21_1[20] = ins[31];
+static inline void storeDouble(RiscvSimulator* simulator, uint32_t addr, int64_t value){
+	observeAccess(simulator, addr, 8, TRACE_WRITE);
+	if (simulator->flatMemory != NULL){
+		memcpy(simulator->flatMemory + addr, &value, 8);
+		simulator->checkCodeStore(addr, 8);
+	}
+	else
+		simulator->std(addr, value);
+}
 
-	ac_int<21, true> imm21_1_signed = 0;
-	imm21_1_signed.set_slc(0, imm21_1);
+//RV32 shifts only use the low 5 bits of the amount
+static inline int32_t shiftRightArith(int32_t value, uint32_t amount){
+	return value >> (amount & 0x1f);
+}
 
-	ac_int<6, false> shamt = ins.slc<6>(20);
+static inline int32_t shiftRightLogical(int32_t value, uint32_t amount){
+	return (uint32_t) value >> (amount & 0x1f);
+}
 
+static inline int32_t shiftLeft(int32_t value, uint32_t amount){
+	return (uint32_t) value << (amount & 0x1f);
+}
 
-	ac_int<64, false> unsignedReg1 = 0;
-	ac_int<64, false> unsignedReg2 = 0;
+//Division by zero and overflow do not trap: the M extension defines their results
+static inline int32_t divideSigned(int32_t dividend, int32_t divisor){
+	if (divisor == 0)
+		return -1;
+	if (dividend == INT32_MIN && divisor == -1)
+		return dividend;
+	return dividend / divisor;
+}
 
-	ac_int<64, true> valueRegA;
+static inline int32_t divideUnsigned(uint32_t dividend, uint32_t divisor){
+	return divisor == 0 ? 0xffffffff : dividend / divisor;
+}
 
-	ac_int<128, true> longResult;
+static inline int32_t remainderSigned(int32_t dividend, int32_t divisor){
+	if (divisor == 0)
+		return dividend;
+	if (divisor == -1)
+		return 0;
+	return dividend % divisor;
+}
 
+static inline int32_t remainderUnsigned(uint32_t dividend, uint32_t divisor){
+	return divisor == 0 ? dividend : dividend % divisor;
+}
 
-	ac_int<32, true> localDataa, localDatab;
-	ac_int<64, true> localLongResult;
-	ac_int<32, false> localDataaUnsigned, localDatabUnsigned;
-	ac_int<32, true> localResult;
-	ac_int<32, false> temp_pc;
-	float localFloat;
-	//According to opcode/funct3/funct7 we perform the correct operation
-	switch (opcode)
-	{
-	case RISCV_LUI:
-		REG[rd] = imm31_12;
-	break;
-	case RISCV_AUIPC:
-		REG[rd] = pc -4 + imm31_12;
-	break;
-	case RISCV_JAL:
-		REG[rd] = pc;
-		pc = pc - 4 + imm21_1_signed;
-	break;
-	case RISCV_JALR:
-		temp_pc = pc;
-		pc = (REG[rs1] + imm12_I_signed) & 0xfffffffe;
-		REG[rd] = temp_pc;
-	break;
+#define REG simulator->REG
+#define PC simulator->pc
 
-	//******************************************************************************************
-	//Treatment for: BRANCH INSTRUCTIONS
-	case RISCV_BR:
-		switch(funct3)
-		{
-		case RISCV_BR_BEQ:
-			if (REG[rs1] == REG[rs2])
-				pc = pc + (imm13_signed) - 4;
-		break;
-		case RISCV_BR_BNE:
-			if (REG[rs1] != REG[rs2])
-				pc = pc + (imm13_signed) - 4;
-		break;
-		case RISCV_BR_BLT:
-			if (REG[rs1] < REG[rs2])
-				pc = pc + (imm13_signed) - 4;
-		break;
-		case RISCV_BR_BGE:
-			if (REG[rs1] >= REG[rs2])
-				pc = pc + (imm13_signed) - 4;
-		break;
-		case RISCV_BR_BLTU:
-			unsignedReg1.set_slc(0, REG[rs1].slc<64>(0));
-			unsignedReg2.set_slc(0, REG[rs2].slc<64>(0));
+//******************************************************************************************
+//Treatment for: LUI, AUIPC, JUMPS
 
-			if (unsignedReg1 < unsignedReg2)
-				pc = pc + (imm13_signed) - 4;
-		break;
-		case RISCV_BR_BGEU:
-			unsignedReg1.set_slc(0, REG[rs1].slc<64>(0));
-			unsignedReg2.set_slc(0, REG[rs2].slc<64>(0));
+static void opLui(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = decoded->imm;
+}
 
-			if (unsignedReg1 >= unsignedReg2)
-				pc = pc + (imm13_signed) - 4;
-		break;
-		default:
-			printf("In BR switch case, this should never happen... Instr was %x\n", (int)ins);
-			exit(-1);
-		break;
-		}
-	break;
+static void opAuipc(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = PC - 4 + decoded->imm;
+}
 
-	//******************************************************************************************
-	//Treatment for: LOAD INSTRUCTIONS
-	case RISCV_LD:
-		switch(funct3)
-		{
-		case RISCV_LD_LB:
-			REG[rd] = this->ldb(REG[rs1] + imm12_I_signed);
-		break;
-		case RISCV_LD_LH:
-			REG[rd] = this->ldh(REG[rs1] + imm12_I_signed);
-		break;
-		case RISCV_LD_LW:
-			REG[rd] = this->ldw(REG[rs1] + imm12_I_signed);
-		break;
-		case RISCV_LD_LD:
-			REG[rd] = this->ldd(REG[rs1] + imm12_I_signed);
-		break;
-		case RISCV_LD_LBU:
-			valueRegA = REG[rs1];
-			REG[rd] = 0;
-			REG[rd].set_slc(0, this->ldb(valueRegA + imm12_I_signed));
-		break;
-		case RISCV_LD_LHU:
-			valueRegA = REG[rs1];
-			REG[rd] = 0;
-			REG[rd].set_slc(0, this->ldh(valueRegA + imm12_I_signed));
-		break;
-		case RISCV_LD_LWU:
-			valueRegA = REG[rs1];
-			REG[rd] = 0;
-			REG[rd].set_slc(0, this->ldw(valueRegA + imm12_I_signed));
-		break;
-		default:
-			printf("In LD switch case, this should never happen... Instr was %x\n", (int)ins);
-			exit(-1);
-		break;
-		}
-	break;
+static void opJal(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = PC;
+	PC = PC - 4 + decoded->imm;
+}
 
-	//******************************************************************************************
-	//Treatment for: STORE INSTRUCTIONS
-	case RISCV_ST:
-		switch(funct3)
-		{
-		case RISCV_ST_STB:
-			this->stb(REG[rs1] + imm12_S_signed, REG[rs2]);
-		break;
-		case RISCV_ST_STH:
-			this->sth(REG[rs1] + imm12_S_signed, REG[rs2]);
-		break;
-		case RISCV_ST_STW:
-			this->stw(REG[rs1] + imm12_S_signed, REG[rs2]);
-		break;
-		case RISCV_ST_STD:
-			this->std(REG[rs1] + imm12_S_signed, REG[rs2]);
-		break;
-		default:
-			printf("In ST switch case, this should never happen... Instr was %x\n", (int)ins);
-			exit(-1);
-		break;
-		}
-	break;
+static void opJalr(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	uint32_t temp_pc = PC;
+	PC = (REG[decoded->rs1] + decoded->imm) & 0xfffffffe;
+	REG[decoded->rd] = temp_pc;
+}
 
-	//******************************************************************************************
-	//Treatment for: OPI INSTRUCTIONS
-	case RISCV_OPI:
-		switch(funct3)
-		{
-		case RISCV_OPI_ADDI:
-			REG[rd] = REG[rs1] + imm12_I_signed;
-		break;
-		case RISCV_OPI_SLTI:
-			REG[rd] = (REG[rs1] < imm12_I_signed) ? 1 : 0;
-		break;
-		case RISCV_OPI_SLTIU:
-			unsignedReg1.set_slc(0, REG[rs1].slc<32>(0));
+//******************************************************************************************
+//Treatment for: BRANCH INSTRUCTIONS
 
-			REG[rd] = (unsignedReg1 < imm12_I) ? 1 : 0;
-		break;
-		case RISCV_OPI_XORI:
-			REG[rd] = REG[rs1] ^ imm12_I_signed;
-		break;
-		case RISCV_OPI_ORI:
-			REG[rd] = REG[rs1] | imm12_I_signed;
-		break;
-		case RISCV_OPI_ANDI:
-			REG[rd] = REG[rs1] & imm12_I_signed;
-		break;
-		case RISCV_OPI_SLLI:
-			REG[rd] = REG[rs1] << shamt;
-		break;
-		case RISCV_OPI_SRI:
-			if (funct7_smaller == RISCV_OPI_SRI_SRLI){
-				REG[rd] = (REG[rs1] >> shamt) & shiftMask[shamt];
-			}
-			else //SRAI
-				REG[rd] = REG[rs1] >> shamt;
-		break;
-		default:
-			printf("In OPI switch case, this should never happen... Instr was %x\n", (int)ins);
-			exit(-1);
-		break;
-		}
-	break;
+static void opBeq(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	if (REG[decoded->rs1] == REG[decoded->rs2])
+		PC = PC + decoded->imm - 4;
+}
 
-	//******************************************************************************************
-	//Treatment for: OPIW INSTRUCTIONS
-	case RISCV_OPIW:
-		localDataa = REG[rs1];
-		localDatab = imm12_I_signed;
-		switch(funct3)
-		{
-		case RISCV_OPIW_ADDIW:
-			localResult = localDataa + localDatab;
-			REG[rd] = localResult;
-		break;
-		case RISCV_OPIW_SLLIW:
-			localResult = localDataa << rs2;
-			REG[rd] = localResult;
-		break;
-		case RISCV_OPIW_SRW:
-			if (funct7 == RISCV_OPIW_SRW_SRLIW)
-				localResult = (localDataa >> rs2) & shiftMask[32+rs2];
-			else //SRAI
-				localResult = localDataa >> rs2;
+static void opBne(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	if (REG[decoded->rs1] != REG[decoded->rs2])
+		PC = PC + decoded->imm - 4;
+}
 
-			REG[rd] = localResult;
-		break;
-		default:
-			printf("In OPI switch case, this should never happen... Instr was %x\n", (int)ins);
-			exit(-1);
-		break;
-		}
-	break;
+static void opBlt(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	if (REG[decoded->rs1] < REG[decoded->rs2])
+		PC = PC + decoded->imm - 4;
+}
 
-	//******************************************************************************************
-	//Treatment for: OP INSTRUCTIONS
-	case RISCV_OP:
-		if (funct7 == 1){
-			//Switch case for multiplication operations (in standard extension RV32M)
-			switch (funct3)
-			{
-			case RISCV_OP_M_MUL:
-				longResult = REG[rs1] * REG[rs2];
-				REG[rd] = longResult.slc<64>(0);
-			break;
-			case RISCV_OP_M_MULH:
-				longResult = REG[rs1] * REG[rs2];
-				REG[rd] = longResult.slc<64>(64);
-			break;
-			case RISCV_OP_M_MULHSU:
-				unsignedReg2 = REG[rs2];
-				longResult = REG[rs1] * unsignedReg2;
-				REG[rd] = longResult.slc<64>(64);
-			break;
-			case RISCV_OP_M_MULHU:
-				unsignedReg1 = REG[rs1];
-				unsignedReg2 = REG[rs2];
-				longResult = unsignedReg1 * unsignedReg2;
-				REG[rd] = longResult.slc<64>(64);
-			break;
-			case RISCV_OP_M_DIV:
-				REG[rd] = (REG[rs1] / REG[rs2]);
-			break;
-			case RISCV_OP_M_DIVU:
-				unsignedReg1 = REG[rs1];
-				unsignedReg2 = REG[rs2];
-				REG[rd] = unsignedReg1 / unsignedReg2;
-			break;
-			case RISCV_OP_M_REM:
-				REG[rd] = (REG[rs1] % REG[rs2]);
-			break;
-			case RISCV_OP_M_REMU:
-				unsignedReg1 = REG[rs1];
-				unsignedReg2 = REG[rs2];
-				REG[rd] = unsignedReg1 % unsignedReg2;
-			break;
-			}
+static void opBge(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	if (REG[decoded->rs1] >= REG[decoded->rs2])
+		PC = PC + decoded->imm - 4;
+}
 
-		}
-		else{
+static void opBltu(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	if ((uint32_t) REG[decoded->rs1] < (uint32_t) REG[decoded->rs2])
+		PC = PC + decoded->imm - 4;
+}
+
+static void opBgeu(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	if ((uint32_t) REG[decoded->rs1] >= (uint32_t) REG[decoded->rs2])
+		PC = PC + decoded->imm - 4;
+}
+
+//******************************************************************************************
+//Treatment for: LOAD INSTRUCTIONS
+
+static void opLb(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = loadByte(simulator, REG[decoded->rs1] + decoded->imm);
+}
+
+static void opLh(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = loadHalf(simulator, REG[decoded->rs1] + decoded->imm);
+}
+
+static void opLw(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = loadWord(simulator, REG[decoded->rs1] + decoded->imm);
+}
+
+static void opLd(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = loadDouble(simulator, REG[decoded->rs1] + decoded->imm);
+}
+
+static void opLbu(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = (uint8_t) loadByte(simulator, REG[decoded->rs1] + decoded->imm);
+}
+
+static void opLhu(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = (uint16_t) loadHalf(simulator, REG[decoded->rs1] + decoded->imm);
+}
+
+//******************************************************************************************
+//Treatment for: STORE INSTRUCTIONS
+
+static void opSb(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	storeByte(simulator, REG[decoded->rs1] + decoded->imm, REG[decoded->rs2]);
+}
+
+static void opSh(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	storeHalf(simulator, REG[decoded->rs1] + decoded->imm, REG[decoded->rs2]);
+}
+
+static void opSw(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	storeWord(simulator, REG[decoded->rs1] + decoded->imm, REG[decoded->rs2]);
+}
+
+static void opSd(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	storeDouble(simulator, REG[decoded->rs1] + decoded->imm, REG[decoded->rs2]);
+}
+
+//******************************************************************************************
+//Treatment for: OPI INSTRUCTIONS
+
+static void opAddi(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = (uint32_t) REG[decoded->rs1] + decoded->imm;
+}
+
+static void opSlti(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = (REG[decoded->rs1] < decoded->imm) ? 1 : 0;
+}
+
+//The immediate is sign-extended, then compared as an unsigned value
+static void opSltiu(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = ((uint32_t) REG[decoded->rs1] < (uint32_t) decoded->imm) ? 1 : 0;
+}
+
+static void opXori(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = REG[decoded->rs1] ^ decoded->imm;
+}
+
+static void opOri(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = REG[decoded->rs1] | decoded->imm;
+}
+
+static void opAndi(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = REG[decoded->rs1] & decoded->imm;
+}
+
+static void opSlli(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = shiftLeft(REG[decoded->rs1], decoded->imm);
+}
+
+static void opSrli(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = shiftRightLogical(REG[decoded->rs1], decoded->imm);
+}
+
+static void opSrai(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = shiftRightArith(REG[decoded->rs1], decoded->imm);
+}
+
+//******************************************************************************************
+//Treatment for: OPIW INSTRUCTIONS
+
+static void opAddiw(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = (uint32_t) REG[decoded->rs1] + decoded->imm;
+}
+
+static void opSlliw(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = (uint32_t) REG[decoded->rs1] << decoded->rs2;
+}
+
+static void opSrliw(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = (uint32_t) REG[decoded->rs1] >> decoded->rs2;
+}
+
+static void opSraiw(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = REG[decoded->rs1] >> decoded->rs2;
+}
+
+//******************************************************************************************
+//Treatment for: OP INSTRUCTIONS
+
+static void opMul(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = (uint32_t) REG[decoded->rs1] * (uint32_t) REG[decoded->rs2];
+}
+
+//The high part is bits 32 to 63 of the 64-bit product
+static void opMulh(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = ((int64_t) REG[decoded->rs1] * (int64_t) REG[decoded->rs2]) >> 32;
+}
+
+static void opMulhsu(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = ((int64_t) REG[decoded->rs1] * (int64_t) (uint32_t) REG[decoded->rs2]) >> 32;
+}
+
+static void opMulhu(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = ((uint64_t) (uint32_t) REG[decoded->rs1] * (uint32_t) REG[decoded->rs2]) >> 32;
+}
+
+static void opDiv(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = divideSigned(REG[decoded->rs1], REG[decoded->rs2]);
+}
+
+static void opDivu(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = divideUnsigned(REG[decoded->rs1], REG[decoded->rs2]);
+}
+
+static void opRem(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = remainderSigned(REG[decoded->rs1], REG[decoded->rs2]);
+}
+
+static void opRemu(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = remainderUnsigned(REG[decoded->rs1], REG[decoded->rs2]);
+}
+
+static void opAdd(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = (uint32_t) REG[decoded->rs1] + (uint32_t) REG[decoded->rs2];
+}
+
+static void opSub(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = (uint32_t) REG[decoded->rs1] - (uint32_t) REG[decoded->rs2];
+}
+
+static void opSll(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = shiftLeft(REG[decoded->rs1], REG[decoded->rs2]);
+}
+
+static void opSlt(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = (REG[decoded->rs1] < REG[decoded->rs2]) ? 1 : 0;
+}
+
+static void opSltu(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = ((uint32_t) REG[decoded->rs1] < (uint32_t) REG[decoded->rs2]) ? 1 : 0;
+}
+
+static void opXor(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = REG[decoded->rs1] ^ REG[decoded->rs2];
+}
+
+static void opSrl(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = shiftRightLogical(REG[decoded->rs1], REG[decoded->rs2]);
+}
+
+static void opSra(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = shiftRightArith(REG[decoded->rs1], REG[decoded->rs2]);
+}
+
+static void opOr(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = REG[decoded->rs1] | REG[decoded->rs2];
+}
+
+static void opAnd(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = REG[decoded->rs1] & REG[decoded->rs2];
+}
+
+//******************************************************************************************
+//Treatment for: OPW INSTRUCTIONS
+
+static void opMulw(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = (uint32_t) REG[decoded->rs1] * (uint32_t) REG[decoded->rs2];
+}
+
+static void opDivw(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = divideSigned(REG[decoded->rs1], REG[decoded->rs2]);
+}
+
+static void opDivuw(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = divideUnsigned(REG[decoded->rs1], REG[decoded->rs2]);
+}
+
+static void opRemw(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = remainderSigned(REG[decoded->rs1], REG[decoded->rs2]);
+}
+
+static void opRemuw(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = remainderUnsigned(REG[decoded->rs1], REG[decoded->rs2]);
+}
+
+static void opAddw(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = (uint32_t) REG[decoded->rs1] + (uint32_t) REG[decoded->rs2];
+}
+
+static void opSubw(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = (uint32_t) REG[decoded->rs1] - (uint32_t) REG[decoded->rs2];
+}
+
+static void opSllw(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = (uint32_t) REG[decoded->rs1] << (REG[decoded->rs2] & 0x1f);
+}
+
+static void opSrlw(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	REG[decoded->rd] = (uint32_t) REG[decoded->rs1] >> (REG[decoded->rs2] & 0x1f);
+}
+
+//A negative amount shifts to the left, as for ac_int
+static void opSraw(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	int32_t amount = REG[decoded->rs2];
+	if (amount < 0)
+		REG[decoded->rd] = -(int64_t) amount > 31 ? 0 : (uint32_t) REG[decoded->rs1] << -amount;
+	else
+		REG[decoded->rd] = amount > 31 ? (REG[decoded->rs1] < 0 ? -1 : 0) : REG[decoded->rs1] >> amount;
+}
+
+static void opNop(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+}
+
+//******************************************************************************************
+//Treatment for: SYSTEM INSTRUCTIONS
+
+static void opSystem(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	if (decoded->funct3 == 0 && decoded->funct7 == 0){
+		REG[10] = simulator->solveSyscall((int64_t) REG[17], (int64_t) REG[10], (int64_t) REG[11], (int64_t) REG[12], (int64_t) REG[13]).to_int();
+	}
+}
+
+static void opCust0(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	simulator->function_counter = simulator->n_inst - simulator->function_counter;
+}
 
-			//Switch case for base OP operation
-			switch(funct3)
-			{
-			case RISCV_OP_ADD:
-				if (funct7 == RISCV_OP_ADD_ADD)
-					REG[rd] = REG[rs1] + REG[rs2];
-				else
-					REG[rd] = REG[rs1] - REG[rs2];
+//******************************************************************************************
+//Treatment for: floating point operations
+
+static void opFlw(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	uint32_t localResult = 0;
+	for (int byte = 0; byte<decoded->funct3 && byte<4; byte++){
+		localResult |= (uint32_t) (uint8_t) loadByte(simulator, REG[decoded->rs1] + decoded->imm + byte) << (byte*8);
+	}
+	memcpy(&(simulator->regf[decoded->rd]), &localResult, 4);
+}
+
+static void opFsw(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	uint32_t localResult = 0;
+	memcpy(&localResult, &(simulator->regf[decoded->rs2]), 4);
+	for (int byte = 0; byte<decoded->funct3 && byte<4; byte++){
+		storeWord(simulator, REG[decoded->rs1] + decoded->imm, (int8_t) (localResult >> (byte*8)));
+	}
+}
+
+static void opFmadd(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	float* regf = simulator->regf;
+	regf[decoded->rd] = regf[decoded->rs1] * regf[decoded->rs2] + regf[decoded->rs3];
+}
+
+static void opFmsub(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	float* regf = simulator->regf;
+	regf[decoded->rd] = regf[decoded->rs1] * regf[decoded->rs2] - regf[decoded->rs3];
+}
+
+static void opFnmsub(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	float* regf = simulator->regf;
+	regf[decoded->rd] = -regf[decoded->rs1] * regf[decoded->rs2] + regf[decoded->rs3];
+}
+
+static void opFnmadd(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	float* regf = simulator->regf;
+	regf[decoded->rd] = -regf[decoded->rs1] * regf[decoded->rs2] - regf[decoded->rs3];
+}
+
+static void opFp(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	float* regf = simulator->regf;
+	uint8_t rd = decoded->rd, rs1 = decoded->rs1, rs2 = decoded->rs2, funct3 = decoded->funct3;
+	int32_t localResult;
+	float localFloat;
+
+	switch (decoded->funct7)
+	{
+		case  RISCV_FP_ADD:
+			regf[rd] = regf[rs1] + regf[rs2];
 			break;
-			case RISCV_OP_SLL:
-				REG[rd] = REG[rs1] << (REG[rs2] & 0x3f);
+		case  RISCV_FP_SUB:
+			regf[rd] = regf[rs1] - regf[rs2];
 			break;
-			case RISCV_OP_SLT:
-				REG[rd] = (REG[rs1] < REG[rs2]) ? 1 : 0;
+		case  RISCV_FP_MUL:
+			regf[rd] = regf[rs1] * regf[rs2];
 			break;
-			case RISCV_OP_SLTU:
-				unsignedReg1.set_slc(0, REG[rs1].slc<64>(0));
-				unsignedReg2.set_slc(0, REG[rs2].slc<64>(0));
-
-				REG[rd] = (unsignedReg1 < unsignedReg2) ? 1 : 0;
+		case  RISCV_FP_DIV:
+			regf[rd] = regf[rs1] / regf[rs2];
 			break;
-			case RISCV_OP_XOR:
-				REG[rd] = REG[rs1] ^ REG[rs2];
+		case  RISCV_FP_SQRT:
+			regf[rd] = sqrt(regf[rs1]);
 			break;
-			case RISCV_OP_SR:
-				if (funct7 == RISCV_OP_SR_SRL){
-					int shiftAmount = REG[rs2];
-					REG[rd] = (REG[rs1] >> (REG[rs2] & 0x3f)) & shiftMask[(shiftAmount & 0x3f)];
+		case  RISCV_FP_FSGN:
+			localFloat = abs(regf[rs1]);
+			if (funct3 == RISCV_FP_FSGN_J){
+				if (regf[rs2]<0){
+					regf[rd] = -localFloat;
 				}
-				else //SRA
-					REG[rd] = REG[rs1] >> (REG[rs2] & 0x3f);
-			break;
-			case RISCV_OP_OR:
-				REG[rd] = REG[rs1] | REG[rs2];
-			break;
-			case RISCV_OP_AND:
-				REG[rd] = REG[rs1] & REG[rs2];
+				else{
+					regf[rd] = localFloat;
+				}
+			}
+			else if (funct3 == RISCV_FP_FSGN_JN){
+				if (regf[rs2]<0){
+					regf[rd] = localFloat;
+				}
+				else{
+					regf[rd] = -localFloat;
+				}
+			}
+			else{ //JX
+				if ((regf[rs2]<0 && regf[rs1]>=0) || (regf[rs2]>=0 && regf[rs1]<0)){
+					regf[rd] = -localFloat;
+				}
+				else{
+					regf[rd] = localFloat;
+				}
+			}
 			break;
-			default:
-				printf("In OP switch case, this should never happen... Instr was %x\n", (int)ins);
-				exit(-1);
+		case  RISCV_FP_MINMAX:
+			if (funct3 == RISCV_FP_MINMAX_MIN)
+				regf[rd] = MIN(regf[rs1], regf[rs2]);
+			else
+				regf[rd] = MAX(regf[rs1], regf[rs2]);
 			break;
+		case  RISCV_FP_FCVTW:
+			if (rs2 == RISCV_FP_FCVTW_W){
+				regf[rd] = REG[rs1];
+			}
+			else{
+				regf[rd] = (unsigned int) REG[rs1];
 			}
-		}
-		break;
-
-	//******************************************************************************************
-	//Treatment for: OPW INSTRUCTIONS
-	case RISCV_OPW:
-		if (funct7 == 1){
-			localDataa = REG[rs1].slc<32>(0);
-			localDatab = REG[rs2].slc<32>(0);
-			localDataaUnsigned = REG[rs1].slc<32>(0);
-			localDatabUnsigned = REG[rs2].slc<32>(0);
-
-			//Switch case for multiplication operations (in standard extension RV32M)
-			switch (funct3)
-			{
-			case RISCV_OPW_M_MULW:
-				localLongResult = localDataa * localDatab;
-				REG[rd] = localLongResult.slc<32>(0);
 			break;
-			case RISCV_OPW_M_DIVW:
-				REG[rd] = (localDataa / localDatab);
+		case  RISCV_FP_FMVXFCLASS:
+			if (funct3 == RISCV_FP_FMVXFCLASS_FMVX){
+				memcpy(&localResult, &(regf[rs1]), 4);
+				REG[rd] = localResult;
+			}
+			else{
+				simulator->fail(SIM_ERROR_ILLEGAL_INSTRUCTION, "Fclass instruction is not handled in riscv simulator");
+			}
 			break;
-			case RISCV_OPW_M_DIVUW:
-				REG[rd] = localDataaUnsigned / localDatabUnsigned;
+		case  RISCV_FP_FCMP:
+			if (funct3 == RISCV_FP_FCMP_FEQ)
+				REG[rd] = regf[rs1] == regf[rs2];
+			else if (funct3 == RISCV_FP_FCMP_FLT)
+				REG[rd] = regf[rs1] < regf[rs2];
+			else
+				REG[rd] = regf[rs1] <= regf[rs2];
 			break;
-			case RISCV_OPW_M_REMW:
-				REG[rd] = (localDataa % localDatab);
+		case  RISCV_FP_FCVTS:
+			if (rs2 == RISCV_FP_FCVTS_W){
+				REG[rd] = ac_int<32, true>(regf[rs1]).to_int();
+			}
+			else{
+				REG[rd] = (unsigned int) regf[rs1];
+			}
 			break;
-			case RISCV_OPW_M_REMUW:
-				REG[rd] = localDataaUnsigned % localDatabUnsigned;
+		case  RISCV_FP_FMVW:
+			localResult = REG[rs1];
+			memcpy(&(regf[rd]),&localResult,  4);
 			break;
-			}
+	}
+}
+
+//******************************************************************************************
+//Instructions which are not handled: the error is raised when they are executed
+
+static void opIllegal(RiscvSimulator* simulator, const DecodedInstruction* decoded){
+	const char* message;
+	switch (decoded->instruction & 0x7f)
+	{
+	case RISCV_BR:
+		message = "In BR switch case, this should never happen... Instr was %x";
+		break;
+	case RISCV_LD:
+		message = "In LD switch case, this should never happen... Instr was %x";
+		break;
+	case RISCV_ST:
+		message = "In ST switch case, this should never happen... Instr was %x";
+		break;
+	case RISCV_OPI:
+	case RISCV_OPIW:
+		message = "In OPI switch case, this should never happen... Instr was %x";
+		break;
+	case RISCV_OPW:
+		message = "In OPW switch case, this should never happen... Instr was %x";
+		break;
+	default:
+		message = "In default part of switch opcode, instr %x is not handled yet";
+		break;
+	}
+	simulator->fail(SIM_ERROR_ILLEGAL_INSTRUCTION, message, (int) decoded->instruction);
+}
 
+#undef REG
+#undef PC
+
+static const InstructionHandler branchHandlers[8] = {opBeq, opBne, opIllegal, opIllegal, opBlt, opBge, opBltu, opBgeu};
+static const InstructionHandler loadHandlers[8] = {opLb, opLh, opLw, opLd, opLbu, opLhu, opLw, opIllegal};
+static const InstructionHandler storeHandlers[8] = {opSb, opSh, opSw, opSd, opIllegal, opIllegal, opIllegal, opIllegal};
+static const InstructionHandler opiHandlers[8] = {opAddi, opSlli, opSlti, opSltiu, opXori, opSrli, opOri, opAndi};
+static const InstructionHandler opMHandlers[8] = {opMul, opMulh, opMulhsu, opMulhu, opDiv, opDivu, opRem, opRemu};
+static const InstructionHandler opHandlers[8] = {opAdd, opSll, opSlt, opSltu, opXor, opSrl, opOr, opAnd};
+static const InstructionHandler opwMHandlers[8] = {opMulw, opNop, opNop, opNop, opDivw, opDivuw, opRemw, opRemuw};
+
+void RiscvSimulator::decode(uint32_t ins, DecodedInstruction* decoded){
+
+	uint32_t opcode = ins & 0x7f;
+	int32_t signedIns = ins;
+
+	decoded->instruction = ins;
+	decoded->rd = (ins >> 7) & 0x1f;
+	decoded->funct3 = (ins >> 12) & 0x7;
+	decoded->rs1 = (ins >> 15) & 0x1f;
+	decoded->rs2 = (ins >> 20) & 0x1f;
+	decoded->rs3 = (ins >> 27) & 0x1f;
+	decoded->funct7 = (ins >> 25) & 0x7f;
+
+	int32_t imm12_I_signed = signedIns >> 20;
+	int32_t imm12_S_signed = ((signedIns >> 25) << 5) | ((ins >> 7) & 0x1f);
+	int32_t imm13_signed = ((signedIns >> 31) << 12) | (((ins >> 7) & 0x1) << 11) | (((ins >> 25) & 0x3f) << 5) | (((ins >> 8) & 0xf) << 1);
+	int32_t imm21_1_signed = ((signedIns >> 31) << 20) | (ins & 0xff000) | (((ins >> 20) & 0x1) << 11) | (((ins >> 21) & 0x3ff) << 1);
+	int32_t imm31_12 = ins & 0xfffff000;
+	uint32_t shamt = (ins >> 20) & 0x3f;
+	uint32_t funct7_smaller = (ins >> 26) << 1;
+
+	decoded->imm = 0;
+	switch (opcode)
+	{
+	case RISCV_LUI:
+		decoded->handler = opLui;
+		decoded->imm = imm31_12;
+	break;
+	case RISCV_AUIPC:
+		decoded->handler = opAuipc;
+		decoded->imm = imm31_12;
+	break;
+	case RISCV_JAL:
+		decoded->handler = opJal;
+		decoded->imm = imm21_1_signed;
+	break;
+	case RISCV_JALR:
+		decoded->handler = opJalr;
+		decoded->imm = imm12_I_signed;
+	break;
+	case RISCV_BR:
+		decoded->handler = branchHandlers[decoded->funct3];
+		decoded->imm = imm13_signed;
+	break;
+	case RISCV_LD:
+		decoded->handler = loadHandlers[decoded->funct3];
+		decoded->imm = imm12_I_signed;
+	break;
+	case RISCV_ST:
+		decoded->handler = storeHandlers[decoded->funct3];
+		decoded->imm = imm12_S_signed;
+	break;
+	case RISCV_OPI:
+		decoded->handler = opiHandlers[decoded->funct3];
+		decoded->imm = imm12_I_signed;
+		if (decoded->funct3 == RISCV_OPI_SLLI)
+			decoded->imm = shamt;
+		else if (decoded->funct3 == RISCV_OPI_SRI){
+			decoded->imm = shamt;
+			if (funct7_smaller != RISCV_OPI_SRI_SRLI)
+				decoded->handler = opSrai;
 		}
+	break;
+	case RISCV_OPIW:
+		decoded->imm = imm12_I_signed;
+		if (decoded->funct3 == RISCV_OPIW_ADDIW)
+			decoded->handler = opAddiw;
+		else if (decoded->funct3 == RISCV_OPIW_SLLIW)
+			decoded->handler = opSlliw;
+		else if (decoded->funct3 == RISCV_OPIW_SRW)
+			decoded->handler = (decoded->funct7 == RISCV_OPIW_SRW_SRLIW) ? opSrliw : opSraiw;
+		else
+			decoded->handler = opIllegal;
+	break;
+	case RISCV_OP:
+		if (decoded->funct7 == 1)
+			decoded->handler = opMHandlers[decoded->funct3];
 		else{
-			localDataa = REG[rs1].slc<32>(0);
-			localDatab = REG[rs2].slc<32>(0);
-
-			//Switch case for base OP operation
-			switch(funct3)
-			{
-			case RISCV_OPW_ADDSUBW:
-				if (funct7 == RISCV_OPW_ADDSUBW_ADDW){
-					localResult = localDataa + localDatab;
-					REG[rd] = localResult;
-				}
-				else{ //SUBW
-					localResult = localDataa - localDatab;
-					REG[rd] = localResult;
-				}
-			break;
-			case RISCV_OPW_SLLW:
-				localResult = localDataa << (localDatab & 0x1f);
-				REG[rd] = localResult;
-			break;
-			case RISCV_OPW_SRW:
-				if (funct7 == RISCV_OPW_SRW_SRLW){
-					localResult = (localDataa >> (localDatab/* & 0x1f*/)) & shiftMask[32+localDatab/* & 0x1f*/];
-					REG[rd] = localResult;
-				}
-				else{ //SRAW
-					localResult = localDataa >> (localDatab/* & 0x1f*/);
-					REG[rd] = localResult;
-				}
-			break;
-			default:
-				printf("In OPW switch case, this should never happen... Instr was %x\n", (int)ins);
-				exit(-1);
-			break;
-			}
+			decoded->handler = opHandlers[decoded->funct3];
+			if (decoded->funct3 == RISCV_OP_ADD && decoded->funct7 != RISCV_OP_ADD_ADD)
+				decoded->handler = opSub;
+			else if (decoded->funct3 == RISCV_OP_SR && decoded->funct7 != RISCV_OP_SR_SRL)
+				decoded->handler = opSra;
 		}
-		break;
-		//END of OP treatment
-
-	//******************************************************************************************
-	//Treatment for: SYSTEM INSTRUCTIONS
+	break;
+	case RISCV_OPW:
+		if (decoded->funct7 == 1)
+			decoded->handler = opwMHandlers[decoded->funct3];
+		else if (decoded->funct3 == RISCV_OPW_ADDSUBW)
+			decoded->handler = (decoded->funct7 == RISCV_OPW_ADDSUBW_ADDW) ? opAddw : opSubw;
+		else if (decoded->funct3 == RISCV_OPW_SLLW)
+			decoded->handler = opSllw;
+		else if (decoded->funct3 == RISCV_OPW_SRW)
+			decoded->handler = (decoded->funct7 == RISCV_OPW_SRW_SRLW) ? opSrlw : opSraw;
+		else
+			decoded->handler = opIllegal;
+	break;
 	case RISCV_SYSTEM:
-		if (funct3 == 0 && funct7 == 0){
-			REG[10] = solveSyscall(REG[17], REG[10], REG[11], REG[12], REG[13]);
-		}
+		decoded->handler = opSystem;
 	break;
-	//******************************************************************************************
-	//Treatment for: floating point operations
 	case RISCV_FLW:
-		localResult = 0;
-		for (int byte = 0; byte<funct3; byte++){
-			localResult.set_slc(byte*8, ldb(REG[rs1] + imm12_I_signed+byte));
-		}
-		memcpy(&(regf[rd]), &localResult, 4);
-		break;
+		decoded->handler = opFlw;
+		decoded->imm = imm12_I_signed;
+	break;
 	case RISCV_FSW:
-		localResult = 0;
-		memcpy(&localResult, &(regf[rs2]), 4);
-		for (int byte = 0; byte<funct3; byte++){
-			stw(REG[rs1] + imm12_S_signed, localResult.slc<8>(byte*8));
-		}
-		break;
+		decoded->handler = opFsw;
+		decoded->imm = imm12_S_signed;
+	break;
 	case RISCV_FMADD:
-		regf[rd] = regf[rs1] * regf[rs2] + regf[rs3];
-		break;
+		decoded->handler = opFmadd;
+	break;
 	case RISCV_FMSUB:
-		regf[rd] = regf[rs1] * regf[rs2] - regf[rs3];
-		break;
+		decoded->handler = opFmsub;
+	break;
 	case RISCV_FNMSUB:
-		regf[rd] = -regf[rs1] * regf[rs2] + regf[rs3];
-		break;
+		decoded->handler = opFnmsub;
+	break;
 	case RISCV_FNMADD:
-		regf[rd] = -regf[rs1] * regf[rs2] - regf[rs3];
-		break;
+		decoded->handler = opFnmadd;
+	break;
 	case RISCV_FP:
-		switch (funct7)
-		{
-			case  RISCV_FP_ADD:
-				regf[rd] = regf[rs1] + regf[rs2];
-				break;
-			case  RISCV_FP_SUB:
-				regf[rd] = regf[rs1] - regf[rs2];
-				break;
-			case  RISCV_FP_MUL:
-				regf[rd] = regf[rs1] * regf[rs2];
-				break;
-			case  RISCV_FP_DIV:
-				regf[rd] = regf[rs1] / regf[rs2];
-				break;
-			case  RISCV_FP_SQRT:
-				regf[rd] = sqrt(regf[rs1]);
-				break;
-			case  RISCV_FP_FSGN:
-				localFloat = abs(regf[rs1]);
-				if (funct3 == RISCV_FP_FSGN_J){
-					if (regf[rs2]<0){
-						regf[rd] = -localFloat;
-					}
-					else{
-						regf[rd] = localFloat;
-					}
-				}
-				else if (funct3 == RISCV_FP_FSGN_JN){
-					if (regf[rs2]<0){
-						regf[rd] = localFloat;
-					}
-					else{
-						regf[rd] = -localFloat;
-					}
-				}
-				else{ //JX
-					if ((regf[rs2]<0 && regf[rs1]>=0) || (regf[rs2]>=0 && regf[rs1]<0)){
-						regf[rd] = -localFloat;
-					}
-					else{
-						regf[rd] = localFloat;
-					}
-				}
-				break;
-			case  RISCV_FP_MINMAX:
-				if (funct3 == RISCV_FP_MINMAX_MIN)
-					regf[rd] = MIN(regf[rs1], regf[rs2]);
-				else
-					regf[rd] = MAX(regf[rs1], regf[rs2]);
-				break;
-			case  RISCV_FP_FCVTW:
-				if (rs2 == RISCV_FP_FCVTW_W){
-					regf[rd] = REG[rs1];
-				}
-				else{
-					regf[rd] = (unsigned int) REG[rs1];
-				}
-				break;
-			case  RISCV_FP_FMVXFCLASS:
-				if (funct3 == RISCV_FP_FMVXFCLASS_FMVX){
-					memcpy(&localResult, &(regf[rs1]), 4);
-					REG[rd] = localResult;
-				}
-				else{
-					fprintf(stderr, "Fclass instruction is not handled in riscv simulator\n");
-					exit(-1);
-				}
-				break;
-			case  RISCV_FP_FCMP:
-				if (funct3 == RISCV_FP_FCMP_FEQ)
-					REG[rd] = regf[rs1] == regf[rs2];
-				else if (funct3 == RISCV_FP_FCMP_FLT)
-					REG[rd] = regf[rs1] < regf[rs2];
-				else
-					REG[rd] = regf[rs1] <= regf[rs2];
-				break;
-			case  RISCV_FP_FCVTS:
-				if (rs2 == RISCV_FP_FCVTS_W){
-					REG[rd] = regf[rs1];
-				}
-				else{
-					REG[rd] = (unsigned int) regf[rs1];
-				}
-				break;
-			case  RISCV_FP_FMVW:
-				localResult = REG[rs1];
-				memcpy(&(regf[rd]),&localResult,  4);
-				break;
-		}
-
-
-		break;
+		decoded->handler = opFp;
+	break;
 	case RISCV_OP_CUST0:
-		function_counter = n_inst - function_counter;	
-		break;
-	
+		decoded->handler = opCust0;
+	break;
 	default:
-		printf("In default part of switch opcode, instr %x is not handled yet(%x)\n", (int) ins, this->heapAddress);
-		exit(-1);
+		decoded->handler = opIllegal;
 	break;
+	}
+}
 
+DecodedInstruction* RiscvSimulator::getDecodedInstruction(uint32_t address){
+	unsigned int page = address >> CODE_PAGEBITS;
+	DecodedInstruction** table = decodedPages[page >> DECODED_TABLEBITS];
+	if (table == NULL){
+		table = (DecodedInstruction**) calloc(DECODED_TABLEENTRIES, sizeof(DecodedInstruction*));
+		decodedPages[page >> DECODED_TABLEBITS] = table;
 	}
-	REG[0] = 0;
-	n_inst = n_inst + 1;
-	
-	
-	if (storedVerbose>1){
-		for (int i=0; i<32; i++){
-			fprintf(stderr,";%lx", (int32_t) REG[i]);
+
+	DecodedInstruction* decodedPage = table[page & (DECODED_TABLEENTRIES - 1)];
+	if (decodedPage == NULL){
+		decodedPage = (DecodedInstruction*) calloc(DECODED_PAGEINSTRUCTIONS, sizeof(DecodedInstruction));
+		table[page & (DECODED_TABLEENTRIES - 1)] = decodedPage;
+	}
+
+	DecodedInstruction* decoded = &decodedPage[(address >> 2) & (DECODED_PAGEINSTRUCTIONS - 1)];
+	if (decoded->handler == NULL){
+		this->decode(fetchWord(this, address), decoded);
+		codePages[page] = 1;
+	}
+	return decoded;
+}
+
+DecodedInstruction* RiscvSimulator::probeDecodedInstruction(uint32_t address){
+	unsigned int page = address >> CODE_PAGEBITS;
+	DecodedInstruction** table = decodedPages[page >> DECODED_TABLEBITS];
+	if (table == NULL || table[page & (DECODED_TABLEENTRIES - 1)] == NULL)
+		return NULL;
+
+	DecodedInstruction* decoded = &table[page & (DECODED_TABLEENTRIES - 1)][(address >> 2) & (DECODED_PAGEINSTRUCTIONS - 1)];
+	return decoded->handler == NULL ? NULL : decoded;
+}
+
+void RiscvSimulator::invalidateCode(unsigned int page){
+	if (jit != NULL)
+		jit->invalidatePage(page);
+
+	DecodedInstruction** table = decodedPages[page >> DECODED_TABLEBITS];
+	if (table != NULL && table[page & (DECODED_TABLEENTRIES - 1)] != NULL)
+		memset(table[page & (DECODED_TABLEENTRIES - 1)], 0, DECODED_PAGEINSTRUCTIONS * sizeof(DecodedInstruction));
+	codePages[page] = 0;
+}
+
+bool RiscvSimulator::enableJit(){
+	if (flatMemory == NULL)
+		return false;
+
+	jit = new RiscvJit(this);
+	if (!jit->isAvailable()){
+		delete jit;
+		jit = NULL;
+		return false;
+	}
+	return true;
+}
+
+void RiscvSimulator::traceInstruction(uint32_t address, uint32_t ins){
+	fprintf(stderr,"%d;%x;%x", (int)n_inst, (int)address, (int)ins);
+	std::cerr << printDecodedInstrRISCV(ins);
+}
+
+void RiscvSimulator::traceRegisters(){
+	for (int i=0; i<32; i++){
+		fprintf(stderr,";%x", (uint32_t) REG[i]);
+	}
+	fprintf(stderr, "\n");
+}
+
+void RiscvSimulator::doStep(){
+
+	//Hot blocks are run from the code cache
+	if (jit != NULL && !(pc & 0x3)){
+		DecodedInstruction* decoded = this->getDecodedInstruction(pc);
+		void* block = decoded->block;
+		if (block == NULL && jitBlockStart && ++decoded->executions == JIT_HOT_THRESHOLD)
+			block = jit->translate(pc);
+
+		//A block not fitting in what is left of the budget returns at once: it is interpreted instead
+		if (block != NULL){
+			uint64_t executed = n_inst;
+			jit->execute(block);
+			jitBlockStart = true;
+			if (n_inst != executed)
+				return;
 		}
-		fprintf(stderr, "\n");
 	}
+
+	int storedVerbose = this->debugLevel;
+	uint32_t currentPc = pc;
+
+	/*Fetching new instruction */
+	DecodedInstruction misaligned;
+	DecodedInstruction* decoded;
+	if (pc & 0x3){
+		this->decode(fetchWord(this, pc), &misaligned);
+		decoded = &misaligned;
+	}
+	else
+		decoded = this->getDecodedInstruction(pc);
+
+	if (this->debugLevel>1)
+		this->traceInstruction(pc, decoded->instruction);
+	if (trace != NULL)
+		trace->write(pc, pc, 4, TRACE_FETCH);
+
+	pc = pc + 4;
+
+	decoded->handler(this, decoded);
+
+	REG[0] = 0;
+	n_inst = n_inst + 1;
+
+	if (branches != NULL)
+		recordBranch(this, decoded, currentPc);
+
+	//A new block starts after control flow or after an instruction the JIT leaves to us
+	if (jit != NULL)
+		jitBlockStart = pc != currentPc + 4 || !RiscvJit::isTranslated(decoded);
+
+	if (storedVerbose>1)
+		this->traceRegisters();
 }
 
 #endif
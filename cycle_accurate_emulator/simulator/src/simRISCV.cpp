@@ -13,8 +13,179 @@
 #include <cstring>
 #include <cstring>
 #include <lib/elfFile.h>
+#include <lib/elfImage.h>
+#include <lib/stackDistance.h>
+#include <lib/memoryTrace.h>
+#include <lib/branchTrace.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <thread>
 #include <unistd.h>
 
+#define INSTRUCTION_BUDGET 50000000000ULL
+
+/*********************************************************
+ * 	Parallel runs
+ *
+ * 	simRISCV -p jobs runs one program per line of the job
+ * 	file, on a pool of threads (-n, all the host threads by
+ * 	default). A line is an ELF file followed by the
+ * 	arguments of the program, <file gives its standard
+ * 	input (none by default) and >file its standard output;
+ * 	without it, what the program writes is printed with
+ * 	its status, in the order of the file, once every run
+ * 	is done. # starts a comment.
+ *********************************************************/
+
+struct IssJob{
+	std::string line;
+	std::vector<std::string> arguments; //The ELF file first
+	std::string input;
+	std::string output;
+	std::string result;
+	int status;
+};
+
+static bool readJobs(const char* fileName, std::vector<IssJob>* jobs){
+	std::ifstream in(fileName);
+	if (!in){
+		fprintf(stderr, "Cannot open %s\n", fileName);
+		return false;
+	}
+	std::string line;
+	while (std::getline(in, line)){
+		std::istringstream tokens(line.substr(0, line.find('#')));
+		std::string token;
+		IssJob job;
+		while (tokens >> token){
+			if (token[0] == '<')
+				job.input = token.substr(1);
+			else if (token[0] == '>')
+				job.output = token.substr(1);
+			else
+				job.arguments.push_back(token);
+			job.line += (job.line.empty() ? "" : " ") + token;
+		}
+		if (job.line.empty())
+			continue;
+		if (job.arguments.empty()){
+			fprintf(stderr, "No program to run in \"%s\"\n", job.line.c_str());
+			return false;
+		}
+		jobs->push_back(job);
+	}
+	return true;
+}
+
+static void runJob(IssJob* job, const ElfImage& image, bool mapMemory, bool jit){
+	RiscvSimulator simulator;
+	if (image.is32Bits && !mapMemory)
+		simulator.useFlatMemory();
+	if (jit)
+		simulator.enableJit();
+
+	std::vector<char*> argv;
+	for (unsigned int i = 0; i < job->arguments.size(); i++)
+		argv.push_back((char*) job->arguments[i].c_str());
+	simulator.load(image, argv.size(), &argv[0]);
+
+	FILE* input = NULL;
+	if (!job->input.empty() && (input = fopen(job->input.c_str(), "r")) == NULL){
+		job->status = SIM_ERROR;
+		job->result = "Cannot read " + job->input + "\n";
+		return;
+	}
+	char* captured = NULL;
+	size_t capturedSize = 0;
+	FILE* output = job->output.empty() ? open_memstream(&captured, &capturedSize) : fopen(job->output.c_str(), "w");
+	if (output == NULL){
+		if (input != NULL)
+			fclose(input);
+		job->status = SIM_ERROR;
+		job->result = "Cannot write " + (job->output.empty() ? std::string("the output") : job->output) + "\n";
+		return;
+	}
+	simulator.programInput = input;
+	simulator.programOutput = output;
+
+	job->status = simulator.run(INSTRUCTION_BUDGET);
+
+	if (input != NULL)
+		fclose(input);
+	fclose(output);
+	if (captured != NULL){
+		job->result.assign(captured, capturedSize);
+		free(captured);
+	}
+
+	char summary[320];
+	if (job->status == SIM_EXITED)
+		snprintf(summary, sizeof(summary), "Exited with status %d after %llu instructions\n", simulator.exitStatus,
+				(unsigned long long) simulator.n_inst);
+	else if (job->status == SIM_ERROR)
+		snprintf(summary, sizeof(summary), "Error after %llu instructions: %s\n", (unsigned long long) simulator.n_inst,
+				simulator.errorMessage.c_str());
+	else
+		snprintf(summary, sizeof(summary), "Stopped after %llu instructions\n", (unsigned long long) simulator.n_inst);
+	if (!job->result.empty() && job->result[job->result.size() - 1] != '\n')
+		job->result += '\n';
+	job->result += summary;
+}
+
+static int runJobs(const char* jobFile, int threads, bool mapMemory, bool jit){
+	std::vector<IssJob> jobs;
+	if (!readJobs(jobFile, &jobs))
+		return 1;
+
+	//Only read by the instances, one image per program
+	std::map<std::string, ElfImage*> images;
+	for (unsigned int i = 0; i < jobs.size(); i++){
+		const std::string& elf = jobs[i].arguments[0];
+		if (images.count(elf))
+			continue;
+		if (access(elf.c_str(), R_OK) != 0){
+			fprintf(stderr, "Cannot read %s\n", elf.c_str());
+			return 1;
+		}
+		ElfFile elfFile(elf.c_str());
+		images[elf] = new ElfImage(&elfFile);
+	}
+
+	if (threads < 1)
+		threads = std::thread::hardware_concurrency();
+	if (threads < 1)
+		threads = 1;
+	if ((unsigned int) threads > jobs.size())
+		threads = jobs.size();
+	std::atomic<unsigned int> nextJob(0);
+	std::vector<std::thread> pool;
+	for (int t = 0; t < threads; t++){
+		pool.push_back(std::thread([&](){
+			unsigned int i;
+			while ((i = nextJob++) < jobs.size())
+				runJob(&jobs[i], *images.find(jobs[i].arguments[0])->second, mapMemory, jit);
+		}));
+	}
+	for (unsigned int t = 0; t < pool.size(); t++)
+		pool[t].join();
+
+	int failed = 0;
+	for (unsigned int i = 0; i < jobs.size(); i++){
+		printf("==== Run %d: %s\n%s\n", i, jobs[i].line.c_str(), jobs[i].result.c_str());
+		if (jobs[i].status == SIM_ERROR)
+			failed++;
+	}
+	printf("%d runs on %d threads, %d failed\n", (int) jobs.size(), threads, failed);
+
+	for (std::map<std::string, ElfImage*>::iterator it = images.begin(); it != images.end(); it++)
+		delete it->second;
+	return failed == 0 ? 0 : 1;
+}
+
 //Main function performing the merging
 int main(int argc, char* argv[]){
 
@@ -25,7 +196,15 @@ int main(int argc, char* argv[]){
 	int c;
 	int VERBOSE = 0;
 	int HELP = 0;
+	int MAPMEMORY = 0;
+	int JIT = 0;
 	char* binaryFile = NULL;
+	char* reuseReport = NULL;
+	char* traceFile = NULL;
+	char* branchFile = NULL;
+	char* jobFile = NULL;
+	int threads = 0;
+	int reuseLine = 64;
 	char* ARGUMENTS = NULL;
 	//fprintf(stderr,"%s\n", argv[3]);
 	FILE** inStreams = (FILE**) malloc(10*sizeof(FILE*));
@@ -34,7 +213,7 @@ int main(int argc, char* argv[]){
 	int nbInStreams = 0;
 	int nbOutStreams = 0;
 
-	while ((c = getopt (argc, argv, "vhf:a:o:i:")) != -1)
+	while ((c = getopt (argc, argv, "vhMjf:a:o:i:r:l:t:b:p:n:")) != -1)
 	switch (c)
 	  {
 	  case 'v':
@@ -43,12 +222,36 @@ int main(int argc, char* argv[]){
 	  case 'h':
 		HELP = 1;
 		break;
+	  case 'M':
+		MAPMEMORY = 1;
+		break;
+	  case 'j':
+		JIT = 1;
+		break;
 	  case 'a':
 		  ARGUMENTS = optarg;
 		break;
 	  case 'f':
 		  binaryFile = optarg;
 	  break;
+	  case 'r':
+		  reuseReport = optarg;
+	  break;
+	  case 'l':
+		  reuseLine = atoi(optarg);
+	  break;
+	  case 't':
+		  traceFile = optarg;
+	  break;
+	  case 'b':
+		  branchFile = optarg;
+	  break;
+	  case 'p':
+		  jobFile = optarg;
+	  break;
+	  case 'n':
+		  threads = atoi(optarg);
+	  break;
 	  case 'i':
 		  if (strcmp(optarg, "stdin") == 0)
 			  inStreams[nbInStreams] = stdin;
@@ -123,54 +326,103 @@ int main(int argc, char* argv[]){
 
 	//fprintf(stderr,"There is %d arguments passed to simulator\n", localArgc);
 
-	if (HELP || binaryFile == NULL){
-		fprintf(stderr,"Usage is %s [-v] file\n\t-v\tVerbose mode, prints all execution information\n", argv[0]);
+	if (HELP || (binaryFile == NULL && jobFile == NULL) || reuseLine < 4 || (reuseLine & (reuseLine - 1))){
+		fprintf(stderr,"Usage is %s [-v] [-M] [-j] [-r report [-l line]] [-t trace] [-b branches] file\n"
+				"      or %s [-M] [-j] -p jobs [-n threads]\n\t-v\tVerbose mode, prints all execution information\n"
+				"\t-M\tUse the sparse map memory instead of the flat 4GB guest memory\n"
+				"\t-j\tTranslate hot basic blocks to host code (x86-64 hosts, flat memory only)\n"
+				"\t-r\tWrite the LRU stack distance analysis of the loads and stores to report\n"
+				"\t-l\tLine size of that analysis, a power of two (64 bytes by default)\n"
+				"\t-t\tRecord the fetches, loads and stores to a binary memory trace (see tracesim)\n"
+				"\t-b\tRecord the branches and jumps with their outcome to a branch trace (see branchsim)\n"
+				"\t-p\tRun the programs of the job file, one per line with its arguments, <input and >output\n"
+				"\t-n\tNumber of threads running them (all the host threads by default)\n", argv[0], argv[0]);
 		return 1;
 	}
 
+	if (jobFile != NULL){
+		if (VERBOSE || reuseReport != NULL || traceFile != NULL || branchFile != NULL){
+			fprintf(stderr, "-v, -r, -t and -b apply to a single program, not to -p\n");
+			return 1;
+		}
+		return runJobs(jobFile, threads, MAPMEMORY, JIT);
+	}
+
 	//******************************************************************************************
 	//Opening elf files
 	//fprintf(stderr, "Binary file is %s\n", binaryFile);
 	ElfFile elfFile(binaryFile);
+	ElfImage image(&elfFile);
 	RiscvSimulator* simulator = new RiscvSimulator();
-	simulator->initialize(localArgc, localArgv);
+	if (image.is32Bits && !MAPMEMORY && !simulator->useFlatMemory())
+		fprintf(stderr, "Could not reserve the flat guest memory, falling back to the map memory\n");
 	simulator->debugLevel = VERBOSE*2;
+	//Translated blocks access the memory directly, the analysis and the trace need the interpreter
+	StackDistance* reuse = NULL;
+	if (reuseReport != NULL){
+		reuse = new StackDistance(reuseLine);
+		if (JIT)
+			fprintf(stderr, "The stack distance analysis runs the interpreter only\n");
+		JIT = 0;
+	}
+	MemoryTraceWriter* trace = NULL;
+	if (traceFile != NULL){
+		trace = new MemoryTraceWriter();
+		if (!trace->open(traceFile)){
+			fprintf(stderr, "Cannot write the memory trace to %s\n", traceFile);
+			return 1;
+		}
+		if (JIT)
+			fprintf(stderr, "The memory trace is recorded by the interpreter only\n");
+		JIT = 0;
+	}
+	BranchTraceWriter* branches = NULL;
+	if (branchFile != NULL){
+		branches = new BranchTraceWriter();
+		if (!branches->open(branchFile)){
+			fprintf(stderr, "Cannot write the branch trace to %s\n", branchFile);
+			return 1;
+		}
+		if (JIT)
+			fprintf(stderr, "The branch trace is recorded by the interpreter only\n");
+		JIT = 0;
+	}
+	if (JIT && !simulator->enableJit())
+		fprintf(stderr, "Could not enable the translation of hot blocks, running the interpreter only\n");
 	simulator->inStreams = inStreams;
 	simulator->nbInStreams = nbInStreams;
 	simulator->outStreams = outStreams;
 	simulator->nbOutStreams = nbOutStreams;
 
-	unsigned int heapAddress = 0;
-	for (unsigned int sectionCounter = 0; sectionCounter<elfFile.sectionTable->size(); sectionCounter++){
-		ElfSection *oneSection = elfFile.sectionTable->at(sectionCounter);
-
-		if (oneSection->address != 0){
-			//If the address is not null we place its content into memory
-			unsigned char* sectionContent = oneSection->getSectionCode();
+	simulator->load(image, localArgc, localArgv);
 
-			for (unsigned int byteNumber = 0; byteNumber<oneSection->size; byteNumber++){
-				simulator->stb(oneSection->address + byteNumber, sectionContent[byteNumber]);
-			}
+	//Accesses of the loader are not part of the program
+	simulator->reuse = reuse;
+	simulator->trace = trace;
+	simulator->branches = branches;
+	simulator->doSimulation(INSTRUCTION_BUDGET / 1000);
 
-			if (oneSection->address + oneSection->size > heapAddress)
-				heapAddress = oneSection->address + oneSection->size;
-		}
+	//Flushes the last records
+	delete trace;
+	if (branches != NULL){
+		branches->close(simulator->n_inst);
+		delete branches;
 	}
-	simulator->heapAddress = heapAddress;
-	simulator->pc = 0x10000;
-
-	for (int oneSymbol = 0; oneSymbol < elfFile.symbols->size(); oneSymbol++){
-		ElfSymbol *symbol = elfFile.symbols->at(oneSymbol);
-		const char* name = (const char*) &(elfFile.sectionTable->at(elfFile.indexOfSymbolNameSection)->getSectionCode()[symbol->name]);
-
-		if (strcmp(name, "_start") == 0){
-			//fprintf(stderr, "%s\n", name);
-			simulator->pc = symbol->offset;
 
+	if (reuse != NULL){
+		std::ofstream out(reuseReport);
+		if (!out)
+			fprintf(stderr, "Cannot write the stack distance analysis to %s\n", reuseReport);
+		else{
+			out << "Data accesses of " << binaryFile << std::endl;
+			reuse->writeReport(out);
 		}
+		delete reuse;
 	}
-	//fprintf(stderr, "PC start is %x\n", simulator->pc);
-
-	simulator->doSimulation(50000000);
 
+	if (simulator->error != SIM_ERROR_NONE){
+		fprintf(stderr, "%s\n", simulator->errorMessage.c_str());
+		return 1;
+	}
+	return 0;
 }
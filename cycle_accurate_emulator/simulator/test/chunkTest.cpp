@@ -0,0 +1,102 @@
+/*
+ * chunkTest.cpp
+ *
+ * Runs a program through the embedding API (RiscvSimulator::run) in one call,
+ * then in chunks of a few instructions with the interpreter and with the JIT,
+ * and checks that the three runs end in the same state: status, exit status,
+ * n_inst, pc and registers. See util/chunktest.sh.
+ *
+ * usage: chunkTest [-c instructions] file
+ */
+
+#include <simulator/riscvSimulator.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <lib/elfFile.h>
+#include <lib/elfImage.h>
+#include <unistd.h>
+
+#define INSTRUCTION_BUDGET 50000000000ULL
+
+struct ChunkRun{
+	int status;
+	int exitStatus;
+	uint64_t n_inst;
+	uint64_t calls;
+	uint32_t pc;
+	int32_t registers[32];
+};
+
+//Calls run until the program stops, or until the budget could not have been reached in that many calls
+static void runInChunks(const ElfImage& image, bool jit, uint64_t chunk, ChunkRun* result){
+	RiscvSimulator simulator;
+	if (image.is32Bits)
+		simulator.useFlatMemory();
+	if (jit && !simulator.enableJit())
+		fprintf(stderr, "The JIT is not available on this host, the interpreter is used\n");
+	simulator.load(image, 0, NULL);
+	simulator.programOutput = fopen("/dev/null", "w");
+
+	uint64_t maxCalls = INSTRUCTION_BUDGET / chunk + 1;
+	result->calls = 0;
+	do{
+		result->status = simulator.run(chunk);
+		result->calls++;
+	} while (result->status == SIM_RUNNING && result->calls < maxCalls && simulator.n_inst < INSTRUCTION_BUDGET);
+
+	fclose(simulator.programOutput);
+	result->exitStatus = simulator.exitStatus;
+	result->n_inst = simulator.n_inst;
+	result->pc = simulator.pc;
+	for (int i = 0; i < 32; i++)
+		result->registers[i] = simulator.getRegister(i);
+}
+
+static void printRun(const char* name, const ChunkRun& run){
+	printf("%-22s status %d, exit status %d, %llu instructions in %llu calls, pc %x\n", name, run.status, run.exitStatus,
+			(unsigned long long) run.n_inst, (unsigned long long) run.calls, run.pc);
+}
+
+static bool sameState(const ChunkRun& a, const ChunkRun& b){
+	if (a.status != b.status || a.exitStatus != b.exitStatus || a.n_inst != b.n_inst || a.pc != b.pc)
+		return false;
+	for (int i = 0; i < 32; i++)
+		if (a.registers[i] != b.registers[i])
+			return false;
+	return true;
+}
+
+int main(int argc, char* argv[]){
+	uint64_t chunk = 1000;
+	int c;
+	while ((c = getopt(argc, argv, "c:")) != -1)
+		switch (c){
+			case 'c':
+				chunk = strtoull(optarg, NULL, 0);
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-c instructions] file\n", argv[0]);
+				return 2;
+		}
+	if (optind != argc - 1 || chunk == 0){
+		fprintf(stderr, "usage: %s [-c instructions] file\n", argv[0]);
+		return 2;
+	}
+
+	ElfFile elfFile(argv[optind]);
+	ElfImage image(&elfFile);
+
+	ChunkRun whole, interpreted, translated;
+	runInChunks(image, false, INSTRUCTION_BUDGET, &whole);
+	runInChunks(image, false, chunk, &interpreted);
+	runInChunks(image, true, chunk, &translated);
+
+	printRun("one call", whole);
+	printRun("interpreter, chunks", interpreted);
+	printRun("JIT, chunks", translated);
+
+	bool passed = whole.status != SIM_RUNNING && sameState(whole, interpreted) && sameState(whole, translated);
+	printf("%s\n", passed ? "identical" : "DIFFERENT");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,247 @@
+// vim: set ts=4 nu ai:
+#include <lib/memoryTrace.h>
+#include <config.h>
+#include <cache.h>
+#include <dram.h>
+#include <l2cache.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace std;
+
+/*********************************************************
+ * 	Trace driven cache simulation
+ *
+ * 	Replays a memory trace recorded by simRISCV -t, or a
+ * 	Dinero din file, through the memory hierarchy of
+ * 	catapult.sim: fetches go to the icache, loads and stores
+ * 	to the dcache, both filling from the L2 or the DRAM.
+ *
+ * 	Each line of the configuration file is one hierarchy,
+ * 	given as section.key=value overrides separated by spaces
+ * 	(the keys of catapult.sim, see config.h) and applied on
+ * 	top of the -o options. The configurations are replayed by
+ * 	a pool of threads sharing the trace, each with its own
+ * 	caches and DRAM.
+ *
+ * 	The cycle count is that of a blocking in-order core
+ * 	running one instruction per fetch and cycle, stalled for
+ * 	the latency of each miss. MSHRs are not modelled, it is
+ * 	only meant to rank the configurations.
+ *********************************************************/
+
+struct TraceConfig{
+	string name;
+	SimulatorConfig config;
+};
+
+struct TraceResult{
+	unsigned long long fetches;
+	unsigned long long fetchMisses;
+	unsigned long long loads;
+	unsigned long long stores;
+	unsigned long long dataMisses;
+	unsigned long long dataWritebacks;
+	unsigned long long l2Accesses;
+	unsigned long long l2Misses;
+	unsigned long long cycles;
+};
+
+static void printUsage(const char* program){
+	cerr << "Usage: " << program << " [-j threads] [-c configs] [-o section.key=value]... [-d out.din] trace" << endl;
+	cerr << "  -j threads            number of configurations replayed at once (all the host threads by default)" << endl;
+	cerr << "  -c configs            one configuration per line, as section.key=value overrides" << endl;
+	cerr << "  -o section.key=value  override applied to every configuration" << endl;
+	cerr << "  -d out.din            convert the trace to the Dinero din format and exit" << endl;
+	cerr << "The trace is a binary trace of simRISCV -t or a din file" << endl;
+}
+
+static bool readConfigs(const char* fileName, const SimulatorConfig& base, vector<TraceConfig>* configs){
+	ifstream in(fileName);
+	if(!in){
+		cerr << "Cannot open " << fileName << endl;
+		return false;
+	}
+	string line;
+	while(getline(in, line)){
+		istringstream tokens(line);
+		string option;
+		TraceConfig config;
+		config.config = base;
+		while(tokens >> option){
+			if(option[0] == '#')
+				break;
+			if(!applyOverride(&config.config, option))
+				return false;
+			config.name += (config.name.empty() ? "" : " ") + option;
+		}
+		if(config.name.empty())
+			continue;
+		if(!checkConfig(&config.config))
+			return false;
+		configs->push_back(config);
+	}
+	return true;
+}
+
+template<class CACHE> static void access(CACHE* cache, const MemoryAccess& access, unsigned int address,
+		int bytes, unsigned long long* stall){
+	CORE_UINT(2) miss = 0;
+	CORE_UINT(2) op = bytes == 1 ? 0 : bytes == 2 ? 1 : 3;
+	if(access.type == TRACE_WRITE)
+		cache->store(address, 0, op, &miss, access.pc);
+	else
+		cache->load(address, op, 0, &miss, access.pc);
+	int latency = cache->getLatency();
+	if(latency > 1)
+		*stall += latency - 1;
+}
+
+static void replay(const vector<MemoryAccess>& trace, const SimulatorConfig& config, TraceResult* result){
+	Dram dram(config.dram);
+	L2Cache l2(&dram, config.l2);
+	MemoryLevel* next = config.l2.enabled ? (MemoryLevel*) &l2 : &dram;
+	InstructionCache icache(next, config.icache);
+	DataCache dcache(next, config.dcache);
+	if(config.l2.enabled){
+		l2.addUpperCache(&icache);
+		l2.addUpperCache(&dcache);
+	}
+
+	unsigned long long cycle = 0;
+	for(unsigned int i = 0; i < trace.size(); i++){
+		const MemoryAccess& record = trace[i];
+		unsigned long long stall = 0;
+		//The caches see at most a word, wider accesses are split
+		int bytes = record.size > 4 ? 4 : record.size;
+		for(unsigned int offset = 0; offset < record.size || offset == 0; offset += 4){
+			if(record.type == TRACE_FETCH)
+				access(&icache, record, record.address + offset, bytes, &stall);
+			else
+				access(&dcache, record, record.address + offset, bytes, &stall);
+		}
+		if(record.type == TRACE_FETCH)
+			stall++;
+		for(unsigned long long c = 0; c < stall; c++){
+			cycle++;
+			icache.tick(cycle);
+			dcache.tick(cycle);
+		}
+	}
+
+	result->fetches = icache.getNumberLoads().to_uint();
+	result->fetchMisses = icache.getNumberCacheMiss().to_uint();
+	result->loads = dcache.getNumberLoads().to_uint();
+	result->stores = dcache.getNumberStores().to_uint();
+	result->dataMisses = dcache.getNumberCacheMiss().to_uint();
+	result->dataWritebacks = dcache.getNumberDramWrites().to_uint();
+	result->l2Accesses = (l2.getNumberReads() + l2.getNumberWrites()).to_uint();
+	result->l2Misses = (l2.getNumberReadMisses() + l2.getNumberWriteMisses()).to_uint();
+	result->cycles = cycle;
+}
+
+static double rate(unsigned long long part, unsigned long long total){
+	return total == 0 ? 0.0 : (double) part / total;
+}
+
+int main(int argc, char** argv){
+	SimulatorConfig base;
+	const char* configFile = NULL;
+	const char* dinFile = NULL;
+	unsigned int threads = thread::hardware_concurrency();
+	int option;
+
+	while((option = getopt(argc, argv, "j:c:o:d:h")) != -1){
+		switch(option){
+			case 'j':
+				threads = atoi(optarg);
+				break;
+			case 'c':
+				configFile = optarg;
+				break;
+			case 'o':
+				if(!applyOverride(&base, optarg))
+					return 1;
+				break;
+			case 'd':
+				dinFile = optarg;
+				break;
+			case 'h':
+				printUsage(argv[0]);
+				return 0;
+			default:
+				printUsage(argv[0]);
+				return 1;
+		}
+	}
+	if(optind != argc - 1){
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	vector<MemoryAccess> trace;
+	if(!readMemoryTrace(argv[optind], &trace)){
+		cerr << "Cannot read the memory trace " << argv[optind] << endl;
+		return 1;
+	}
+	if(dinFile != NULL){
+		if(!writeDinero(dinFile, trace)){
+			cerr << "Cannot write " << dinFile << endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	vector<TraceConfig> configs;
+	if(configFile != NULL && !readConfigs(configFile, base, &configs))
+		return 1;
+	if(configs.empty()){
+		if(!checkConfig(&base))
+			return 1;
+		TraceConfig config;
+		config.name = "default";
+		config.config = base;
+		configs.push_back(config);
+	}
+
+	//The configurations are independent, each thread takes the next one until none is left
+	vector<TraceResult> results(configs.size());
+	atomic<unsigned int> nextConfig(0);
+	if(threads < 1)
+		threads = 1;
+	if(threads > configs.size())
+		threads = configs.size();
+	vector<thread> pool;
+	for(unsigned int t = 0; t < threads; t++){
+		pool.push_back(thread([&](){
+			unsigned int i;
+			while((i = nextConfig++) < configs.size())
+				replay(trace, configs[i].config, &results[i]);
+		}));
+	}
+	for(unsigned int t = 0; t < pool.size(); t++)
+		pool[t].join();
+
+	cout << trace.size() << " accesses replayed through " << configs.size() << " configurations" << endl;
+	printf("%4s %12s %10s %12s %12s %10s %10s %10s %12s\n", "#", "fetches", "imiss%", "data", "dmisses",
+			"dmiss%", "dwrites", "l2miss%", "cycles");
+	for(unsigned int i = 0; i < configs.size(); i++){
+		const TraceResult& result = results[i];
+		printf("%4u %12llu %10.3f %12llu %12llu %10.3f %10llu %10.3f %12llu\n", i, result.fetches,
+				100.0 * rate(result.fetchMisses, result.fetches), result.loads + result.stores, result.dataMisses,
+				100.0 * rate(result.dataMisses, result.loads + result.stores), result.dataWritebacks,
+				100.0 * rate(result.l2Misses, result.l2Accesses), result.cycles);
+	}
+	cout << endl;
+	for(unsigned int i = 0; i < configs.size(); i++)
+		cout << i << ": " << configs[i].name << endl;
+	return 0;
+}
@@ -0,0 +1,34 @@
+# Checks the embedding API of the instruction set simulator: each program runs with RiscvSimulator::run
+# in one call, then in chunks of a few instructions with the interpreter and with the JIT, and the three
+# runs must end with the same status, instruction count, pc and registers (simulator/test/chunkTest.cpp).
+# usage: bash util/chunktest.sh [program.out ...]  (the benchmarks by default)
+
+root="$(cd "$(dirname "$0")/.." && pwd)"
+chunktest="$root/simulator/bin/chunkTest"
+# A run that never returns is a failure too, after CHUNKTEST_LIMIT seconds
+limit=${CHUNKTEST_LIMIT:-600}
+
+programs="$@"
+if [ -z "$programs" ]; then
+	programs=$(ls $root/benchmarks/build/*.out)
+fi
+
+echo "Building chunkTest..."
+make -C $root/common > /dev/null || exit 1
+make -C $root/simulator library chunktest > /dev/null || exit 1
+
+failed=0
+for program in $programs; do
+	name=$(basename $program .out)
+	for chunk in 1 7 1000; do
+		output=$(timeout $limit $chunktest -c $chunk $program)
+		if [ $? -eq 0 ]; then
+			echo "$name [chunks of $chunk]: identical"
+		else
+			echo "$name [chunks of $chunk]: DIFFERENT (or still running after $limit s)"
+			echo "$output"
+			failed=1
+		fi
+	done
+done
+exit $failed
@@ -0,0 +1,45 @@
+# Checks catapult.fastsim (native integers, core/include/fastint.h) against catapult.sim (ac_int):
+# both run each program under a few configurations with simulation.trace=full, and their
+# statistics and decoded traces must be identical.
+# usage: bash util/fastsimtest.sh [program.out ...]  (the benchmarks by default)
+
+root="$(cd "$(dirname "$0")/.." && pwd)"
+util="$root/util"
+core="$root/core/bin"
+mkdir -p logs
+log="./logs"
+
+programs="$@"
+if [ -z "$programs" ]; then
+	programs=$(ls $root/benchmarks/build/*.out)
+fi
+
+configs=(
+	""
+	"-o dcache.mshrs=4 -o predictor.type=gshare"
+	"-o l2.enabled=1 -o dcache.prefetcher=stride -o dcache.victim_lines=4"
+	"-o dram.model=banked -o dram.scheduler=frfcfs -o dcache.write_policy=writethrough -o predictor.type=tournament -o icache.policy=plru"
+)
+
+echo "Building catapult.sim and catapult.fastsim..."
+make -C $root/common > /dev/null || exit 1
+make -C $root/core catapult fastsim > /dev/null || exit 1
+
+failed=0
+for program in $programs; do
+	name=$(basename $program .out)
+	for i in "${!configs[@]}"; do
+		config=${configs[$i]}
+		$core/catapult.sim $config -o simulation.trace=full -o simulation.trace_file=$log/$name.$i.sim.trace $program > $log/$name.$i.sim.stats 2>&1
+		$core/catapult.fastsim $config -o simulation.trace=full -o simulation.trace_file=$log/$name.$i.fastsim.trace $program > $log/$name.$i.fastsim.stats 2>&1
+		python $util/tracedecode.py $log/$name.$i.sim.trace $log/$name.$i.sim.log
+		python $util/tracedecode.py $log/$name.$i.fastsim.trace $log/$name.$i.fastsim.log
+		if diff -q $log/$name.$i.sim.stats $log/$name.$i.fastsim.stats > /dev/null && diff -q $log/$name.$i.sim.log $log/$name.$i.fastsim.log > /dev/null; then
+			echo "$name [$config]: identical"
+		else
+			echo "$name [$config]: DIFFERENT, see $log/$name.$i.*"
+			failed=1
+		fi
+	done
+done
+exit $failed
@@ -4,31 +4,36 @@ mkdir -p logs
 log="./logs"
 
 echo "Running quicksort benchmark..."
-./catapult.sim $build/qsort.out > $log/qsort.log
+./catapult.sim -o simulation.trace=full -o simulation.trace_file=$log/qsort.trace $build/qsort.out > $log/qsort.stats
+python tracedecode.py $log/qsort.trace $log/qsort.log
 python regtracker.py $ref/qsort.ref $log/qsort.log
-tail -n14 $log/qsort.log
+tail -n14 $log/qsort.stats
 printf "\n\n\n "
 
 echo "Running multiplication benchmark..."
-./catapult.sim $build/multiply.out > $log/multiply.log
+./catapult.sim -o simulation.trace=full -o simulation.trace_file=$log/multiply.trace $build/multiply.out > $log/multiply.stats
+python tracedecode.py $log/multiply.trace $log/multiply.log
 python regtracker.py $ref/multiply.ref $log/multiply.log
-tail -n14 $log/multiply.log
+tail -n14 $log/multiply.stats
 printf "\n\n\n "
 
 echo "Running towers of hanoi benchmark..."
-./catapult.sim $build/towers.out > $log/towers.log
+./catapult.sim -o simulation.trace=full -o simulation.trace_file=$log/towers.trace $build/towers.out > $log/towers.stats
+python tracedecode.py $log/towers.trace $log/towers.log
 python regtracker.py $ref/towers.ref $log/towers.log
-tail -n14 $log/towers.log
+tail -n14 $log/towers.stats
 printf "\n\n\n "
 
 echo "Running median benchmark..."
-./catapult.sim $build/median.out > $log/median.log
+./catapult.sim -o simulation.trace=full -o simulation.trace_file=$log/median.trace $build/median.out > $log/median.stats
+python tracedecode.py $log/median.trace $log/median.log
 python regtracker.py $ref/median.ref $log/median.log
-tail -n14 $log/median.log
+tail -n14 $log/median.stats
 printf "\n\n\n "
 
 echo "Running vector addition benchmark..."
-./catapult.sim $build/vvadd.out > $log/vvadd.log
+./catapult.sim -o simulation.trace=full -o simulation.trace_file=$log/vvadd.trace $build/vvadd.out > $log/vvadd.stats
+python tracedecode.py $log/vvadd.trace $log/vvadd.log
 python regtracker.py $ref/vvadd.ref $log/vvadd.log
-tail -n14 $log/vvadd.log
+tail -n14 $log/vvadd.stats
 printf "\n\n\n "
@@ -0,0 +1,74 @@
+import struct
+import sys
+
+# Turns the binary trace of catapult.sim -o simulation.trace=full|sampled (see core/include/cycletrace.h)
+# back into the text it printed every cycle, as read by regtracker.py
+# usage: tracedecode.py trace [output]
+
+MAGIC = b"CCTRACE1"
+ICACHE = 1
+DCACHE = 2
+EXIT = 4
+UNKNOWN = 8
+INSTRUCTION = 16
+REGISTERS = 32
+
+def varint(data, offset):
+	value = 0
+	shift = 0
+	while True:
+		byte = ord(data[offset:offset + 1])
+		offset += 1
+		value |= (byte & 0x7f) << shift
+		shift += 7
+		if byte < 0x80:
+			return value, offset
+
+def decode(data, out):
+	if data[0:8] != MAGIC:
+		sys.stderr.write("Not a cycle trace\n")
+		return False
+	offset = 12
+	cycle = 0
+	pc = 0
+	instruction = 0
+	registers = [0] * 32
+	while offset < len(data):
+		markers = ord(data[offset:offset + 1])
+		delta, offset = varint(data, offset + 1)
+		cycle += delta
+		delta, offset = varint(data, offset)
+		pc = (pc + ((delta >> 1) ^ -(delta & 1))) & 0xffffffff
+		if markers & INSTRUCTION:
+			instruction = struct.unpack_from("<I", data, offset)[0]
+			offset += 4
+		if markers & REGISTERS:
+			mask = struct.unpack_from("<I", data, offset)[0]
+			offset += 4
+			for reg in range(32):
+				if mask & (1 << reg):
+					registers[reg] = struct.unpack_from("<I", data, offset)[0]
+					offset += 4
+
+		line = "%d;" % cycle
+		if markers & EXIT:
+			line += "Exit system call received, Exiting... "
+		if markers & UNKNOWN:
+			line += "Unknown system call received, Exiting... "
+		if markers & DCACHE:
+			line += "[DCache miss] "
+		if markers & ICACHE:
+			line += "[ICache miss] "
+		line += "%x;%x " % (pc, instruction)
+		line += "".join(";%x" % value for value in registers)
+		out.write(line + "\n")
+	return True
+
+if len(sys.argv) < 2:
+	sys.stderr.write("usage: tracedecode.py trace [output]\n")
+	sys.exit(1)
+with open(sys.argv[1], "rb") as f:
+	data = f.read()
+out = open(sys.argv[2], "w") if len(sys.argv) > 2 else sys.stdout
+if not decode(data, out):
+	sys.exit(1)